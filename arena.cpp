@@ -0,0 +1,117 @@
+// arena implementation
+#include "arena.h"
+
+// round size up to the allocation granularity
+static size_t alignSize(size_t bytes) {
+	if(bytes == 0)
+		bytes = 1;
+	return (bytes + ARENA_ALIGN - 1) & ~((size_t) ARENA_ALIGN - 1);
+}
+
+// constructor
+Arena::Arena(size_t pageSize)
+	: current_(0), pageSize_(alignSize(pageSize)), inUse_(0), highWater_(0), allocated_(0), blocks_(0), reserved_(0) {
+	for(unsigned i=0; i < ARENA_SMALL_BLOCK / ARENA_ALIGN; ++i)
+		freeList_[i] = 0;
+}
+
+// destructor
+Arena::~Arena() {
+	for(unsigned i=0; i < pages_.size(); ++i)
+		delete []pages_[i].mem;
+}
+
+// get block of given size
+// small blocks come from the free lists first, then the bump pointer
+// moves forward through the pages, new page is added only if none fits
+void * Arena::allocate(size_t bytes) {
+	bytes = alignSize(bytes);
+	void * ptr = 0;
+
+	if(bytes <= ARENA_SMALL_BLOCK && freeList_[bytes / ARENA_ALIGN - 1]) {
+		// pop from the free list
+		ptr = freeList_[bytes / ARENA_ALIGN - 1];
+		freeList_[bytes / ARENA_ALIGN - 1] = *(void **) ptr;
+	} else {
+		// find page with enough room
+		while(current_ < pages_.size() && pages_[current_].size - pages_[current_].used < bytes)
+			current_++;
+
+		if(current_ == pages_.size()) {
+			// large blocks get a page of their own
+			Page pg;
+			pg.size = (bytes > pageSize_) ? bytes : pageSize_;
+			pg.mem = new char[pg.size];
+			pg.used = 0;
+			pages_.push_back(pg);
+			reserved_ += pg.size;
+		}
+
+		ptr = (void *) (pages_[current_].mem + pages_[current_].used);
+		pages_[current_].used += bytes;
+	}
+
+	inUse_ += bytes;
+	allocated_ += bytes;
+	blocks_++;
+	if(inUse_ > highWater_)
+		highWater_ = inUse_;
+	return ptr;
+}
+
+// give block back
+// top-most block of the current page rolls the bump pointer back,
+// small blocks go to the free list, other blocks wait for reset()
+void Arena::release(void * ptr, size_t bytes) {
+	if(!ptr)
+		return;
+	bytes = alignSize(bytes);
+	inUse_ -= bytes;
+
+	if(current_ < pages_.size() && (char *) ptr + bytes == pages_[current_].mem + pages_[current_].used) {
+		pages_[current_].used -= bytes;
+	} else if(bytes <= ARENA_SMALL_BLOCK) {
+		*(void **) ptr = freeList_[bytes / ARENA_ALIGN - 1];
+		freeList_[bytes / ARENA_ALIGN - 1] = ptr;
+	}
+}
+
+// forget all blocks, keep the pages
+void Arena::reset() {
+	for(unsigned i=0; i < pages_.size(); ++i)
+		pages_[i].used = 0;
+	for(unsigned i=0; i < ARENA_SMALL_BLOCK / ARENA_ALIGN; ++i)
+		freeList_[i] = 0;
+	current_ = 0;
+	inUse_ = 0;
+}
+
+// bytes currently handed out
+size_t Arena::getInUse() const {
+	return inUse_;
+}
+
+// max bytes handed out at once
+size_t Arena::getHighWater() const {
+	return highWater_;
+}
+
+// bytes held in pages
+size_t Arena::getReserved() const {
+	return reserved_;
+}
+
+// bytes handed out since construction
+size_t Arena::getAllocated() const {
+	return allocated_;
+}
+
+// blocks handed out since construction
+size_t Arena::getBlocks() const {
+	return blocks_;
+}
+
+// pages taken from the heap
+size_t Arena::getPages() const {
+	return pages_.size();
+}
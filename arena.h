@@ -0,0 +1,118 @@
+// arena: per-job page allocator for planes, lists and bitstreams
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+// default size of one arena page (bytes)
+#define ARENA_PAGE_SIZE		(1 << 20)
+// blocks up to this size are recycled through free lists (list nodes)
+#define ARENA_SMALL_BLOCK	256
+// allocation granularity, also the alignment of returned blocks
+#define ARENA_ALIGN			16
+
+// Arena:
+// hands out memory from a chain of pages, owned by one job (not thread-safe)
+// small blocks released back are kept on free lists and reused,
+// the top-most block of a page is rolled back on release,
+// everything else is returned at once by reset(), which keeps the pages
+// so that the next image processed by the same worker does not touch the heap
+class Arena {
+	// single page
+	struct Page {
+		char * mem;
+		size_t size;
+		size_t used;
+	};
+
+	std::vector<Page> pages_;
+	size_t current_;		// page the bump pointer is in
+	size_t pageSize_;		// size of regular pages
+	size_t inUse_;			// bytes currently handed out
+	size_t highWater_;		// max of inUse_ since construction
+	size_t allocated_;		// bytes handed out since construction (work counters)
+	size_t blocks_;			// blocks handed out since construction
+	size_t reserved_;		// bytes held in pages
+
+	// free lists of small blocks, one per ARENA_ALIGN size class
+	void * freeList_[ARENA_SMALL_BLOCK / ARENA_ALIGN];
+
+	// not copyable
+	Arena(const Arena&);
+	Arena& operator= (const Arena&);
+
+public:
+	// constructor, pages are created on demand
+	explicit Arena(size_t pageSize = ARENA_PAGE_SIZE);
+	// destructor, frees all pages
+	~Arena();
+
+	// get block of given size
+	void * allocate(size_t bytes);
+	// give block back (see class notes for what is actually reused)
+	void release(void * ptr, size_t bytes);
+	// forget all blocks, keep the pages warm
+	void reset();
+
+	// bytes currently handed out
+	size_t getInUse() const;
+	// max bytes handed out at once
+	size_t getHighWater() const;
+	// bytes held in pages
+	size_t getReserved() const;
+	// bytes handed out since construction, released ones included
+	size_t getAllocated() const;
+	// blocks handed out since construction, released ones included
+	size_t getBlocks() const;
+	// pages taken from the heap
+	size_t getPages() const;
+};
+
+// STL allocator drawing from an Arena
+// with no arena given it falls back to the heap
+template <class T> class ArenaAllocator {
+public:
+	typedef T			value_type;
+	typedef T*			pointer;
+	typedef const T*	const_pointer;
+	typedef T&			reference;
+	typedef const T&	const_reference;
+	typedef size_t		size_type;
+	typedef ptrdiff_t	difference_type;
+
+	template <class U> struct rebind { typedef ArenaAllocator<U> other; };
+
+	// containers carry their arena along
+	typedef std::true_type propagate_on_container_copy_assignment;
+	typedef std::true_type propagate_on_container_move_assignment;
+	typedef std::true_type propagate_on_container_swap;
+
+	Arena * arena;
+
+	ArenaAllocator(Arena * a = 0) : arena(a) {}
+	template <class U> ArenaAllocator(const ArenaAllocator<U>& src) : arena(src.arena) {}
+
+	T * allocate(size_t n) {
+		if(arena)
+			return (T *) arena->allocate(n * sizeof(T));
+		return (T *) ::operator new(n * sizeof(T));
+	}
+
+	void deallocate(T * ptr, size_t n) {
+		if(arena)
+			arena->release((void *) ptr, n * sizeof(T));
+		else
+			::operator delete((void *) ptr);
+	}
+
+	template <class U> bool operator== (const ArenaAllocator<U>& other) const {
+		return arena == other.arena;
+	}
+	template <class U> bool operator!= (const ArenaAllocator<U>& other) const {
+		return arena != other.arena;
+	}
+};
+
+#endif
@@ -0,0 +1,163 @@
+// arithstream implementation
+#include "arithstream.h"
+#include <iostream>
+
+// constructor
+// encoder claims room for the symbol count, decoder reads it & fills the code window
+ArithStream::ArithStream(BitStream &bs, bool encoding, bool wide)
+	: bs_(bs), encoding_(encoding), symbols_(0), count_(0), countBits_(wide ? 64 : 32),
+	  low_(0), range_(0xFFFFFFFF), cache_(0), cacheSize_(1), bytes_(0), countPos_(0), counted_(false),
+	  code_(0), exhausted_(false), finished(false) {
+	for(unsigned i = 0; i < ARITH_CONTEXTS; ++i)
+		prob_[i] = 1 << (ARITH_PROBBITS - 1);
+
+	if(encoding_) {
+		counted_ = bs_.reserveBits(countBits_, countPos_) == countBits_;
+		finished = !counted_;
+	} else {
+		bitCount pos;
+		if(bs_.takeBits(countBits_, pos) == countBits_)
+			count_ = bs_.readBits(pos, countBits_);
+		else
+			exhausted_ = true;
+
+		// window of 4 bytes after the leading (zero) one
+		for(unsigned i = 0; i < 5 && !exhausted_; ++i)
+			if(!nextByte())
+				exhausted_ = true;
+	}
+}
+
+// output top byte of low, held back while a carry may still reach it
+void ArithStream::shiftLow() {
+	if((uint32_t) low_ < 0xFF000000u || (low_ >> 32) != 0) {
+		unsigned char carry = (unsigned char) (low_ >> 32);
+		unsigned char temp = cache_;
+		do {
+			bs_.putBits((unsigned char) (temp + carry), 8);
+			bytes_++;
+			temp = 0xFF;
+		} while(--cacheSize_ != 0);
+		cache_ = (unsigned char) (low_ >> 24);
+	}
+	cacheSize_++;
+	low_ = (low_ & 0x00FFFFFF) << 8;
+}
+
+// next byte into the code window
+bool ArithStream::nextByte() {
+	bitCount pos;
+	if(bs_.takeBits(8, pos) < 8)
+		return false;
+	code_ = (code_ << 8) | (uint32_t) bs_.readBits(pos, 8);
+	return true;
+}
+
+// encode a bit, returns false if there is no room left (stream gets closed)
+bool ArithStream::encode(bool bit, unsigned short &p) {
+	if(finished)
+		return false;
+
+	// room for this symbol (at most 2 more bytes) and the flush (at most 4 + cached ones)
+	if(countBits_ + 8 * (bytes_ + cacheSize_ + 6) > bs_.getTotalBits()) {
+		performClose();
+		return false;
+	}
+	// the symbol count is full - longer streams end there
+	if(symbols_ == (countBits_ == 64 ? ~(uint64_t) 0 : (uint64_t) 0xFFFFFFFFu)) {
+		std::cout << "Arithmetic coded stream closed at " << symbols_ << " symbols, the rest of the plane is not coded!" << std::endl;
+		performClose();
+		return false;
+	}
+
+	uint32_t bound = (range_ >> ARITH_PROBBITS) * p;
+	if(!bit) {
+		range_ = bound;
+		p += ((1 << ARITH_PROBBITS) - p) >> ARITH_ADAPT;
+	} else {
+		low_ += bound;
+		range_ -= bound;
+		p -= p >> ARITH_ADAPT;
+	}
+	while(range_ < (1u << 24)) {
+		range_ <<= 8;
+		shiftLow();
+	}
+
+	symbols_++;
+	return true;
+}
+
+// decode a bit, returns -1 past the last symbol
+unsigned char ArithStream::decode(unsigned short &p) {
+	if(exhausted_ || symbols_ >= count_) {
+		finished = true;
+		return -1;
+	}
+
+	unsigned char bit;
+	uint32_t bound = (range_ >> ARITH_PROBBITS) * p;
+	if(code_ < bound) {
+		range_ = bound;
+		p += ((1 << ARITH_PROBBITS) - p) >> ARITH_ADAPT;
+		bit = 0;
+	} else {
+		code_ -= bound;
+		range_ -= bound;
+		p -= p >> ARITH_ADAPT;
+		bit = 1;
+	}
+	// this symbol is complete, a missing byte only stops the next one
+	while(range_ < (1u << 24)) {
+		range_ <<= 8;
+		if(!nextByte()) {
+			exhausted_ = true;
+			break;
+		}
+	}
+
+	symbols_++;
+	return bit;
+}
+
+// put in context
+bool ArithStream::put(bool bit, unsigned ctx) {
+	return encode(bit, prob_[ctx]);
+}
+
+// put with fixed probability 1/2
+bool ArithStream::put(bool bit) {
+	unsigned short p = 1 << (ARITH_PROBBITS - 1);
+	return encode(bit, p);
+}
+
+// get in context
+unsigned char ArithStream::get(unsigned ctx) {
+	return decode(prob_[ctx]);
+}
+
+// get with fixed probability 1/2
+unsigned char ArithStream::get() {
+	unsigned short p = 1 << (ARITH_PROBBITS - 1);
+	return decode(p);
+}
+
+// flush the coder, store the symbol count, close the bitstream
+void ArithStream::performClose() {
+	if(finished)
+		return;
+	finished = true;
+
+	if(encoding_) {
+		for(unsigned i = 0; i < 5; ++i)
+			shiftLow();
+		if(counted_)
+			bs_.writeBits(countPos_, symbols_, countBits_);
+	}
+	bs_.performClose();
+}
+
+// pass boundary at the bytes output so far
+void ArithStream::markPass() {
+	bs_.markPass();
+}
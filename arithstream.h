@@ -0,0 +1,82 @@
+// arithstream: context-adaptive binary arithmetic coding of symbols into a BitStream
+#ifndef ARITHSTREAM_H
+#define ARITHSTREAM_H
+
+#include "general.h"
+#include "colorcodec.h"
+
+// added to the coder version byte of arithmetic coded bitstreams
+#define ARITH_VERSION 0x08
+// number of adaptive contexts
+#define ARITH_CONTEXTS 128
+// probability precision & adaptation speed (shift)
+#define ARITH_PROBBITS 11
+#define ARITH_ADAPT 4
+
+// class ArithStream
+// binary range coder (32-bit window, carries resolved through a held-back byte) with adaptive bit probabilities,
+// writes / reads whole bytes of an existing BitStream
+// the stream starts with the count of coded symbols, so the decoder stops exactly there;
+// the count has 32 bits, 64 on images over 65535 a side (wide container), encoding stops with a message
+// at the largest count
+// a truncated stream decodes every symbol whose bytes are all present
+// same interface as the BitStream for the pass engine, symbols carry a context
+class ArithStream {
+	typedef ColorCodec::DataGroup::BitStream BitStream;
+
+	BitStream &bs_;
+	bool encoding_;
+	unsigned short prob_[ARITH_CONTEXTS];	// probability of 0 per context
+	uint64_t symbols_;		// symbols coded so far
+	uint64_t count_;		// (decoding) symbols in the stream
+	unsigned countBits_;	// bits of the symbol count: 32, or 64 on images over 65535 a side
+
+	// encoder state
+	uint64_t low_;
+	uint32_t range_;
+	unsigned char cache_;	// last byte not yet output (may get a carry)
+	unsigned cacheSize_;	// cached byte + pending 0xFF bytes
+	uint64_t bytes_;		// bytes output
+	bitCount countPos_;		// bit position of the symbol count
+	bool counted_;			// room for the symbol count was there
+
+	// decoder state
+	uint32_t code_;
+	bool exhausted_;		// a byte was missing, no further symbols
+
+	// not copyable
+	ArithStream(const ArithStream&);
+	ArithStream& operator= (const ArithStream&);
+
+	// (encoding) output top byte of low
+	void shiftLow();
+	// (decoding) next byte into the code window, false if none
+	bool nextByte();
+	// code bit with probability p of 0
+	bool encode(bool bit, unsigned short &p);
+	unsigned char decode(unsigned short &p);
+
+public:
+	// plain bitstreams only - no direct bit positions
+	static const bool positional = false;
+
+	// constructor, encoding or decoding of bitstream bs, wide: image over 65535 a side (64-bit symbol count)
+	ArithStream(BitStream &bs, bool encoding, bool wide = false);
+
+	// put one bit in context ctx, return true (success), false (stream full, then closed)
+	bool put(bool bit, unsigned ctx);
+	// put one bit, both values equally likely
+	bool put(bool bit);
+	// get one bit in context ctx and return 1/0/-1 (end of stream)
+	unsigned char get(unsigned ctx);
+	// get one bit, both values equally likely
+	unsigned char get();
+	// finished property
+	bool finished;
+	// "closer" member, flushes the coder & closes the bitstream
+	void performClose();
+	// (encoding) mark the end of a pass in the bitstream, bytes still held by the coder count for the next one
+	void markPass();
+};
+
+#endif
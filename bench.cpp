@@ -0,0 +1,676 @@
+// bench implementation
+#include "bench.h"
+#include "flwt.h"
+#include "colorcodec.h"
+#include "quantimage.h"
+#include "spihtengine.h"
+#include "bspiht.h"
+#include "dspiht.h"
+#include "cspiht.h"
+#include "sweep.h"
+#include "arena.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+
+typedef std::chrono::steady_clock Clock;
+
+// plane sizes of the micro benchmarks
+static const unsigned benchSizes[] = { 256, 512, 1024 };
+// bitplanes the passes are timed at (left out if over the top bitplane of the plane)
+static const int benchBitplanes[] = { 9, 6, 3 };
+// block side & threshold of the maxTest benchmark
+#define BENCH_BLOCK 8
+#define BENCH_THRESHOLD 32
+// defaults of the end-to-end benchmark: image sides, color shifts, rates
+#define BENCH_CODEC_SIZES "512,1024,2048,4096,8192"
+#define BENCH_CODEC_SHIFTS "0,1"
+#define BENCH_CODEC_RATES "0.25,0.5,1"
+// PSNR drop (dB) taken as a regression, changes of the bitstream show up here
+#define BENCH_PSNR_TOLERANCE 0.01
+
+// ns since start
+static double since(Clock::time_point start) {
+	return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+}
+
+// xorshift generator, the same sequence for the same seed
+static unsigned nextRandom(unsigned &state) {
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return state;
+}
+
+// resident set high-water mark of the process (bytes), 0 if unknown
+static size_t peakRss() {
+	std::ifstream status("/proc/self/status");
+	std::string line;
+	while(std::getline(status, line))
+		if(line.compare(0, 6, "VmHWM:") == 0)
+			return (size_t) strtoul(line.c_str() + 6, 0, 10) * 1024;
+	return 0;
+}
+
+// start a new resident set high-water mark (Linux 4.0+), false if not possible
+static bool resetPeakRss() {
+	std::ofstream refs("/proc/self/clear_refs");
+	if(!refs.is_open())
+		return false;
+	refs << "5";
+	refs.close();
+	return !refs.fail();
+}
+
+// codec of an end-to-end configuration
+static ColorCodec * makeCodec(const std::string &coder, Image &image, Arena *arena) {
+	if(coder == "CSPIHT")
+		return new CSpiht(image, arena);
+	if(coder == "DSPIHT")
+		return new DSpiht(image, arena);
+	return new BSpiht(image, arena);
+}
+
+// fields of a CSV line
+static std::vector<std::string> splitLine(const std::string &line) {
+	std::vector<std::string> fields;
+	size_t pos = 0;
+	while(pos <= line.size()) {
+		size_t end = line.find(',', pos);
+		if(end == std::string::npos)
+			end = line.size();
+		fields.push_back(line.substr(pos, end - pos));
+		pos = end + 1;
+	}
+	return fields;
+}
+
+// row key of the end-to-end report: configuration as written in the CSV
+static std::string codecKey(const std::string &coder, const std::string &size, const std::string &levels,
+							const std::string &colorShift, const std::string &bpp) {
+	return coder + "," + size + "," + levels + "," + colorShift + "," + bpp;
+}
+
+// constructor
+Bench::Bench(Settings &sets, WorkerPool &workers) : sets_(sets), workers_(workers) {
+}
+
+// name of a kind
+const char * Bench::kindName(Kind kind) {
+	if(kind == kindNoise)
+		return "noise";
+	if(kind == kindFlat)
+		return "flat";
+	return "natural";
+}
+
+// synthetic RGB image
+// natural: smooth waves & a ramp, a few flat objects with sharp edges and a little grain
+// noise: uniform 0..255; flat: one value per plane
+void Bench::synthesize(Image &image, unsigned width, unsigned height, Kind kind, unsigned seed) {
+	image.clear(width, height);
+	unsigned state = seed * 2654435761u + 1;
+
+	// objects of the natural image: rectangles with their own level
+	const unsigned objects = 6;
+	unsigned ox[objects], oy[objects], ow[objects], oh[objects];
+	int level[objects];
+	for(unsigned o = 0; o < objects; ++o) {
+		ox[o] = nextRandom(state) % width;
+		oy[o] = nextRandom(state) % height;
+		ow[o] = width / 8 + nextRandom(state) % (width / 3);
+		oh[o] = height / 8 + nextRandom(state) % (height / 3);
+		level[o] = (int) (nextRandom(state) % 121) - 60;
+	}
+
+	const double pi = 3.14159265358979;
+	for(unsigned p = 0; p < 3; ++p) {
+		double phase = p * 0.7 + (seed % 16) * 0.3;
+		for(unsigned j = 0; j < height; ++j)
+			for(unsigned i = 0; i < width; ++i) {
+				double v;
+				if(kind == kindNoise) {
+					v = nextRandom(state) & 255;
+				} else if(kind == kindFlat) {
+					v = 100 + 20 * p;
+				} else {
+					double x = (double) i / width;
+					double yy = (double) j / height;
+					v = 128.0 + 50.0 * sin(2 * pi * 3 * x + phase) * cos(2 * pi * 2 * yy + phase)
+						+ 20.0 * sin(2 * pi * 11 * (x + yy)) + 40.0 * (x - yy);
+					for(unsigned o = 0; o < objects; ++o)
+						if(i >= ox[o] && i < ox[o] + ow[o] && j >= oy[o] && j < oy[o] + oh[o])
+							v += level[o];
+					v += (int) (nextRandom(state) % 9) - 4;
+				}
+				image(i, j, (planeVal) p) = (v < 0.0) ? 0.0 : (v > 255.0) ? 255.0 : floor(v);
+			}
+	}
+}
+
+// statistics of the measured runs
+void Bench::addResult(const std::string &name, unsigned size, Kind kind, double coefs, std::vector<double> &samples) {
+	Result r;
+	r.name = name;
+	r.size = size;
+	r.kind = kind;
+	r.reps = (unsigned) samples.size();
+
+	for(size_t i = 0; i < samples.size(); ++i)
+		samples[i] /= coefs;
+	std::sort(samples.begin(), samples.end());
+	r.min = samples.front();
+	r.median = (samples.size() % 2) ? samples[samples.size() / 2]
+									: (samples[samples.size() / 2 - 1] + samples[samples.size() / 2]) / 2.0;
+	double sum = 0.0;
+	for(size_t i = 0; i < samples.size(); ++i)
+		sum += samples[i];
+	r.mean = sum / samples.size();
+	double squares = 0.0;
+	for(size_t i = 0; i < samples.size(); ++i)
+		squares += (samples[i] - r.mean) * (samples[i] - r.mean);
+	r.deviation = (samples.size() > 1) ? sqrt(squares / (samples.size() - 1)) : 0.0;
+	results_.push_back(r);
+
+	std::ostringstream plane;
+	plane << size << "x" << size << " " << kindName(kind);
+	std::cout << std::left << std::setw(34) << name << std::setw(18) << plane.str() << std::right << std::fixed << std::setprecision(3)
+			  << std::setw(10) << r.min << std::setw(10) << r.median << std::setw(10) << r.mean << std::setw(10) << r.deviation << std::endl;
+}
+
+// row & column lifting steps, full plane (first level)
+void Bench::benchTransform(const Image &pixels, unsigned size, Kind kind) {
+	Matrix<wUnit> plane;
+	wUnit *tempbank = new wUnit[size];
+	double coefs = (double) size * size;
+
+	for(unsigned t = 0; t < 4; ++t) {
+		std::vector<double> samples;
+		for(unsigned r = 0; r < BENCH_WARMUP + BENCH_REPS; ++r) {
+			plane = pixels.getMatrix(y);
+			Clock::time_point start = Clock::now();
+			if(t == 0)
+				Flwt::rowTransformF(plane, size, size, tempbank);
+			else if(t == 1)
+				Flwt::columnTransformF(plane, size, size, tempbank);
+			else if(t == 2)
+				Flwt::rowTransformI(plane, size, size, tempbank);
+			else
+				Flwt::columnTransformI(plane, size, size, tempbank);
+			double ns = since(start);
+			if(r >= BENCH_WARMUP)
+				samples.push_back(ns);
+		}
+		const char *names[] = { "Flwt::rowTransformF", "Flwt::columnTransformF", "Flwt::rowTransformI", "Flwt::columnTransformI" };
+		addResult(names[t], size, kind, coefs, samples);
+	}
+
+	delete []tempbank;
+}
+
+// one bit per coefficient: lowest bit of the luma pixels
+void Bench::benchBitStream(const Image &pixels, unsigned size, Kind kind) {
+	unsigned count = size * size;
+	std::vector<unsigned char> bits(count);
+	for(unsigned j = 0; j < size; ++j)
+		for(unsigned i = 0; i < size; ++i)
+			bits[j * size + i] = ((int) pixels(i, j, y)) & 1;
+
+	std::vector<double> samplesPut, samplesGet;
+	unsigned ones = 0;
+	for(unsigned r = 0; r < BENCH_WARMUP + BENCH_REPS; ++r) {
+		ColorCodec::DataGroup::BitStream bs(0, count, 0);
+		Clock::time_point start = Clock::now();
+		for(unsigned i = 0; i < count; ++i)
+			bs.put(bits[i] != 0);
+		double ns = since(start);
+		if(r >= BENCH_WARMUP)
+			samplesPut.push_back(ns);
+
+		bs.performClose();
+		start = Clock::now();
+		for(unsigned i = 0; i < count; ++i)
+			ones += bs.get();
+		ns = since(start);
+		if(r >= BENCH_WARMUP)
+			samplesGet.push_back(ns);
+	}
+	if(ones == 0xFFFFFFFF)
+		std::cout << std::endl;
+
+	addResult("BitStream::put", size, kind, count, samplesPut);
+	addResult("BitStream::get", size, kind, count, samplesGet);
+}
+
+// maxTest over all aligned blocks & the variance split of the transformed luma plane
+void Bench::benchSignificance(const Image &transformed, unsigned size, Kind kind) {
+	QuantImage coefs;
+	coefs.quantize(transformed, y);
+	unsigned n = 0;
+	while((2u << n) <= BENCH_THRESHOLD)
+		++n;
+
+	Settings sets = sets_;
+	sets.varianceDepth = sets.levels;
+
+	std::vector<double> samples[3];
+	unsigned hits = 0;
+	double variance = 0.0;
+	for(unsigned r = 0; r < BENCH_WARMUP + BENCH_REPS; ++r) {
+		Clock::time_point start = Clock::now();
+		for(unsigned j = 0; j < size; j += BENCH_BLOCK)
+			for(unsigned i = 0; i < size; i += BENCH_BLOCK)
+				hits += transformed.maxTest(i, j, BENCH_BLOCK, y, BENCH_THRESHOLD);
+		double ns = since(start);
+		if(r >= BENCH_WARMUP)
+			samples[0].push_back(ns);
+
+		start = Clock::now();
+		for(unsigned j = 0; j < size; j += BENCH_BLOCK)
+			for(unsigned i = 0; i < size; i += BENCH_BLOCK)
+				hits += coefs.maxTest(i, j, BENCH_BLOCK, y, n);
+		ns = since(start);
+		if(r >= BENCH_WARMUP)
+			samples[1].push_back(ns);
+
+		start = Clock::now();
+		variance += transformed.computeTotalVariance(sets, y);
+		ns = since(start);
+		if(r >= BENCH_WARMUP)
+			samples[2].push_back(ns);
+	}
+	if(hits == 0xFFFFFFFF || variance < 0.0)
+		std::cout << std::endl;
+
+	double coefsCount = (double) size * size;
+	addResult("Image::maxTest", size, kind, coefsCount, samples[0]);
+	addResult("QuantImage::maxTest", size, kind, coefsCount, samples[1]);
+	addResult("Image::computeTotalVariance", size, kind, coefsCount, samples[2]);
+}
+
+// sorting & refinement pass of an encoder at each bitplane of benchBitplanes
+// the passes above it are run (untimed) before each measured run to get the lists of that bitplane
+template <class Topology, template <class> class Storage>
+void Bench::benchPasses(const char *coder, const Image &transformed, unsigned size, Kind kind) {
+	typedef SpihtEngine<Topology, Storage> Engine;
+	unsigned band = size >> sets_.levels;
+	Engine engine;
+	double coefs = (double) size * size * (Engine::Coef::lastPlane(y) - Engine::Coef::firstPlane(y) + 1);
+
+	for(unsigned b = 0; b < sizeof(benchBitplanes) / sizeof(benchBitplanes[0]); ++b) {
+		int n = benchBitplanes[b];
+		std::vector<double> samplesS, samplesR;
+		bool skipped = false;
+		for(unsigned r = 0; r < BENCH_WARMUP + BENCH_REPS && !skipped; ++r) {
+			engine.startEncode(transformed, y, band, band, false, false);
+			if(n > (int) engine.nMax_) {
+				skipped = true;
+				break;
+			}
+			// room for every bit down to this bitplane
+			ColorCodec::DataGroup::BitStream bs(engine.nMax_, 0xFFFFFFFF, sets_.levels);
+			while(engine.n_ > n) {
+				engine.sortingPassC(bs);
+				engine.refinementPassC(bs);
+				engine.n_--; engine.currThr_ >>= 1;
+			}
+
+			Clock::time_point start = Clock::now();
+			engine.sortingPassC(bs);
+			double ns = since(start);
+			if(r >= BENCH_WARMUP)
+				samplesS.push_back(ns);
+
+			start = Clock::now();
+			engine.refinementPassC(bs);
+			ns = since(start);
+			if(r >= BENCH_WARMUP)
+				samplesR.push_back(ns);
+		}
+		if(skipped)
+			continue;
+
+		std::ostringstream name;
+		name << coder << " sortingPassC n=" << n;
+		addResult(name.str(), size, kind, coefs, samplesS);
+		name.str("");
+		name << coder << " refinementPassC n=" << n;
+		addResult(name.str(), size, kind, coefs, samplesR);
+	}
+}
+
+// run all
+bool Bench::runMicro() {
+	std::cout << "Micro benchmarks: " << BENCH_WARMUP << " warm-up + " << BENCH_REPS << " measured runs each, "
+			  << sets_.levels << "-level WT, ns per coefficient." << std::endl;
+	std::cout << std::left << std::setw(34) << "benchmark" << std::setw(18) << "plane" << std::right
+			  << std::setw(10) << "min" << std::setw(10) << "median" << std::setw(10) << "mean" << std::setw(10) << "dev" << std::endl;
+
+	for(unsigned s = 0; s < sizeof(benchSizes) / sizeof(benchSizes[0]); ++s) {
+		unsigned size = benchSizes[s];
+		if((size >> sets_.levels) < 2) {
+			std::cout << "Bench: " << size << "x" << size << " left out, too small for " << sets_.levels << " levels." << std::endl;
+			continue;
+		}
+		for(unsigned k = 0; k < 3; ++k) {
+			Kind kind = (Kind) k;
+			Image pixels;
+			synthesize(pixels, size, size, kind, s * 3 + k + 1);
+			pixels.transformRGB2YCbCr();
+			pixels.substract128();
+
+			Image transformed(pixels);
+			for(unsigned p = 0; p < 3; ++p)
+				Flwt::forward(sets_.levels, transformed.getMatrix((planeVal) p));
+
+			benchTransform(pixels, size, kind);
+			benchBitStream(pixels, size, kind);
+			benchSignificance(transformed, size, kind);
+			benchPasses<RegularTree, ListStorage>("BSPIHT", transformed, size, kind);
+			benchPasses<RegularTree, ArrayStorage>("LSPIHT", transformed, size, kind);
+			benchPasses<DegradedTree, ListStorage>("DSPIHT", transformed, size, kind);
+			benchPasses<CrossPlaneTree, ListStorage>("CSPIHT", transformed, size, kind);
+		}
+	}
+
+	if(sets_.reportFile.empty())
+		return true;
+	return writeReport();
+}
+
+// CSV report
+bool Bench::writeReport() const {
+	std::ofstream file;
+	file.open(sets_.reportFile.c_str());
+	if(!file.is_open()) {
+		std::cout << "Can't write to file \"" << sets_.reportFile << "\"" << std::endl;
+		return false;
+	}
+
+	file << "benchmark,size,kind,reps,minNs,medianNs,meanNs,deviationNs" << std::endl;
+	for(size_t i = 0; i < results_.size(); ++i) {
+		const Result &r = results_[i];
+		file << r.name << "," << r.size << "," << kindName(r.kind) << "," << r.reps << "," << std::fixed << std::setprecision(4)
+			 << r.min << "," << r.median << "," << r.mean << "," << r.deviation << std::endl;
+	}
+
+	file.close();
+	std::cout << "Report saved to file \"" << sets_.reportFile << "\"... OK" << std::endl;
+	return true;
+}
+
+// end-to-end benchmark
+bool Bench::runCodec() {
+	std::vector<double> sizes, shifts, rates;
+	if(!Sweep::parseList(sets_.sizeList.empty() ? BENCH_CODEC_SIZES : sets_.sizeList, sizes)
+		|| !Sweep::parseList(sets_.shiftList.empty() ? BENCH_CODEC_SHIFTS : sets_.shiftList, shifts)
+		|| !Sweep::parseList(sets_.bppList.empty() ? BENCH_CODEC_RATES : sets_.bppList, rates)) {
+		std::cout << "Bench: --sizes, -S and -p take comma separated lists of numbers." << std::endl;
+		return false;
+	}
+	if(!resetPeakRss())
+		std::cout << "Bench: peak RSS can't be reset per run, the process high-water mark is reported." << std::endl;
+
+	std::cout << "End-to-end benchmark: " << sets_.levels << "-level WT, " << workers_.getThreads() << " threads, fastest of "
+			  << BENCH_CODEC_REPS << " runs." << std::endl;
+	std::cout << std::left << std::setw(8) << "coder" << std::right << std::setw(6) << "size" << std::setw(4) << "S" << std::setw(7) << "bpp"
+			  << std::setw(10) << "enc MP/s" << std::setw(10) << "dec MP/s" << std::setw(9) << "PSNR Y" << std::setw(9) << "PSNR C"
+			  << std::setw(10) << "RSS MB" << std::setw(10) << "arena MB" << std::setw(10) << "blocks" << std::endl;
+
+	unsigned maxShift = 0;
+	for(size_t sh = 0; sh < shifts.size(); ++sh)
+		maxShift = std::max(maxShift, (unsigned) shifts[sh]);
+
+	const char *coders[] = { "BSPIHT", "DSPIHT", "CSPIHT" };
+	bool failed = false;
+	for(size_t s = 0; s < sizes.size(); ++s) {
+		unsigned size = (unsigned) sizes[s];
+		if(size > 65535 || (size >> (sets_.levels + maxShift)) < 2) {
+			std::cout << "Bench: " << size << "x" << size << " left out, wrong size for " << sets_.levels << " levels." << std::endl;
+			continue;
+		}
+
+		// corpus image & its YCbCr form (PSNR reference)
+		Image original;
+		synthesize(original, size, size, kindNatural, (unsigned) s + 1);
+		Image reference(original);
+		reference.transformRGB2YCbCr();
+
+		for(unsigned c = 0; c < 3; ++c)
+			for(size_t sh = 0; sh < shifts.size(); ++sh) {
+				// CSPIHT codes all planes at the same level
+				if(c == 2 && sh > 0)
+					continue;
+				for(size_t r = 0; r < rates.size(); ++r) {
+					CodecResult job;
+					job.coder = coders[c];
+					job.size = size;
+					job.levels = sets_.levels;
+					job.colorShift = (c == 2) ? 0 : (unsigned) shifts[sh];
+					job.bpp = rates[r];
+					job.bits = (bitCount) ceil(rates[r] * size * size * 3.0);
+					runCodecJob(job, original, reference);
+
+					std::cout << std::left << std::setw(8) << job.coder << std::right << std::setw(6) << job.size << std::setw(4) << job.colorShift
+							  << std::setw(7) << std::fixed << std::setprecision(3) << job.bpp;
+					if(!job.done) {
+						std::cout << "  failed" << std::endl;
+						failed = true;
+						continue;
+					}
+					double pixels = (double) size * size / 1e6;
+					std::cout << std::setprecision(2) << std::setw(10) << pixels / job.timeEncoding << std::setw(10) << pixels / job.timeDecoding
+							  << std::setw(9) << job.psnrY << std::setw(9) << job.psnrC
+							  << std::setw(10) << job.peakRss / 1048576.0 << std::setw(10) << job.highWater / 1048576.0 << std::setw(10) << job.blocks << std::endl;
+					codecResults_.push_back(job);
+				}
+			}
+	}
+
+	if(!sets_.reportFile.empty() && !writeCodecReport())
+		failed = true;
+	if(!sets_.benchBaseline.empty() && !compareBaseline())
+		failed = true;
+	return !failed;
+}
+
+// one configuration through the whole pipeline of codec.cpp, pixels in memory (no BMP / bitstream files)
+void Bench::runCodecJob(CodecResult &job, const Image &original, const Image &reference) {
+	Settings sets = sets_;
+	sets.levels = job.levels;
+	sets.colorShift = job.colorShift;
+	sets.bits = job.bits;
+	sets.bpp = (float) job.bpp;
+	sets.cspihtFlag = job.coder == "CSPIHT";
+	sets.dspihtFlag = job.coder == "DSPIHT";
+	sets.speckFlag = false;
+	sets.fixedStateFlag = false;
+	sets.printExtended = false;
+	sets.printTiming = false;
+	sets.printDebug = false;
+	bool deep = sets.computeDeepVariance && sets.colorShift > 0 && !sets.cspihtFlag;
+
+	job.done = false;
+	for(unsigned rep = 0; rep < BENCH_CODEC_REPS; ++rep) {
+		Arena arena;
+		resetPeakRss();
+		Image work, decoded;
+		work.setArena(&arena);
+		decoded.setArena(&arena);
+		work = original;
+		ColorCodec *encoder = 0;
+		ColorCodec *decoder = 0;
+
+		try {
+			// pixels to bitstream
+			Clock::time_point start = Clock::now();
+			work.transformRGB2YCbCr();
+			work.substract128();
+			for(unsigned p = 0; p < 3; p ++)
+				Flwt::forward((deep && p > 0) ? sets.levels + sets.colorShift : sets.levels, work.getMatrix((planeVal) p), &arena);
+			encoder = makeCodec(job.coder, work, &arena);
+			if(sets.threads > 1)
+				encoder->setWorkers(&workers_);
+			encoder->encode(sets);
+			double encoding = since(start) / 1e9;
+			job.bitsOut = encoder->getBitCount();
+
+			// bitstream to pixels
+			decoder = makeCodec(job.coder, decoded, &arena);
+			decoder->takeBitStream(*encoder);
+			if(sets.threads > 1)
+				decoder->setWorkers(&workers_);
+			start = Clock::now();
+			// the whole streams just coded (the per-plane ceil may put them over sets.bits)
+			decoder->decode(sets, 0);
+			for(unsigned p = 0; p < 3; p ++) {
+				unsigned level = sets.levels;
+				if(p > 0 && sets.colorShift > 0 && !sets.cspihtFlag)
+					level += sets.colorShift;
+				Flwt::inverse(level, decoded.getMatrix((planeVal) p), &arena);
+			}
+			decoded.add128();
+			double decoding = since(start) / 1e9;
+
+			// PSNR on YCbCr as codec.cpp does, then back to RGB
+			job.psnrY = decoded.getLummaDifferencePSNR(reference);
+			job.psnrC = decoded.getChromaDifferencePSNR(reference);
+			start = Clock::now();
+			decoded.transformYCbCr2RGB();
+			decoding += since(start) / 1e9;
+
+			if(rep == 0 || encoding < job.timeEncoding)
+				job.timeEncoding = encoding;
+			if(rep == 0 || decoding < job.timeDecoding)
+				job.timeDecoding = decoding;
+			job.done = true;
+		}
+
+		catch(...) {
+			job.done = false;
+		}
+
+		delete decoder;
+		delete encoder;
+		job.peakRss = peakRss();
+		job.highWater = arena.getHighWater();
+		job.allocated = arena.getAllocated();
+		job.blocks = arena.getBlocks();
+		job.pages = arena.getPages();
+		if(!job.done)
+			return;
+	}
+}
+
+// CSV report of the end-to-end benchmark
+bool Bench::writeCodecReport() const {
+	std::ofstream file;
+	file.open(sets_.reportFile.c_str());
+	if(!file.is_open()) {
+		std::cout << "Can't write to file \"" << sets_.reportFile << "\"" << std::endl;
+		return false;
+	}
+
+	file << "coder,size,levels,colorShift,bpp,bits,bitsOut,encodeSeconds,decodeSeconds,encodeMPs,decodeMPs,psnrY,psnrCbCr,"
+		 << "peakRssBytes,peakBytes,allocatedBytes,blocks,pages" << std::endl;
+	for(size_t i = 0; i < codecResults_.size(); ++i) {
+		const CodecResult &job = codecResults_[i];
+		double pixels = (double) job.size * job.size / 1e6;
+		file << job.coder << "," << job.size << "," << job.levels << "," << job.colorShift << ","
+			 << std::fixed << std::setprecision(4) << job.bpp << "," << job.bits << "," << job.bitsOut << ","
+			 << std::setprecision(6) << job.timeEncoding << "," << job.timeDecoding << ","
+			 << std::setprecision(3) << pixels / job.timeEncoding << "," << pixels / job.timeDecoding << ","
+			 << std::setprecision(2) << job.psnrY << "," << job.psnrC << ","
+			 << job.peakRss << "," << job.highWater << "," << job.allocated << "," << job.blocks << "," << job.pages << std::endl;
+	}
+
+	file.close();
+	std::cout << "Report saved to file \"" << sets_.reportFile << "\"... OK" << std::endl;
+	return true;
+}
+
+// compare with the baseline report
+// throughput lower or memory higher by more than the threshold, PSNR lower by more than BENCH_PSNR_TOLERANCE is a regression
+bool Bench::compareBaseline() const {
+	std::ifstream file(sets_.benchBaseline.c_str());
+	std::string line;
+	if(!file.is_open() || !std::getline(file, line)) {
+		std::cout << "Can't read baseline file \"" << sets_.benchBaseline << "\"" << std::endl;
+		return false;
+	}
+
+	// columns by name
+	const char *names[] = { "coder", "size", "levels", "colorShift", "bpp", "encodeMPs", "decodeMPs", "psnrY", "psnrCbCr", "peakRssBytes", "peakBytes" };
+	const unsigned columns = sizeof(names) / sizeof(names[0]);
+	std::vector<std::string> header = splitLine(line);
+	size_t index[columns];
+	for(unsigned c = 0; c < columns; ++c) {
+		index[c] = std::find(header.begin(), header.end(), names[c]) - header.begin();
+		if(index[c] == header.size()) {
+			std::cout << "Baseline file \"" << sets_.benchBaseline << "\" has no column " << names[c] << "." << std::endl;
+			return false;
+		}
+	}
+
+	// our rows by key
+	std::vector<std::string> keys;
+	for(size_t i = 0; i < codecResults_.size(); ++i) {
+		const CodecResult &job = codecResults_[i];
+		std::ostringstream bpp;
+		bpp << std::fixed << std::setprecision(4) << job.bpp;
+		keys.push_back(codecKey(job.coder, std::to_string(job.size), std::to_string(job.levels), std::to_string(job.colorShift), bpp.str()));
+	}
+
+	double limit = sets_.regressPercent / 100.0;
+	unsigned compared = 0, regressions = 0;
+	std::cout << "Compared with baseline \"" << sets_.benchBaseline << "\" (threshold " << std::setprecision(1) << sets_.regressPercent << "%):" << std::endl;
+	while(std::getline(file, line)) {
+		std::vector<std::string> f = splitLine(line);
+		if(f.size() < header.size())
+			continue;
+		std::string key = codecKey(f[index[0]], f[index[1]], f[index[2]], f[index[3]], f[index[4]]);
+		size_t i = std::find(keys.begin(), keys.end(), key) - keys.begin();
+		if(i == keys.size())
+			continue;
+		const CodecResult &job = codecResults_[i];
+		++compared;
+
+		double pixels = (double) job.size * job.size / 1e6;
+		double encBase = atof(f[index[5]].c_str()), decBase = atof(f[index[6]].c_str());
+		double psnrYBase = atof(f[index[7]].c_str()), psnrCBase = atof(f[index[8]].c_str());
+		double rssBase = atof(f[index[9]].c_str()), arenaBase = atof(f[index[10]].c_str());
+		double enc = pixels / job.timeEncoding, dec = pixels / job.timeDecoding;
+
+		std::string worse;
+		if(enc < encBase * (1.0 - limit))
+			worse += " encoding";
+		if(dec < decBase * (1.0 - limit))
+			worse += " decoding";
+		if(job.psnrY < psnrYBase - BENCH_PSNR_TOLERANCE || job.psnrC < psnrCBase - BENCH_PSNR_TOLERANCE)
+			worse += " PSNR";
+		if(rssBase > 0.0 && job.peakRss > 0 && job.peakRss > rssBase * (1.0 + limit))
+			worse += " RSS";
+		if(job.highWater > arenaBase * (1.0 + limit))
+			worse += " arena";
+		if(!worse.empty())
+			++regressions;
+
+		std::cout << std::left << std::setw(8) << job.coder << std::right << std::setw(6) << job.size << std::setw(4) << job.colorShift
+				  << std::setw(7) << std::setprecision(3) << job.bpp << std::setprecision(1)
+				  << "  enc " << std::showpos << (encBase > 0.0 ? (enc / encBase - 1.0) * 100.0 : 0.0) << "%"
+				  << ", dec " << (decBase > 0.0 ? (dec / decBase - 1.0) * 100.0 : 0.0) << "%"
+				  << ", PSNR Y " << std::setprecision(2) << job.psnrY - psnrYBase << "dB"
+				  << ", arena " << std::setprecision(1) << (arenaBase > 0.0 ? (job.highWater / arenaBase - 1.0) * 100.0 : 0.0) << "%" << std::noshowpos;
+		if(!worse.empty())
+			std::cout << "  REGRESSION:" << worse;
+		std::cout << std::endl;
+	}
+
+	std::cout << compared << " of " << codecResults_.size() << " configurations compared, " << regressions << " regressions." << std::endl;
+	return regressions == 0;
+}
@@ -0,0 +1,110 @@
+// bench: micro benchmarks of the transform, bitstream, significance tests and coding passes,
+// end-to-end benchmark of the coders with a baseline check
+#ifndef BENCH_H
+#define BENCH_H
+
+#include "settings.h"
+#include "image.h"
+#include "workerpool.h"
+#include <vector>
+#include <string>
+
+// untimed runs before the measured ones & measured runs of each benchmark
+#define BENCH_WARMUP 1
+#define BENCH_REPS 5
+// runs of each end-to-end configuration, the fastest one counts
+#define BENCH_CODEC_REPS 3
+
+// class Bench
+// generates synthetic planes (natural-image-like, noise, flat) of several sizes and times
+// the row / column lifting steps of the WT (forward & inverse), BitStream put / get,
+// Image & QuantImage maxTest, computeTotalVariance and the sorting & refinement passes of the
+// BSPIHT, LSPIHT, DSPIHT and CSPIHT encoders at fixed bitplanes, each on its own
+// results are ns per coefficient: min, median, mean and deviation of the measured runs,
+// printed and (with -R) saved as CSV; runs single threaded
+// end-to-end: a natural-like image of each size goes through the pipeline of codec.cpp
+// (color transform, forward WT, encode, decode, inverse WT, color transform back) by BSPIHT, DSPIHT and CSPIHT
+// at each rate and color shift; MP/s of encoding & decoding, peak RSS, arena use & PSNR, printed and saved
+// as CSV (-R), which is also the baseline format: the run is compared with a saved one row by row
+class Bench {
+public:
+	// statistics of a synthetic plane
+	enum Kind { kindNatural = 0, kindNoise, kindFlat };
+
+	// one benchmark on one plane
+	struct Result {
+		std::string name;
+		unsigned size;			// plane is size x size
+		Kind kind;
+		unsigned reps;
+		double min;				// ns per coefficient
+		double median;
+		double mean;
+		double deviation;
+	};
+
+	// one end-to-end configuration
+	struct CodecResult {
+		std::string coder;
+		unsigned size;
+		unsigned levels;
+		unsigned colorShift;
+		double bpp;
+		bitCount bits;			// budget
+		bitCount bitsOut;		// bits in the bitstream
+		double timeEncoding;	// pixels to bitstream (s)
+		double timeDecoding;	// bitstream to pixels (s)
+		double psnrY;
+		double psnrC;
+		size_t peakRss;			// resident set high-water mark of the run (bytes, 0 if unknown)
+		size_t highWater;		// arena high-water mark (bytes)
+		size_t allocated;		// arena bytes handed out
+		size_t blocks;			// arena blocks handed out
+		size_t pages;			// arena pages taken from the heap
+		bool done;
+	};
+
+private:
+	Settings &sets_;
+	WorkerPool &workers_;
+	std::vector<Result> results_;
+	std::vector<CodecResult> codecResults_;
+
+	// not copyable
+	Bench(const Bench&);
+	Bench& operator= (const Bench&);
+
+	// statistics of the measured runs (ns each) over coefs coefficients, printed & kept
+	void addResult(const std::string &name, unsigned size, Kind kind, double coefs, std::vector<double> &samples);
+	// groups of benchmarks on an image of given size & kind (pixels, -128 applied)
+	void benchTransform(const Image &pixels, unsigned size, Kind kind);
+	void benchBitStream(const Image &pixels, unsigned size, Kind kind);
+	void benchSignificance(const Image &transformed, unsigned size, Kind kind);
+	template <class Topology, template <class> class Storage>
+	void benchPasses(const char *coder, const Image &transformed, unsigned size, Kind kind);
+	// write the CSV report
+	bool writeReport() const;
+
+	// code & decode one configuration, fills the results
+	void runCodecJob(CodecResult &job, const Image &original, const Image &reference);
+	// write the CSV report of the end-to-end benchmark
+	bool writeCodecReport() const;
+	// compare with the baseline report, false if a row got worse beyond the threshold or it can't be read
+	bool compareBaseline() const;
+
+public:
+	// constructor
+	Bench(Settings &sets, WorkerPool &workers);
+
+	// name of a kind
+	static const char * kindName(Kind kind);
+	// synthetic RGB image, the same for the same arguments
+	static void synthesize(Image &image, unsigned width, unsigned height, Kind kind, unsigned seed);
+
+	// run all micro benchmarks, false if the report can't be written
+	bool runMicro();
+	// run the end-to-end benchmark, false on failed configurations, regressions or unwritable report
+	bool runCodec();
+};
+
+#endif
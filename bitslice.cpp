@@ -0,0 +1,55 @@
+// bitslice implementation
+#include "bitslice.h"
+
+// constructor
+BitSlices::BitSlices() {
+	for(unsigned p=0; p<3; ++p) {
+		words_[p] = 0;
+		tilesW_[p] = 0;
+	}
+}
+
+// draw slices from given arena (0 = heap)
+void BitSlices::setArena(Arena *arena) {
+	for(unsigned p=0; p<3; ++p)
+		slices_[p] = SliceVector(ArenaAllocator<uint64_t>(arena));
+}
+
+// build bitplanes 0..nMax of plane p
+// one 64-bit word of a bitplane is one aligned 8x8 tile, so tiles are
+// gathered into local words for all bitplanes and stored once
+void BitSlices::build(const QuantImage &coefs, planeVal p, unsigned width, unsigned height, unsigned nMax) {
+	tilesW_[p] = ((size_t) width + 7) / 8;
+	words_[p] = tilesW_[p] * (((size_t) height + 7) / 8);
+	slices_[p].assign(words_[p] * (nMax + 1), 0);
+
+	// x,y offsets of the 64 positions of a tile in Z order
+	unsigned char dx[64], dy[64];
+	for(unsigned k=0; k<64; ++k) {
+		dx[k] = (unsigned char) ((k & 1) | ((k >> 1) & 2) | ((k >> 2) & 4));
+		dy[k] = (unsigned char) (((k >> 1) & 1) | ((k >> 2) & 2) | ((k >> 3) & 4));
+	}
+
+	uint64_t acc[8 * sizeof(qUnit)];
+	for(unsigned by=0; by<height; by+=8)
+		for(unsigned bx=0; bx<width; bx+=8) {
+			for(unsigned n=0; n<=nMax; ++n)
+				acc[n] = 0;
+
+			for(unsigned k=0; k<64; ++k) {
+				if(bx + dx[k] >= width || by + dy[k] >= height)
+					continue;
+				qUnit mag = coefs(bx + dx[k], by + dy[k], p);
+				// each set bit goes to its bitplane
+				while(mag) {
+					unsigned n = lowestBit64(mag);
+					acc[n] |= (uint64_t) 1 << k;
+					mag &= mag - 1;
+				}
+			}
+
+			size_t w = word(bx, by, p);
+			for(unsigned n=0; n<=nMax; ++n)
+				slices_[p][n * words_[p] + w] = acc[n];
+		}
+}
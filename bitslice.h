@@ -0,0 +1,54 @@
+// bitslice: bitplanes of the quantized coefficients, packed in coding order
+#ifndef BITSLICE_H
+#define BITSLICE_H
+
+#include "general.h"
+#include "quantimage.h"
+#include "arena.h"
+#include <vector>
+
+// class holds for each plane and each bitplane n = 0..nMax a packed bitmap
+// of coefficients having bit n of the magnitude set
+// one 64-bit word is an aligned 8x8 tile in Z (Morton) order, so 2x2 quads and
+// aligned subtrees of the coding lists up to 8x8 are neighbours in memory;
+// tiles go row by row over the plane, a bitplane takes ceil(w/8) x ceil(h/8) words
+// used by the word-parallel LIP and refinement passes of the encoders
+class BitSlices {
+	typedef std::vector<uint64_t, ArenaAllocator<uint64_t> > SliceVector;
+
+	SliceVector slices_[3];		// bitplane n of plane p starts at n*words_[p]
+	size_t words_[3];			// words per bitplane
+	size_t tilesW_[3];			// tiles in a row of plane p
+
+public:
+	// constructor
+	BitSlices();
+	// draw slices from given arena (0 = heap)
+	void setArena(Arena *arena);
+
+	// build bitplanes 0..nMax of plane p from the quantized magnitudes
+	void build(const QuantImage &coefs, planeVal p, unsigned width, unsigned height, unsigned nMax);
+
+	// word of the tile of coefficient x,y in a bitplane of plane p
+	inline size_t word(unsigned x, unsigned y, planeVal p) const {
+		return (size_t) (y >> 3) * tilesW_[p] + (x >> 3);
+	}
+
+	// Z order position of coefficient x,y in its tile
+	static inline unsigned bit(unsigned x, unsigned y) {
+		return spread(x & 7) | (spread(y & 7) << 1);
+	}
+
+	// bit n of coefficient x,y in plane p
+	inline bool test(unsigned x, unsigned y, planeVal p, unsigned n) const {
+		return (slices_[p][n * words_[p] + word(x, y, p)] >> bit(x, y)) & 1;
+	}
+
+private:
+	// put a zero bit in front of each bit of 3-bit value
+	static inline unsigned spread(unsigned v) {
+		return (v & 1) | ((v & 2) << 1) | ((v & 4) << 2);
+	}
+};
+
+#endif
@@ -10,70 +10,190 @@
 #include "cspiht.h"
 #include "bspiht.h"
 #include "dspiht.h"
+#include "lspiht.h"
+#include "speck.h"
+#include "arena.h"
+#include "workerpool.h"
+#include "coefcache.h"
+#include "sweep.h"
+#include "bench.h"
+#include "trace.h"
+#include "report.h"
+#include "perfcounters.h"
+#include "planestore.h"
+
+// name of the coder chosen by the flags, in the order of priority
+static const char * coderName(const Settings &S) {
+	if(S.cspihtFlag)
+		return "CSPIHT";
+	if(S.dspihtFlag)
+		return "DSPIHT";
+	if(S.speckFlag)
+		return "SPECK";
+	if(S.fixedStateFlag)
+		return "LSPIHT";
+	return "BSPIHT";
+}
 
 int main(int argc, char **argv)
 {
-	// global times
-	double timeEncoding = 0.0;
-	double timeDecoding = 0.0;
-
 	ColorCodec * codec = 0;
 
 	// parse parameters
 	Settings S(argc, argv);
+	// planes over the memory budget go to mapped files (off without -M), paging counted from here
+	PlaneStore::setup(S.memoryBudget, S.mapDir);
+
+	// measurements of the run: PSNR, times, passes (printed, saved with --report)
+	RunReport report;
+	report.image = (S.mode == bitstreamToImage) ? S.bitStreamFile : S.inputImage;
+	report.coder = coderName(S);
+	report.levels = S.levels;
+	report.colorShift = S.colorShift;
+	report.threads = S.threads;
+
+	// SPECK has a plain bitstream only (sweep: the SPECK jobs)
+	if(S.speckFlag && (S.arithFlag || S.runFlag) && (S.mode == imageSweep || report.coder == "SPECK"))
+		std::cout << "SPECK codes plain bitstreams, -a / -z ignored for it." << std::endl;
+
+	// spans of this run (off without -t)
+	if(!S.traceFile.empty())
+		Trace::enable();
+	// hardware counters per stage (off without -H or if the kernel doesn't give them)
+	if(S.perfCounters)
+		PerfCounters::enable();
+
+	// job memory: planes, lists, bitstreams and WT scratch lines
+	Arena arena;
+	// threads for the encoder passes
+	WorkerPool workers(S.threads);
+	// transformed planes of earlier runs (off without -C)
+	CoefCache cache(S.cacheDir);
+
+	// benchmarks: generated images, own report
+	if(S.mode == benchmark) {
+		Bench bench(S, workers);
+		int result = ((S.benchKind == "codec") ? bench.runCodec() : bench.runMicro()) ? 0 : -1;
+		if(!S.traceFile.empty())
+			Trace::save(S.traceFile.c_str());
+		std::cout << "press any key..." << std::endl;
+		_getch();
+		return result;
+	}
+
+	// sweep mode: own loading, coding & report
+	if(S.mode == imageSweep) {
+		Sweep sweep(S, workers);
+		int result = sweep.run() ? 0 : -1;
+		if(PerfCounters::enabled())
+			PerfCounters::print();
+		if(!S.traceFile.empty())
+			Trace::save(S.traceFile.c_str());
+		std::cout << "press any key..." << std::endl;
+		_getch();
+		return result;
+	}
 
 	Image RGB, backup;
+	RGB.setArena(&arena);
+	backup.setArena(&arena);
 
 	unsigned level = S.levels;
 	
 	try {
 	
 		if(S.mode == imageToImage || S.mode == imageToBitstream) {
-			if(RGB.loadBMP(S.inputImage.c_str())) {
+			// levels of the forward WT per plane, chroma temporarily down with deep variance
+			bool deep = S.computeDeepVariance && S.colorShift > 0 && !S.cspihtFlag;
+			unsigned levels[3] = { level, deep ? level+S.colorShift : level, deep ? level+S.colorShift : level };
+
+			// coefficient cache keyed by the image file & levels of the forward WT
+			// (image to image needs the pixels for PSNR, only the WT is skipped)
+			bool cached = false;
+			if(cache.enabled()) {
+				cache.setKey(S.inputImage.c_str(), levels[0], levels[1]);
+				if(S.mode == imageToBitstream)
+					cached = cache.fetch(RGB);
+			}
+
+			// encoding only: the lines go through the forward WT as they are read, no pixel planes
+			bool streamed = !cached && S.mode == imageToBitstream;
+			if(streamed && S.printExtended)
+				for(unsigned p = 0; p < 3; p ++)
+					std::cout << "Performing " << levels[p] << "-level line-based forward WT on plane " << p << " while loading" << std::endl;
+			bool loaded = cached;
+			if(!cached)
+				loaded = streamed ? RGB.loadBMPForward(S.inputImage.c_str(), levels, &arena) : RGB.loadBMP(S.inputImage.c_str());
+
+			if(loaded) {
 				
-				RGB.transformRGB2YCbCr();
+				if(!cached && !streamed)
+					RGB.transformRGB2YCbCr();
 				
 				if(S.mode == imageToImage) {
 					backup = RGB;
+					cached = cache.fetch(RGB);
 				}
 				
-				RGB.substract128();
-			
-				// forward WT
-				for(unsigned p = 0; p < 3; p ++) {
-					Matrix<wUnit>& plane = RGB.getMatrix((planeVal) p);
-					// temporarily down
-					if(S.computeDeepVariance && p > 0 && S.colorShift > 0 && !S.cspihtFlag) {
-						if(S.printExtended)
-							std::cout << "Performing " << level+S.colorShift << "-level forward WT on plane " << p << " (colorShifted +" << S.colorShift <<")...";
-						Flwt::forward(level+S.colorShift, plane);
-					} else {
+				if(!cached && !streamed) {
+					RGB.substract128();
+				
+					// forward WT
+					for(unsigned p = 0; p < 3; p ++) {
+						Matrix<wUnit>& plane = RGB.getMatrix((planeVal) p);
+						// temporarily down
+						if(S.computeDeepVariance && p > 0 && S.colorShift > 0 && !S.cspihtFlag) {
+							if(S.printExtended)
+								std::cout << "Performing " << level+S.colorShift << "-level forward WT on plane " << p << " (colorShifted +" << S.colorShift <<")...";
+							Flwt::forward(level+S.colorShift, plane, &arena);
+						} else {
+							if(S.printExtended)
+								std::cout << "Performing " << level << "-level forward WT on plane " << p << "...";
+							Flwt::forward(level, plane, &arena);
+						}
 						if(S.printExtended)
-							std::cout << "Performing " << level << "-level forward WT on plane " << p << "...";
-						Flwt::forward(level, plane);
+							std::cout << "OK" << std::endl;
+						//RGB.setMatrix(p, plane);
 					}
-					if(S.printExtended)
-						std::cout << "OK" << std::endl;
-					//RGB.setMatrix(p, plane);
 				}
+
+				if(!cached)
+					cache.store(RGB);
 				
 				// bpp conversion
 				if(S.bpp > 0.0) {
-					S.bits = (unsigned) ceil(S.bpp * RGB.getWidth() * RGB.getHeight() * 3.0);
+					S.bits = (uint64_t) ceil(S.bpp * RGB.getWidth() * RGB.getHeight() * 3.0);
 					std::cout << "Desired BPP=" << std::setprecision(2) << S.bpp << " means " << S.bits << "bits (" << std::setprecision(1) << std::fixed 
 							  <<  S.bits/8.0 << "B) for a " << RGB.getWidth() << "x" << RGB.getHeight() << " image." << std::endl;
 				}
 
 				if(S.cspihtFlag)
-					codec = new CSpiht(RGB);
+					codec = new CSpiht(RGB, &arena);
 				else if(S.dspihtFlag)
-					codec = new DSpiht(RGB);
+					codec = new DSpiht(RGB, &arena);
+				else if(S.speckFlag)
+					codec = new Speck(RGB, &arena);
+				else if(S.fixedStateFlag)
+					codec = new LSpiht(RGB, &arena);
 				else
-					codec = new BSpiht(RGB);
+					codec = new BSpiht(RGB, &arena);
 				
+				if(S.threads > 1)
+					codec->setWorkers(&workers);
+
 				// well, isn't this nice :-)
 				codec->encode(S);
-				timeEncoding = codec->getElapsedTime();
+				report.encoded = true;
+				report.timeEncoding = codec->getElapsedTime();
+				report.encoder = codec->getStats();
+				report.bitstreamBits = codec->getBitCount();
+				report.width = RGB.getWidth();
+				report.height = RGB.getHeight();
+
+				if(S.printExtended) {
+					std::cout << "Work counters of the encoder:" << std::endl;
+					codec->getStats().print();
+				}
 				
 				// if save enabled, save
 				if(S.mode == imageToBitstream)
@@ -96,11 +216,15 @@ int main(int argc, char **argv)
 			// perform decode SPIHT
 			if(codec == 0) {
 				if(S.cspihtFlag)
-					codec = new CSpiht(RGB);
+					codec = new CSpiht(RGB, &arena);
 				else if(S.dspihtFlag)
-					codec = new DSpiht(RGB);
+					codec = new DSpiht(RGB, &arena);
+				else if(S.speckFlag)
+					codec = new Speck(RGB, &arena);
+				else if(S.fixedStateFlag)
+					codec = new LSpiht(RGB, &arena);
 				else
-					codec = new BSpiht(RGB);
+					codec = new BSpiht(RGB, &arena);
 			} 
 			
 			if(S.mode == bitstreamToImage) {
@@ -109,14 +233,29 @@ int main(int argc, char **argv)
 			
 			// TODO: customized decoding bit count (aux parameter to decode)
 			if(S.bpp > 0.0 && S.mode == bitstreamToImage) {
-				S.bits = (unsigned) ceil(S.bpp * codec->getImageW() * codec->getImageH() * 3.0);
+				S.bits = (uint64_t) ceil(S.bpp * codec->getImageW() * codec->getImageH() * 3.0);
 				std::cout << "Desired BPP=" << std::setprecision(2) << S.bpp << " means " << S.bits << "bits (" << std::setprecision(1) << std::fixed 
 						  <<  S.bits/8.0 << "B) for a " << codec->getImageW() << "x" << codec->getImageH() << " image." << std::endl;
 			}
 			
 			
-			codec->decode(S, S.bits);	
-			timeDecoding = codec->getElapsedTime();
+			if(S.threads > 1)
+				codec->setWorkers(&workers);
+			// whole bitstream (0) unless -B / -p cut a bitstream file: streams just coded may round a few bits over
+			// S.bits, a file without -B / -p is not cut to the default bits
+			codec->decode(S, (S.mode == bitstreamToImage && S.bitsFlag) ? S.bits : 0);	
+			report.decoded = true;
+			report.timeDecoding = codec->getElapsedTime();
+			report.decoder = codec->getStats();
+			report.width = codec->getImageW();
+			report.height = codec->getImageH();
+			if(S.mode == bitstreamToImage)
+				report.bitstreamBits = codec->getBitCount();
+
+			if(S.printExtended) {
+				std::cout << "Work counters of the decoder:" << std::endl;
+				codec->getStats().print();
+			}
 
 			if(S.printExtended)
 				std::cout << std::endl;
@@ -127,11 +266,11 @@ int main(int argc, char **argv)
 				if(p > 0 && S.colorShift > 0 && !S.cspihtFlag) {
 					if(S.printExtended)
 						std::cout << "Performing " << level+S.colorShift << "-level inverse WT on plane " << p << " (colorShifted +" << S.colorShift <<")...";
-					Flwt::inverse(level+S.colorShift, plane);
+					Flwt::inverse(level+S.colorShift, plane, &arena);
 				} else {
 					if(S.printExtended)
 						std::cout << "Performing " << level << "-level inverse WT on plane " << p << "...";
-					Flwt::inverse(level, plane);
+					Flwt::inverse(level, plane, &arena);
 				}
 				if(S.printExtended)
 					std::cout << "OK" << std::endl;
@@ -142,17 +281,12 @@ int main(int argc, char **argv)
 
 			// compute stuff
 			if(backup.getWidth() == RGB.getWidth() && backup.getHeight() == RGB.getHeight()) {
-				std::cout << std::endl;
-				std::cout << "PSNR difference Y:     " << std::setprecision(2) << RGB.getLummaDifferencePSNR(backup) << "dB" << std::endl;	
-				std::cout << "PSNR difference cB,cR: " << std::setprecision(2) << RGB.getChromaDifferencePSNR(backup) << "dB" << std::endl;	
-				std::cout << std::endl;
+				report.compared = true;
+				report.psnrY = RGB.getLummaDifferencePSNR(backup);
+				report.psnrC = RGB.getChromaDifferencePSNR(backup);
 			}
 
-			if(timeEncoding > 0.0 && S.printTiming)
-				std::cout << "SPIHT CODING time elapsed   (total): " << std::setprecision(8) << timeEncoding << "s" <<  std::endl;
-
-			if(timeDecoding > 0.0 && S.printTiming)
-				std::cout << "SPIHT DECODING time elapsed (total): " << std::setprecision(8) << timeDecoding << "s" <<  std::endl;
+			report.printResults(S.printTiming);
 
 			// save image
 			if(S.printExtended)
@@ -168,6 +302,28 @@ int main(int argc, char **argv)
 		std::cout << "Exception occured. Program is now being terminated..." << std::endl;
 	}
 
+	report.bits = (S.mode == bitstreamToImage && !S.bitsFlag) ? report.bitstreamBits : S.bits;
+	report.bpp = (report.width > 0) ? report.bits / ((double) report.width * report.height * 3.0) : 0.0;
+	report.highWater = arena.getHighWater();
+	report.reserved = arena.getReserved();
+	report.paging = PlaneStore::stats();
+	if(S.printExtended) {
+		std::cout << "Job memory high-water mark: " << report.highWater << "B (" 
+				  << report.reserved << "B reserved in pages)" << std::endl;
+		PlaneStore::print();
+	}
+
+	if(PerfCounters::enabled()) {
+		report.perf = PerfCounters::stages();
+		PerfCounters::print();
+	}
+
+	if(!S.runReportFile.empty())
+		report.save(S.runReportFile, S.runReportCSV ? RunReport::formatCSV : RunReport::formatJSON);
+
+	if(!S.traceFile.empty())
+		Trace::save(S.traceFile.c_str());
+
 	std::cout << "press any key..." << std::endl;
 	_getch();
 	
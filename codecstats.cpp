@@ -0,0 +1,103 @@
+// codecstats implementation
+#include "codecstats.h"
+#include <iostream>
+#include <iomanip>
+
+// constructor
+PassStats::PassStats() {
+	clear();
+}
+
+// all zero
+void PassStats::clear() {
+	step = 0;
+	finished = false;
+	sortingBits = refinementBits = 0;
+	lisSize = lipSize = lspSize = 0;
+	seconds = 0.0;
+	lipVisits = lisVisits = lspRefined = 0;
+	maxTests = coefsScanned = 0;
+	expandedA = expandedB = 0;
+	insertions = erasures = 0;
+	bytesAllocated = 0;
+}
+
+// sum
+PassStats& PassStats::operator+= (const PassStats &other) {
+	step = other.step;
+	finished = other.finished;
+	sortingBits += other.sortingBits;
+	refinementBits += other.refinementBits;
+	lisSize = other.lisSize;
+	lipSize = other.lipSize;
+	lspSize = other.lspSize;
+	seconds += other.seconds;
+	lipVisits += other.lipVisits;
+	lisVisits += other.lisVisits;
+	lspRefined += other.lspRefined;
+	maxTests += other.maxTests;
+	coefsScanned += other.coefsScanned;
+	expandedA += other.expandedA;
+	expandedB += other.expandedB;
+	insertions += other.insertions;
+	erasures += other.erasures;
+	bytesAllocated += other.bytesAllocated;
+	return *this;
+}
+
+// progress line
+void PassStats::print(bool lip) const {
+	std::cout << ((finished)?"F":"S") << std::setw(2) << step <<  ", bits="
+		  << std::setw(6) << sortingBits << "sp + " << std::setw(6) << refinementBits << "rp ("
+		  << std::setw(7) << std::setprecision(1) << std::fixed << (double) (sortingBits+refinementBits) / 8.0 << "B) | "
+		  << "LIS: " << std::setw(5) << lisSize;
+	if(lip)
+		std::cout <<  ", LIP: " << std::setw(5) << lipSize;
+	std::cout << ", LSP: " << std::setw(5) << lspSize << '\n';
+}
+
+// constructor
+CoderStats::CoderStats() {
+	clear();
+}
+
+// forget all passes
+void CoderStats::clear() {
+	for(unsigned p = 0; p < 3; ++p) {
+		planes[p].clear();
+		variance[p] = 0.0;
+		planeBits[p] = 0;
+	}
+}
+
+// sum of the passes of plane p
+PassStats CoderStats::plane(unsigned p) const {
+	PassStats sum;
+	for(size_t i = 0; i < planes[p].size(); ++i)
+		sum += planes[p][i];
+	return sum;
+}
+
+// sum of all
+PassStats CoderStats::total() const {
+	PassStats sum;
+	for(unsigned p = 0; p < 3; ++p)
+		sum += plane(p);
+	return sum;
+}
+
+// per plane sums and the total
+void CoderStats::print() const {
+	for(unsigned p = 0; p < 4; ++p) {
+		if(p < 3 && planes[p].empty())
+			continue;
+		PassStats s = (p < 3) ? plane(p) : total();
+		if(p < 3)
+			std::cout << "Plane " << p << " (" << std::setw(2) << planes[p].size() << " passes): ";
+		else
+			std::cout << "Total:                ";
+		std::cout << "LIP " << s.lipVisits << ", LIS " << s.lisVisits << " (split " << s.expandedA << "A + " << s.expandedB << "B)"
+				  << ", LSP " << s.lspRefined << " | tests " << s.maxTests << " on " << s.coefsScanned << " coefs"
+				  << " | +" << s.insertions << " -" << s.erasures << " entries, " << s.bytesAllocated << "B" << std::endl;
+	}
+}
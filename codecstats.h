@@ -0,0 +1,82 @@
+// codecstats: work counters of the coders, per plane and pass
+#ifndef CODECSTATS_H
+#define CODECSTATS_H
+
+#include <vector>
+#include <cstddef>
+#include <stdint.h>
+
+// compile with SPIHT_NO_STATS defined to leave out all counting (bits, list sizes & times of the steps stay)
+#if defined(SPIHT_NO_STATS)
+#define CODER_COUNT(counter, value)
+#else
+#define CODER_COUNT(counter, value) ((counter) += (value))
+#endif
+
+// one step (sorting & refinement pass) of a plane: output and work
+// lists without a meaning for a coder stay 0 (SPECK: LIP, typeA = S sets, typeB = I set)
+struct PassStats {
+	unsigned step;				// 1 = first (highest bitplane)
+	bool finished;				// bitstream got full / exhausted in this step
+	uint64_t sortingBits;		// bits of the sorting pass
+	uint64_t refinementBits;	// bits of the refinement pass
+	size_t lisSize;				// list sizes after the step
+	size_t lipSize;
+	size_t lspSize;
+	double seconds;				// time of the passes
+
+	uint64_t lipVisits;			// LIP entries tested (word-parallel & zero-run passes count whole runs)
+	uint64_t lisVisits;			// LIS entries tested
+	uint64_t lspRefined;		// LSP entries refined
+	uint64_t maxTests;			// set significance tests on the coefficients (maxTest / orRange calls)
+	uint64_t coefsScanned;		// coefficients compared by them
+	uint64_t expandedA;			// significant LIS entries partitioned, typeA
+	uint64_t expandedB;			// significant LIS entries partitioned, typeB
+	uint64_t insertions;		// entries added to the lists
+	uint64_t erasures;			// entries removed from LIP & LIS
+	uint64_t bytesAllocated;	// job memory handed out (arena only, heap is not counted)
+
+	PassStats();
+	void clear();
+	// sum of bits, times & counters, step, state & list sizes of the later one
+	PassStats& operator+= (const PassStats &other);
+	// progress line of -E, lip: coder has a LIP
+	void print(bool lip) const;
+};
+
+// set significance tests of the calling thread, coders take the difference over a pass
+// (tests of the encoder workers are summed back by the engine)
+struct ScanTally {
+	uint64_t tests;
+	uint64_t coefs;
+};
+// tally of the calling thread
+inline ScanTally& scanTally() {
+	static thread_local ScanTally tally = { 0, 0 };
+	return tally;
+}
+
+// class CoderStats
+// figures of the last encode / decode: passes of planes y, cB, cR (CSPIHT: all in plane y)
+class CoderStats {
+public:
+	std::vector<PassStats> planes[3];
+	// (encoding) total variance the bits were split by, biased for chroma
+	double variance[3];
+	// bits given to each plane
+	uint64_t planeBits[3];
+
+	// constructor
+	CoderStats();
+
+	// forget all passes
+	void clear();
+	// sum of the passes of plane p
+	PassStats plane(unsigned p) const;
+	// sum of all
+	PassStats total() const;
+	// work counters: per plane sums and the total, one line each
+	void print() const;
+};
+
+#endif
@@ -0,0 +1,318 @@
+// coefcache implementation
+#include "coefcache.h"
+#include <cstdio>
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <algorithm>
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <utime.h>
+#endif
+
+// read-only mapping of a whole file
+// Win32 file mapping or POSIX mmap
+class MappedFile {
+	const char *data_;
+	uint64_t size_;
+#if defined(_WIN32)
+	HANDLE file_;
+	HANDLE map_;
+#else
+	int file_;
+#endif
+
+	// not copyable
+	MappedFile(const MappedFile&);
+	MappedFile& operator= (const MappedFile&);
+
+public:
+	// maps the file, data() is 0 if it can't be mapped
+	explicit MappedFile(const char *filename) : data_(0), size_(0) {
+#if defined(_WIN32)
+		map_ = 0;
+		file_ = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+		if(file_ == INVALID_HANDLE_VALUE)
+			return;
+		LARGE_INTEGER size;
+		if(!GetFileSizeEx(file_, &size) || size.QuadPart == 0)
+			return;
+		map_ = CreateFileMappingA(file_, 0, PAGE_READONLY, 0, 0, 0);
+		if(map_ == 0)
+			return;
+		data_ = (const char *) MapViewOfFile(map_, FILE_MAP_READ, 0, 0, 0);
+		if(data_)
+			size_ = (uint64_t) size.QuadPart;
+#else
+		file_ = open(filename, O_RDONLY);
+		if(file_ < 0)
+			return;
+		struct stat st;
+		if(fstat(file_, &st) != 0 || st.st_size == 0)
+			return;
+		void *ptr = mmap(0, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, file_, 0);
+		if(ptr == MAP_FAILED)
+			return;
+		data_ = (const char *) ptr;
+		size_ = (uint64_t) st.st_size;
+#endif
+	}
+
+	// unmaps the file
+	~MappedFile() {
+#if defined(_WIN32)
+		if(data_)
+			UnmapViewOfFile(data_);
+		if(map_)
+			CloseHandle(map_);
+		if(file_ != INVALID_HANDLE_VALUE)
+			CloseHandle(file_);
+#else
+		if(data_)
+			munmap((void *) data_, (size_t) size_);
+		if(file_ >= 0)
+			close(file_);
+#endif
+	}
+
+	const char * data() const {
+		return data_;
+	}
+
+	uint64_t size() const {
+		return size_;
+	}
+};
+
+// entry file found in the cache directory
+struct CacheEntry {
+	std::string name;
+	uint64_t size;
+	uint64_t used;		// modification time
+	bool operator< (const CacheEntry &other) const {
+		return used < other.used;
+	}
+};
+
+// ends with
+static bool hasExtension(const std::string &name, const char *ext) {
+	size_t len = strlen(ext);
+	return name.size() > len && name.compare(name.size() - len, len, ext) == 0;
+}
+
+// all entry files in the directory
+static void listEntries(const std::string &dir, std::vector<CacheEntry> &entries) {
+	entries.clear();
+#if defined(_WIN32)
+	WIN32_FIND_DATAA fd;
+	HANDLE h = FindFirstFileA((dir + "\\*" COEFCACHE_EXT).c_str(), &fd);
+	if(h == INVALID_HANDLE_VALUE)
+		return;
+	do {
+		CacheEntry e;
+		e.name = dir + "\\" + fd.cFileName;
+		e.size = ((uint64_t) fd.nFileSizeHigh << 32) | fd.nFileSizeLow;
+		e.used = ((uint64_t) fd.ftLastWriteTime.dwHighDateTime << 32) | fd.ftLastWriteTime.dwLowDateTime;
+		if(hasExtension(e.name, COEFCACHE_EXT))
+			entries.push_back(e);
+	} while(FindNextFileA(h, &fd));
+	FindClose(h);
+#else
+	DIR *d = opendir(dir.c_str());
+	if(!d)
+		return;
+	struct dirent *de;
+	while((de = readdir(d)) != 0) {
+		CacheEntry e;
+		e.name = dir + "/" + de->d_name;
+		struct stat st;
+		if(!hasExtension(e.name, COEFCACHE_EXT) || stat(e.name.c_str(), &st) != 0)
+			continue;
+		e.size = (uint64_t) st.st_size;
+		e.used = (uint64_t) st.st_mtime;
+		entries.push_back(e);
+	}
+	closedir(d);
+#endif
+}
+
+// mark the entry as used now
+static void touch(const std::string &name) {
+#if defined(_WIN32)
+	HANDLE h = CreateFileA(name.c_str(), FILE_WRITE_ATTRIBUTES, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+	if(h == INVALID_HANDLE_VALUE)
+		return;
+	FILETIME now;
+	GetSystemTimeAsFileTime(&now);
+	SetFileTime(h, 0, 0, &now);
+	CloseHandle(h);
+#else
+	utime(name.c_str(), 0);
+#endif
+}
+
+// constructor
+CoefCache::CoefCache(const std::string &dir, uint64_t maxBytes)
+	: dir_(dir), maxBytes_(maxBytes), keyed_(false), hash_(0), levelsY_(0), levelsC_(0) {
+	// no trailing separator
+	while(dir_.size() > 1 && (dir_[dir_.size()-1] == '/' || dir_[dir_.size()-1] == '\\'))
+		dir_.erase(dir_.size()-1);
+}
+
+// cache turned on
+bool CoefCache::enabled() const {
+	return !dir_.empty();
+}
+
+// key: FNV-1a hash of the file content & WT levels
+bool CoefCache::setKey(const char *imageFile, unsigned levelsY, unsigned levelsC) {
+	keyed_ = false;
+	if(!enabled())
+		return false;
+
+	std::ifstream file;
+	file.open(imageFile, std::ios::binary);
+	if(!file.is_open())
+		return false;
+
+	uint64_t hash = 14695981039346656037ULL;
+	std::vector<char> buffer(1 << 16);
+	do {
+		file.read(&buffer[0], buffer.size());
+		std::streamsize got = file.gcount();
+		for(std::streamsize i = 0; i < got; ++i) {
+			hash ^= (unsigned char) buffer[i];
+			hash *= 1099511628211ULL;
+		}
+	} while(file);
+	file.close();
+
+	hash_ = hash;
+	levelsY_ = levelsY;
+	levelsC_ = levelsC;
+	keyed_ = true;
+	return true;
+}
+
+// entry file name: hash-levels
+std::string CoefCache::entryName() const {
+	char name[64];
+	sprintf(name, "%016llx-%u-%u", (unsigned long long) hash_, levelsY_, levelsC_);
+#if defined(_WIN32)
+	return dir_ + "\\" + name + COEFCACHE_EXT;
+#else
+	return dir_ + "/" + name + COEFCACHE_EXT;
+#endif
+}
+
+// fetch: copy the planes from the mapped entry
+bool CoefCache::fetch(Image &image) const {
+	if(!keyed_)
+		return false;
+
+	std::string name = entryName();
+	{
+		MappedFile entry(name.c_str());
+		if(!entry.data() || entry.size() < sizeof(Header))
+			return false;
+
+		Header hd;
+		memcpy(&hd, entry.data(), sizeof(hd));
+		uint64_t planeSize = (uint64_t) hd.width * hd.height;
+		if(memcmp(hd.magic, "SPCC", 4) != 0 || hd.version != COEFCACHE_VERSION || hd.elemSize != sizeof(wUnit)
+			|| hd.hash != hash_ || hd.levelsY != levelsY_ || hd.levelsC != levelsC_
+			|| entry.size() != sizeof(Header) + 3 * planeSize * sizeof(wUnit)) {
+			std::cout << "Coefficient cache entry \"" << name << "\" does not match, ignored" << std::endl;
+			return false;
+		}
+
+		image.clear(hd.width, hd.height);
+		const char *src = entry.data() + sizeof(Header);
+		for(unsigned p = 0; p < 3; ++p) {
+			Matrix<wUnit>& plane = image.getMatrix((planeVal) p);
+			for(unsigned j = 0; j < hd.height; ++j) {
+				memcpy((void *) plane.getLine(j), src, sizeof(wUnit) * hd.width);
+				src += sizeof(wUnit) * hd.width;
+			}
+			// forward WT carries on from these
+			plane.bandSizeW = hd.bandSizeW[p];
+			plane.bandSizeH = hd.bandSizeH[p];
+		}
+	}
+
+	touch(name);
+	std::cout << "Coefficients loaded from cache \"" << name << "\"... OK" << std::endl;
+	return true;
+}
+
+// store: write a temporary file, then rename it to the entry
+bool CoefCache::store(const Image &image) const {
+	if(!keyed_)
+		return false;
+
+	Header hd;
+	memcpy(hd.magic, "SPCC", 4);
+	hd.version = COEFCACHE_VERSION;
+	hd.elemSize = (unsigned char) sizeof(wUnit);
+	hd.levelsY = (unsigned char) levelsY_;
+	hd.levelsC = (unsigned char) levelsC_;
+	hd.width = image.getWidth();
+	hd.height = image.getHeight();
+	for(unsigned p = 0; p < 3; ++p) {
+		hd.bandSizeW[p] = image.getMatrix((planeVal) p).bandSizeW;
+		hd.bandSizeH[p] = image.getMatrix((planeVal) p).bandSizeH;
+	}
+	hd.hash = hash_;
+
+	std::string name = entryName();
+	std::string temp = name + ".tmp";
+	std::ofstream file;
+	file.open(temp.c_str(), std::ios::binary);
+	if(!file.is_open()) {
+		std::cout << "Can't write to coefficient cache \"" << dir_ << "\"" << std::endl;
+		return false;
+	}
+
+	file.write((char *) &hd, sizeof(hd));
+	for(unsigned p = 0; p < 3; ++p) {
+		const Matrix<wUnit>& plane = image.getMatrix((planeVal) p);
+		for(unsigned j = 0; j < hd.height; ++j)
+			file.write((char *) plane.getLine(j), sizeof(wUnit) * hd.width);
+	}
+	bool ok = file.good();
+	file.close();
+
+	// rename does not replace on every platform
+	std::remove(name.c_str());
+	if(!ok || std::rename(temp.c_str(), name.c_str()) != 0) {
+		std::remove(temp.c_str());
+		std::cout << "Can't write to coefficient cache \"" << dir_ << "\"" << std::endl;
+		return false;
+	}
+
+	evict(name);
+	return true;
+}
+
+// evict: least recently used first
+void CoefCache::evict(const std::string &keep) const {
+	std::vector<CacheEntry> entries;
+	listEntries(dir_, entries);
+
+	uint64_t total = 0;
+	for(size_t i = 0; i < entries.size(); ++i)
+		total += entries[i].size;
+
+	// the kept entry stays even if it does not fit alone
+	std::sort(entries.begin(), entries.end());
+	for(size_t i = 0; i < entries.size() && total > maxBytes_; ++i) {
+		if(entries[i].name != keep && std::remove(entries[i].name.c_str()) == 0)
+			total -= entries[i].size;
+	}
+}
@@ -0,0 +1,67 @@
+// coefcache: on-disk cache of forward transformed image planes
+#ifndef COEFCACHE_H
+#define COEFCACHE_H
+
+#include "general.h"
+#include "image.h"
+#include <string>
+
+// size limit of the cache directory (bytes), least recently used entries go first
+#define COEFCACHE_MAX_BYTES ((uint64_t) 1 << 30)
+// entry file format version
+#define COEFCACHE_VERSION 1
+// entry file extension
+#define COEFCACHE_EXT ".spcc"
+
+// class CoefCache
+// keeps the planes of the encoder after RGB2YCbCr, substract128 and the forward WT, band sizes included,
+// one file per entry, named by the content hash of the image file and the WT levels of luma & chroma
+// a hit maps the entry file and copies the planes into the image, the BMP and the WT are skipped
+// the file modification time is the last use, a store evicts least recently used entries over the size limit
+class CoefCache {
+	// entry file header, 48 bytes, planes y, cB, cR of width x height wUnits follow
+	#pragma pack(1)
+	struct Header {
+		char magic[4];
+		unsigned char version;
+		unsigned char elemSize;
+		unsigned char levelsY;
+		unsigned char levelsC;
+		unsigned width;
+		unsigned height;
+		unsigned bandSizeW[3];
+		unsigned bandSizeH[3];
+		uint64_t hash;
+	};
+	#pragma pack()
+
+	std::string dir_;		// cache directory, empty = cache off
+	uint64_t maxBytes_;		// size limit of all entries
+
+	// key of the current image
+	bool keyed_;
+	uint64_t hash_;
+	unsigned levelsY_;
+	unsigned levelsC_;
+
+	// file name of the current entry
+	std::string entryName() const;
+	// remove least recently used entries but keep until all fit into the limit
+	void evict(const std::string &keep) const;
+
+public:
+	// constructor, cache in directory dir (must exist), empty dir = cache off
+	explicit CoefCache(const std::string &dir, uint64_t maxBytes = COEFCACHE_MAX_BYTES);
+
+	// cache turned on
+	bool enabled() const;
+	// key of following fetch / store: content of the image file & levels of the forward WT of luma / chroma planes
+	// false if the file can't be read
+	bool setKey(const char *imageFile, unsigned levelsY, unsigned levelsC);
+	// fill the image with the cached planes, false on a miss
+	bool fetch(Image &image) const;
+	// store the transformed planes of the image, false if not written
+	bool store(const Image &image) const;
+};
+
+#endif
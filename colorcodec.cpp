@@ -1,31 +1,28 @@
 // colorcodec implementation
 #include "colorcodec.h"
+#include "trace.h"
+#include "perfcounters.h"
 #include <iostream>
 #include <fstream>
+#include <algorithm>
 
-void ColorCodec::computeBandSize(Settings &sets, Image &image, planeVal plane) {
-	// compute max steps
-	bandSizeW_ = image.getWidth();
-	bandSizeH_ = image.getHeight();
-	
+void ColorCodec::computeBandSize(Settings &sets, const Image &image, planeVal plane) {
 	// CLS property
 	unsigned i = sets.levels;
 	if(!sets.cspihtFlag && sets.colorShift > 0 && plane > 0) {
 		i += sets.colorShift;	
 	}
 	
-	while(i > 0) {
-		bandSizeW_ /= 2;
-		bandSizeH_ /= 2;
-		i--;
-	}
+	// LLtop of any image size: odd sides leave their odd sample in the low band of each level
+	bandSizeW_ = bandSide(image.getWidth(), i);
+	bandSizeH_ = bandSide(image.getHeight(), i);
 	
-	// check if levels match image sizes due to log2 cond's
-	if(bandSizeW_ < 2 || bandSizeW_ % 2 != 0) {
+	// LLtop of 2 at least on each side (one quadgroup of roots)
+	if(bandSizeW_ < 2) {
 		std::cout << "Codec error: WT transform level set too high for image width!" << std::endl;
 		throw ExcWrongBandSize();
 	}
-	if(bandSizeH_ < 2 || bandSizeH_ % 2 != 0) {
+	if(bandSizeH_ < 2) {
 		std::cout << "Codec error: WT transform level set too high for image height!" << std::endl;
 		throw ExcWrongBandSize();
 	}
@@ -44,13 +41,18 @@ bool ColorCodec::load(const char *filename) {
 }
 
 // "late" constructor of data group, inits header and bs_ capacity
-void ColorCodec::DataGroup::DataGroupInit(unsigned int ver, unsigned int streams, unsigned int imageX, unsigned int imageY) {
+void ColorCodec::DataGroup::DataGroupInit(unsigned int ver, unsigned int streams, unsigned int imageX, unsigned int imageY, Arena *arena) {
 	// setup header
 	hdr_.version = (unsigned char) ver;
 	hdr_.streamCount = (unsigned char) streams;
 	hdr_.bitsPerElem = (unsigned char) 8*sizeof(ColorCodec::DataGroup::bitElem);
 	hdr_.width = (unsigned short) imageX;
 	hdr_.height = (unsigned short) imageY;
+	width_ = imageX;
+	height_ = imageY;
+	arena_ = arena;
+	interleaved_ = false;
+	chunks_.clear();
 	
 	// invoke capacity in stream
 	bs_.reserve(streams);	
@@ -58,15 +60,27 @@ void ColorCodec::DataGroup::DataGroupInit(unsigned int ver, unsigned int streams
 
 // return width of bitstream image
 unsigned ColorCodec::DataGroup::getWidth() const {
-	return hdr_.width;
+	return width_;
 }
 // return height of bitstream image
 unsigned ColorCodec::DataGroup::getHeight() const {
-	return hdr_.height;
+	return height_;
+}
+
+// wide container needed
+bool ColorCodec::DataGroup::wide() const {
+	if(wideCoords(width_, height_))
+		return true;
+	for(size_t p = 0; p < bs_.size(); ++p)
+		if(bs_[p].getSubStreamHeader().totalBits > 0xFFFFFFFFu)
+			return true;
+	return false;
 }
 
 // load of bitstream
 bool ColorCodec::DataGroup::load(const char *filename) {
+	TraceSpan span("load bitstream");
+	PerfSpan counters("load bitstream");
 	std::ifstream file;
 
 	// open file
@@ -83,6 +97,26 @@ bool ColorCodec::DataGroup::load(const char *filename) {
 		return false;
 	}
 	
+	// wide container: sizes follow
+	bool wideFile = hdr_.width == 0 && hdr_.height == 0;
+	width_ = hdr_.width;
+	height_ = hdr_.height;
+	if(wideFile) {
+		WideHeader wh;
+		file.read((char *)&wh, sizeof(wh));
+		if(file.gcount() != sizeof(wh)) {
+			std::cout << "Wide SPI header incomplete!" << std::endl;
+			return false;
+		}
+		width_ = wh.width;
+		height_ = wh.height;
+	}
+
+	// file layout
+	interleaved_ = (hdr_.version & INTERLEAVED_VERSION) != 0;
+	hdr_.version &= ~INTERLEAVED_VERSION;
+	chunks_.clear();
+
 	if(hdr_.streamCount == 0) {
 		std::cout << "StreamCount is zero in the given file!" << std::endl;
 		throw ExcWrongBitStream();
@@ -101,28 +135,85 @@ bool ColorCodec::DataGroup::load(const char *filename) {
 	// for each stream in pool save sub-header and store vector
 	// doint it the safe-way
 	for(unsigned p=0; p < hdr_.streamCount; ++p) {
-		// get header
-		ColorCodec::DataGroup::BitStream::SubStreamHeader hd;
-		// write the subheader
-		file.read((char *) &hd, sizeof(hd));
-		if(file.gcount() != sizeof(hd)) {
+		// get header, 64-bit counts in wide containers
+		ColorCodec::DataGroup::BitStream::WideSubStreamHeader hd;
+		bool complete;
+		if(wideFile) {
+			file.read((char *) &hd, sizeof(hd));
+			complete = file.gcount() == sizeof(hd);
+		} else {
+			ColorCodec::DataGroup::BitStream::SubStreamHeader sh;
+			file.read((char *) &sh, sizeof(sh));
+			complete = file.gcount() == sizeof(sh);
+			hd.maxSteps = sh.maxSteps;
+			hd.totalBits = sh.totalBits;
+			hd.level = sh.level;
+			hd.elements = sh.elements;
+		}
+		if(!complete) {
 			std::cout << "Stream subheader[" << p << "] incomplete!" << std::endl;
 			return false;
 		}
 		
 		// create new stream
-		bs_.push_back(ColorCodec::DataGroup::BitStream(hd.maxSteps, hd.totalBits, hd.level));
+		bs_.push_back(ColorCodec::DataGroup::BitStream(hd.maxSteps, hd.totalBits, hd.level, arena_));
+		if(interleaved_)
+			continue;
 	
 		// reserve capacity in stream, get stream address
-		void * ptr = bs_[p].reserveStreamSpace(hd.elements);
+		void * ptr = bs_[p].reserveStreamSpace((size_t) hd.elements);
 				
 		// fill up the stream
 		file.read((char *) ptr, sizeof(bitElem) * hd.elements);
-		if(file.gcount() != sizeof(bitElem) * hd.elements) {
+		if((uint64_t) file.gcount() != sizeof(bitElem) * hd.elements) {
 			std::cout << "Stream[" << p << "] incomplete!" << std::endl;
 			return false;	
 		}
 	}	
+
+	// pass-interleaved: append chunks to their streams up to the end of file
+	if(interleaved_) {
+		std::vector<unsigned char> bytes;
+		while(true) {
+			WideChunkHeader ch;
+			if(wideFile) {
+				file.read((char *) &ch, sizeof(ch));
+				if(file.gcount() != sizeof(ch))
+					break;
+			} else {
+				ChunkHeader sh;
+				file.read((char *) &sh, sizeof(sh));
+				if(file.gcount() != sizeof(sh))
+					break;
+				ch.stream = sh.stream;
+				ch.step = sh.step;
+				ch.bits = sh.bits;
+			}
+			if(ch.stream >= hdr_.streamCount) {
+				std::cout << "Chunk of unknown stream " << (unsigned) ch.stream << " in the given file!" << std::endl;
+				throw ExcWrongBitStream();
+			}
+
+			// last chunk may be cut short
+			bytes.resize((size_t) ((ch.bits + 7) / 8));
+			if(!bytes.empty())
+				file.read((char *) &bytes[0], bytes.size());
+			size_t got = (size_t) file.gcount();
+			if(got < bytes.size())
+				ch.bits = 8 * (bitCount) got;
+
+			for(size_t i = 0; 8 * (bitCount) i < ch.bits; ++i)
+				bs_[ch.stream].putBits(bytes[i], (unsigned) std::min((bitCount) 8, ch.bits - 8 * (bitCount) i));
+			chunks_.push_back(ch);
+
+			if(got < bytes.size())
+				break;
+		}
+
+		// streams hold what was there
+		for(unsigned p=0; p < hdr_.streamCount; ++p)
+			bs_[p].performClose();
+	}
 	
 	file.close();
 	std::cout << "Bitstream \"" << filename << "\" loaded... OK" << std::endl;
@@ -132,6 +223,8 @@ bool ColorCodec::DataGroup::load(const char *filename) {
 
 // save of bitstream
 bool ColorCodec::DataGroup::save(const char *filename) const {
+	TraceSpan span("save bitstream");
+	PerfSpan counters("save bitstream");
 	std::ofstream file;
 	
 	// open the file for saving
@@ -141,19 +234,80 @@ bool ColorCodec::DataGroup::save(const char *filename) const {
 		return false;
 	}
 	
-	// save header
-	file.write((char *) &hdr_, sizeof(hdr_));
+	// save header, wide container: zero size in it, sizes follow
+	bool wideFile = wide();
+	Header hdr = hdr_;
+	if(interleaved_)
+		hdr.version |= INTERLEAVED_VERSION;
+	if(wideFile)
+		hdr.width = hdr.height = 0;
+	file.write((char *) &hdr, sizeof(hdr));
+	if(wideFile) {
+		WideHeader wh;
+		wh.width = width_;
+		wh.height = height_;
+		file.write((char *) &wh, sizeof(wh));
+	}
 	
 	// for each stream in pool save sub-header and store vector
 	// doint it the safe-way
 	for(unsigned p=0; p < hdr_.streamCount; ++p) {
 		// get header
-		ColorCodec::DataGroup::BitStream::SubStreamHeader hd = bs_[p].getSubStreamHeader();
-		// write the header
-		file.write((char *) &hd, sizeof(ColorCodec::DataGroup::BitStream::SubStreamHeader));
+		ColorCodec::DataGroup::BitStream::WideSubStreamHeader hd = bs_[p].getSubStreamHeader();
+		// write the header, 32-bit counts in the 16-bit container
+		if(wideFile) {
+			file.write((char *) &hd, sizeof(hd));
+		} else {
+			ColorCodec::DataGroup::BitStream::SubStreamHeader sh;
+			sh.maxSteps = hd.maxSteps;
+			sh.totalBits = (unsigned) hd.totalBits;
+			sh.level = hd.level;
+			sh.elements = (unsigned) hd.elements;
+			file.write((char *) &sh, sizeof(sh));
+		}
 		// write the stream
-		file.write((char *) bs_[p].getVectorAddress(), hd.elements * sizeof(ColorCodec::DataGroup::bitElem));
+		if(!interleaved_)
+			file.write((char *) bs_[p].getVectorAddress(), hd.elements * sizeof(ColorCodec::DataGroup::bitElem));
 	}	
+
+	// pass-interleaved: chunks by step, then by stream
+	if(interleaved_) {
+		std::vector<std::vector<bitCount> > from(hdr_.streamCount), to(hdr_.streamCount);
+		int top = 0;
+		for(unsigned p=0; p < hdr_.streamCount; ++p) {
+			bs_[p].getPassChunks(from[p], to[p]);
+			top = std::max(top, (int) bs_[p].getMaxSteps());
+		}
+
+		std::vector<unsigned char> bytes;
+		for(int step = top; step >= 0; --step) {
+			for(unsigned p=0; p < hdr_.streamCount; ++p) {
+				// pass k of a stream is done at step maxSteps - k
+				int k = (int) bs_[p].getMaxSteps() - step;
+				if(k < 0 || k >= (int) to[p].size() || to[p][k] == from[p][k])
+					continue;
+
+				WideChunkHeader ch;
+				ch.stream = (unsigned char) p;
+				ch.step = (unsigned char) step;
+				ch.bits = to[p][k] - from[p][k];
+				if(wideFile) {
+					file.write((char *) &ch, sizeof(ch));
+				} else {
+					ChunkHeader sh;
+					sh.stream = ch.stream;
+					sh.step = ch.step;
+					sh.bits = (unsigned) ch.bits;
+					file.write((char *) &sh, sizeof(sh));
+				}
+
+				bytes.resize((size_t) ((ch.bits + 7) / 8));
+				for(size_t i = 0; i < bytes.size(); ++i)
+					bytes[i] = (unsigned char) bs_[p].readBits(from[p][k] + 8 * (bitCount) i, (unsigned) std::min((bitCount) 8, ch.bits - 8 * (bitCount) i));
+				file.write((char *) &bytes[0], bytes.size());
+			}
+		}
+	}
 	
 	file.close();
 	std::cout << "Bitstream saved to file \"" << filename << "\"... OK" << std::endl;
@@ -161,13 +315,21 @@ bool ColorCodec::DataGroup::save(const char *filename) const {
 }
 
 // single bitstream constructor
-ColorCodec::DataGroup::BitStream::BitStream(unsigned char mxStep, unsigned int totalB, unsigned char level) :
-	maxSteps_(mxStep), totalBits_(totalB), elements_(1), bitPos_(0), elemPos_(0), bitNr_(0), level_(level), finished(false)
+ColorCodec::DataGroup::BitStream::BitStream(unsigned char mxStep, bitCount totalB, unsigned char level, Arena *arena, bitCount limit) :
+	maxSteps_(mxStep), totalBits_(totalB), elements_(1), stream_(ArenaAllocator<bitElem>(arena)), bitPos_(0), elemPos_(0), bitNr_(0), level_(level), finished(false)
 {
-	stream_.clear();
+	// growing inside an arena would leave the old blocks behind,
+	// a budget over what the plane can give (-B) takes only that
+	if(arena)
+		stream_.reserve((size_t) (((limit > 0 && limit < totalB) ? limit : totalB) / (8*sizeof(ColorCodec::DataGroup::bitElem)) + 1));
 	stream_.push_back(0);
 }
 
+// bound of the coded bits of a plane, headers of the coders & the symbol count of -a included
+bitCount ColorCodec::DataGroup::BitStream::bitsBound(uint64_t coefs, unsigned mxStep) {
+	return 4 * coefs * ((bitCount) mxStep + 1) + 1024;
+}
+
 // perform close private member
 void ColorCodec::DataGroup::BitStream::performClose() {
 	if(!finished) {
@@ -180,6 +342,29 @@ void ColorCodec::DataGroup::BitStream::performClose() {
 	}
 }
 
+// mark the end of a pass, a closed stream ends at its final size
+void ColorCodec::DataGroup::BitStream::markPass() {
+	passEnds_.push_back(finished ? totalBits_ : bitPos_);
+}
+
+// chunks of the passes, one for the whole stream if there are no marks
+void ColorCodec::DataGroup::BitStream::getPassChunks(std::vector<bitCount> &from, std::vector<bitCount> &to) const {
+	from.clear();
+	to.clear();
+	bitCount last = 0;
+	for(size_t k = 0; k < passEnds_.size(); ++k) {
+		from.push_back(last);
+		to.push_back(std::max(last, std::min(passEnds_[k], totalBits_)));
+		last = to.back();
+	}
+	// bits after the last mark belong to the last pass
+	if(to.empty()) {
+		from.push_back(0);
+		to.push_back(totalBits_);
+	} else
+		to.back() = totalBits_;
+}
+
 // get: gets bit from the bitstream. 
 // returns:	0,1 - bit, -1 - error (bitstream not closed or final bitcount reached)
 unsigned char ColorCodec::DataGroup::BitStream::get() {
@@ -238,10 +423,144 @@ bool ColorCodec::DataGroup::BitStream::put(bool bit) {
 	return true;
 }
 
+// putBits: puts up to 64 bits into the bitstream at once
+// returns the number of bits stored, fewer than count only if the stream got full (then closed)
+unsigned ColorCodec::DataGroup::BitStream::putBits(uint64_t bits, unsigned count) {
+	if(finished)
+		return 0;
+
+	// clip to the final size - the stream closes as on a failed put
+	unsigned stored = count;
+	if(totalBits_ - bitPos_ < count)
+		stored = (unsigned) (totalBits_ - bitPos_);
+
+	unsigned left = stored;
+	while(left > 0) {
+		// modulo ++ for bitNr
+		if(bitNr_ == 8*sizeof(ColorCodec::DataGroup::bitElem)) {
+			bitNr_ = 0;
+			stream_.push_back(0);
+		}
+
+		// as many bits as fit into the last item in vector
+		unsigned take = 8*sizeof(ColorCodec::DataGroup::bitElem) - bitNr_;
+		if(take > left)
+			take = left;
+		uint64_t mask = (take == 64) ? ~(uint64_t) 0 : (((uint64_t) 1 << take) - 1);
+		stream_.back() = stream_.back() | (ColorCodec::DataGroup::bitElem) ((bits & mask) << bitNr_);
+
+		bits = (take == 64) ? 0 : (bits >> take);
+		bitNr_ += take;
+		bitPos_ += take;
+		left -= take;
+	}
+
+	if(stored < count)
+		performClose();
+
+	return stored;
+}
+
+// reserveBits: claims count zero bits at the end of the stream for writeBits
+// returns the number of bits claimed, fewer than count only if the stream got full (then closed)
+bitCount ColorCodec::DataGroup::BitStream::reserveBits(bitCount count, bitCount &start) {
+	start = bitPos_;
+	if(finished)
+		return 0;
+
+	// clip to the final size - the stream closes as on a failed put
+	bitCount stored = count;
+	if(totalBits_ - bitPos_ < count)
+		stored = totalBits_ - bitPos_;
+
+	// items covering the new end, the last one may be full (as after put)
+	const unsigned elemBits = 8*sizeof(ColorCodec::DataGroup::bitElem);
+	bitPos_ += stored;
+	size_t items = (size_t) ((bitPos_ + elemBits - 1) / elemBits);
+	if(items > stream_.size())
+		stream_.resize(items, 0);
+	bitNr_ = (unsigned) (bitPos_ - (bitCount) (stream_.size() - 1) * elemBits);
+
+	if(stored < count)
+		performClose();
+
+	return stored;
+}
+
+// writeBits: ORs bits into claimed space, does not move the stream position
+void ColorCodec::DataGroup::BitStream::writeBits(bitCount pos, uint64_t bits, unsigned count) {
+	const unsigned elemBits = 8*sizeof(ColorCodec::DataGroup::bitElem);
+	size_t elem = (size_t) (pos / elemBits);
+	unsigned nr = (unsigned) (pos % elemBits);
+
+	while(count > 0) {
+		// as many bits as fit into this item
+		unsigned take = elemBits - nr;
+		if(take > count)
+			take = count;
+		uint64_t mask = (take == 64) ? ~(uint64_t) 0 : (((uint64_t) 1 << take) - 1);
+		stream_[elem] = stream_[elem] | (ColorCodec::DataGroup::bitElem) ((bits & mask) << nr);
+
+		bits = (take == 64) ? 0 : (bits >> take);
+		count -= take;
+		nr = 0;
+		elem++;
+	}
+}
+
+// takeBits: skips count bits for readBits
+// returns the number of bits available, fewer than count only if the stream got exhausted (then closed)
+bitCount ColorCodec::DataGroup::BitStream::takeBits(bitCount count, bitCount &start) {
+	start = bitPos_;
+
+	// bits left - final size & stored ones
+	const unsigned elemBits = 8*sizeof(ColorCodec::DataGroup::bitElem);
+	bitCount left = 0;
+	if(bitPos_ < totalBits_)
+		left = std::min(totalBits_, (bitCount) stream_.size() * elemBits) - bitPos_;
+
+	bitCount taken = std::min(count, left);
+	bitPos_ += taken;
+	// position as left by get(): the last item read stays current until its end
+	if(bitPos_ > 0) {
+		elemPos_ = (size_t) ((bitPos_ - 1) / elemBits);
+		bitNr_ = (unsigned) (bitPos_ - (bitCount) elemPos_ * elemBits);
+	}
+
+	if(taken < count)
+		performClose();
+
+	return taken;
+}
+
+// readBits: reads bits at a position, does not move the stream position
+uint64_t ColorCodec::DataGroup::BitStream::readBits(bitCount pos, unsigned count) const {
+	const unsigned elemBits = 8*sizeof(ColorCodec::DataGroup::bitElem);
+	size_t elem = (size_t) (pos / elemBits);
+	unsigned nr = (unsigned) (pos % elemBits);
+
+	uint64_t bits = 0;
+	unsigned got = 0;
+	while(got < count) {
+		// as many bits as this item holds
+		unsigned take = elemBits - nr;
+		if(take > count - got)
+			take = count - got;
+		uint64_t item = (uint64_t) (stream_[elem] >> nr) & (((uint64_t) 1 << take) - 1);
+		bits |= item << got;
+
+		got += take;
+		nr = 0;
+		elem++;
+	}
+
+	return bits;
+}
+
 // check against settings &ref
 // IMPORTANT! function is called ONLY in decoding phase
 // returns bits number, which is either totalBits_ or non-zero smaller bits
-unsigned ColorCodec::DataGroup::BitStream::checkSettings(Settings &sets, unsigned bits) {
+bitCount ColorCodec::DataGroup::BitStream::checkSettings(Settings &sets, bitCount bits) {
 	bits = (bits < totalBits_ && bits > 0) ? bits : totalBits_;
 	if(sets.levels != level_) {
 		if(!(sets.colorShift > 0 && !sets.cspihtFlag && sets.colorShift + sets.levels == level_)) {
@@ -268,12 +587,12 @@ unsigned char ColorCodec::DataGroup::BitStream::getMaxSteps() const {
 }
 
 // get total bits
-unsigned ColorCodec::DataGroup::BitStream::getTotalBits() const {
+bitCount ColorCodec::DataGroup::BitStream::getTotalBits() const {
 	return totalBits_;
 }
 
-ColorCodec::DataGroup::BitStream::SubStreamHeader ColorCodec::DataGroup::BitStream::getSubStreamHeader() const {
-	SubStreamHeader hd;
+ColorCodec::DataGroup::BitStream::WideSubStreamHeader ColorCodec::DataGroup::BitStream::getSubStreamHeader() const {
+	WideSubStreamHeader hd;
 	hd.elements = elements_;
 	hd.level = level_;
 	hd.maxSteps = maxSteps_;
@@ -291,7 +610,7 @@ void * ColorCodec::DataGroup::BitStream::getVectorAddress() const {
 // reserve space for incoming data & return stream pointer
 // copy immediately after!
 // NASTY :)
-void * ColorCodec::DataGroup::BitStream::reserveStreamSpace(unsigned size) {
+void * ColorCodec::DataGroup::BitStream::reserveStreamSpace(size_t size) {
 	stream_.assign( size, 0 );
 	elements_ = size;
 	finished = true;
@@ -299,6 +618,16 @@ void * ColorCodec::DataGroup::BitStream::reserveStreamSpace(unsigned size) {
 }
 
 
+// bits of each stream in a file prefix of total bits, counting chunk payloads only
+void ColorCodec::DataGroup::prefixBits(bitCount total, std::vector<bitCount> &bits) const {
+	bits.assign(hdr_.streamCount, 0);
+	for(size_t c = 0; c < chunks_.size() && total > 0; ++c) {
+		bitCount take = std::min(total, chunks_[c].bits);
+		bits[chunks_[c].stream] += take;
+		total -= take;
+	}
+}
+
 // check if DataGroup ok with version & streams
 // exception will be thrown if not
 void ColorCodec::DataGroup::DataGroupCheck(unsigned ver, unsigned streams) {
@@ -320,3 +649,27 @@ unsigned ColorCodec::getImageH() const {
 	return dt_.getHeight();
 }
 
+
+// threads for the encoder passes
+void ColorCodec::setWorkers(WorkerPool *workers) {
+	workers_ = workers;
+}
+
+// bits in all streams
+bitCount ColorCodec::getBitCount() const {
+	bitCount bits = 0;
+	for(size_t p = 0; p < dt_.bs_.size(); ++p)
+		bits += dt_.bs_[p].getTotalBits();
+	return bits;
+}
+
+// work counters
+const CoderStats& ColorCodec::getStats() const {
+	return stats_;
+}
+
+// take over the bitstream
+void ColorCodec::takeBitStream(ColorCodec &src) {
+	dt_ = std::move(src.dt_);
+	src.dt_.bs_.clear();
+}
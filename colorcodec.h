@@ -8,10 +8,15 @@
 #define TIMING		printTimeFlag_
 // print debug info 
 #define DEBUG		printDebugFlag_
+// added to the version byte of pass-interleaved bitstream files (removed again on load)
+#define INTERLEAVED_VERSION 0x02
 
 #include <vector>
+#include "arena.h"
+#include "workerpool.h"
 #include "image.h"
 #include "settings.h"
+#include "codecstats.h"
 
 // Base class.
 // Declares encode(), decode(), load(), save() and getElapsedTime()
@@ -33,19 +38,48 @@ public:
 			unsigned short height;
 		};
 		#pragma pack()
+
+		// wide container (image over 65535 a side or a stream over 2^32 bits): header with zero width & height,
+		// then this one, substream & chunk headers have 64-bit counts; 8 bytes
+		#pragma pack(1)
+		struct WideHeader {
+			unsigned width;
+			unsigned height;
+		};
+		#pragma pack()
+
+		// pass-interleaved files: chunk header, 6 bytes
+		// the chunk holds bits of stream from one pass of the given step (byte padded)
+		#pragma pack(1)
+		struct ChunkHeader {
+			unsigned char stream;
+			unsigned char step;
+			unsigned bits;
+		};
+		#pragma pack()
+
+		// pass-interleaved wide files: chunk header, 10 bytes
+		#pragma pack(1)
+		struct WideChunkHeader {
+			unsigned char stream;
+			unsigned char step;
+			bitCount bits;
+		};
+		#pragma pack()
 		
 		// bitstream class declaration
 		class BitStream {
 			// permanents
 			unsigned char maxSteps_;
-			unsigned totalBits_;
+			bitCount totalBits_;
 			unsigned char level_;
-			unsigned elements_;
-			std::vector<bitElem> stream_;
+			size_t elements_;
+			std::vector<bitElem, ArenaAllocator<bitElem> > stream_;
+			std::vector<bitCount> passEnds_;	// (encoding) bit position at the end of each pass
 			
 			// state values
-			unsigned bitPos_;
-			unsigned elemPos_;
+			bitCount bitPos_;
+			size_t elemPos_;
 			unsigned bitNr_;
 					
 		public:
@@ -58,53 +92,107 @@ public:
 				unsigned elements;	
 			};
 			#pragma pack()
+
+			// subStream Header Datatype of wide containers, 18 bytes
+			#pragma pack(1)
+			struct WideSubStreamHeader {
+				unsigned char maxSteps;
+				bitCount totalBits;
+				unsigned char level;
+				uint64_t elements;
+			};
+			#pragma pack()
 			
 			// constructor creates empty BitStream
-			BitStream(unsigned char mxStep, unsigned totalB, unsigned char level);
+			// with arena given, space for totalB bits is taken at once, up to limit bits when given
+			// (most the coder can put out, see bitsBound()), a longer stream grows past it
+			BitStream(unsigned char mxStep, bitCount totalB, unsigned char level, Arena *arena = 0, bitCount limit = 0);
+			// bound of the bits coded from coefs coefficients in mxStep + 1 passes: a significance test
+			// of the coefficient and of each of up to two sets it heads, sign or refinement bit - 4 bits a pass
+			static bitCount bitsBound(uint64_t coefs, unsigned mxStep);
 			// get one bit and return 1/0/-1 (error)
 			unsigned char get();
 			// put one bit, return true (success), false (error)
 			bool put(bool bit);
+			// put lowest count bits of a word (LSB first, count <= 64),
+			// same as count calls to put(), returns number of bits stored
+			unsigned putBits(uint64_t bits, unsigned count);
+			// block access for passes filled / read in parallel chunks:
+			// (encoding) claim count zero bits at the end, start gets their position,
+			// same as count calls to put(0), returns number of bits claimed
+			bitCount reserveBits(bitCount count, bitCount &start);
+			// (encoding) OR lowest count bits of a word (LSB first, count <= 64) in at bit position pos,
+			// position must be claimed; callers writing in parallel must not share a bitElem
+			void writeBits(bitCount pos, uint64_t bits, unsigned count);
+			// (decoding) skip count bits, start gets their position,
+			// same as count calls to get(), returns number of bits available
+			bitCount takeBits(bitCount count, bitCount &start);
+			// (decoding) read count bits (count <= 64) at bit position pos, LSB first
+			uint64_t readBits(bitCount pos, unsigned count) const;
 			// get max steps
 			unsigned char getMaxSteps() const;
 			// get total bits
-			unsigned getTotalBits() const;
-			// get substream header
-			SubStreamHeader getSubStreamHeader() const;
+			bitCount getTotalBits() const;
+			// get substream header (wide counts, narrowed for the 16-bit container on save)
+			WideSubStreamHeader getSubStreamHeader() const;
 			// gives address of first byte in the stream
 			void * getVectorAddress() const;	
 			// reserve space for incoming data & return stream pointer
-			void * reserveStreamSpace(unsigned size);		
+			void * reserveStreamSpace(size_t size);		
 			// check bs against settings, returns either totalBits or specified bits (if smaller and non-zero)
 			// also sets this value as new totalBits_
-			unsigned checkSettings(Settings &sets, unsigned bits);
+			bitCount checkSettings(Settings &sets, bitCount bits);
 			// finished property
 			bool finished;
 			// "closer" member
 			void performClose();
+			// (encoding) mark the end of a pass
+			void markPass();
+			// pass-interleaved files: chunk of each pass, [from, to) bit positions
+			// stream without marks (loaded one) is one chunk
+			void getPassChunks(std::vector<bitCount> &from, std::vector<bitCount> &to) const;
+			// bits are addressed directly (see reserveBits, takeBits)
+			static const bool positional = true;
 		};
 	
-		Header				   hdr_;	// header of the bitstream
+		Header				   hdr_;	// header of the bitstream (zero size for wide containers)
+		unsigned			  width_;	// size of the image
+		unsigned			 height_;
 		std::vector<BitStream> bs_;	// vector of streams
+		Arena				  *arena_;	// source of stream memory (0 = heap)
+		bool			 interleaved_;	// file layout: streams one after another or pass-interleaved
+		std::vector<WideChunkHeader> chunks_;	// (loaded pass-interleaved file) chunks in file order
 
 		// creates new DataGroup
-		void DataGroupInit(unsigned ver, unsigned streams, unsigned imageX, unsigned imageY);
+		void DataGroupInit(unsigned ver, unsigned streams, unsigned imageX, unsigned imageY, Arena *arena = 0);
 		// check if DataGroup ok with version & streams
 		// exception will be thrown if not
 		void DataGroupCheck(unsigned ver, unsigned streams);
+		// wide container needed: image over 65535 a side or a stream over 2^32 bits
+		bool wide() const;
 		// save interface
+		// pass-interleaved: chunks of all streams ordered by step (highest first), then by stream,
+		// so any prefix of the file holds the first passes of every stream
+		// 16-bit container unless wide() is true
 		bool save(const char *filename) const;
 		// load interface
+		// pass-interleaved file may be cut anywhere after the substream headers
 		bool load(const char *filename);
+		// (loaded pass-interleaved file) bits of each stream in the first total bits of the file
+		void prefixBits(bitCount total, std::vector<bitCount> &bits) const;
 		// return width of bitstream image
 		unsigned getWidth() const;
 		// return height of bitstream image
 		unsigned getHeight() const;
 	};
+	// constructor
+	ColorCodec() : EXTENDED(false), DEBUG(false), TIMING(false), elapsedTime_(0.0), arena_(0), workers_(0) {}
+	// destructor
+	virtual ~ColorCodec() {}
 	// public base for encode 
 	virtual void encode(Settings &sets) = 0;
 	// public base for decode
-	virtual void decode(Settings &sets, unsigned desiredBits=0) = 0;
+	virtual void decode(Settings &sets, bitCount desiredBits=0) = 0;
 	// getElapsedTime
 	double getElapsedTime() const;
 	// save and load wrappers
@@ -113,6 +201,15 @@ public:
 	// get width & height wrappers
 	unsigned getImageW() const;
 	unsigned getImageH() const;
+	// threads for the encoder passes (0 = serial)
+	void setWorkers(WorkerPool *workers);
+	// bits in the bitstream (all streams)
+	bitCount getBitCount() const;
+	// work counters of the last encode / decode
+	const CoderStats& getStats() const;
+	// take over the bitstream of another codec of the same kind, src is left without one
+	// (decoding into another image than the encoded one)
+	void takeBitStream(ColorCodec &src);
 	
 protected:
 	// output notifiers
@@ -121,8 +218,13 @@ protected:
 	bool TIMING;
 
 	double elapsedTime_;	// time elapsed by last operation
+	CoderStats stats_;		// work counters of last operation
 	// main value
 	DataGroup dt_;
+	// job memory for lists and streams (0 = heap)
+	Arena *arena_;
+	// threads for the encoder passes (0 = serial)
+	WorkerPool *workers_;
 	
 	// bandsizes
 	unsigned bandSizeW_;
@@ -137,7 +239,7 @@ protected:
 	// private bandsize computer
 	// also checks whether everything OK
 	// throws exception if err.
-	void computeBandSize(Settings &sets, Image &image, planeVal plane);
+	void computeBandSize(Settings &sets, const Image &image, planeVal plane);
 };
 
 #endif
@@ -1,6 +1,9 @@
 #include "flwt.h"
+#include "trace.h"
+#include "perfcounters.h"
 #include <iostream>
 #include <cmath>
+#include <vector>
 
 #define COEF_A	   -1.5861343420693648
 #define COEF_B     -0.0529801185718856
@@ -8,106 +11,201 @@
 #define COEF_D		0.4435068520511142
 #define COEF_SCALE  1.1496043988602418
 
+// forward row transform of one line of m values
+void Flwt::lineTransformF(wUnit *line, unsigned m, wUnit *tempbank) {
+	// odd m: the last value is even, it takes its left neighbour twice (symmetric extension)
+	// PREDICT 1
+	for(unsigned i = 1; i+1 < m; i += 2)
+		line[i] = line[i] + COEF_A * (line[i-1] + line[i+1]);
+	if(m % 2 == 0)
+		line[m-1] = line[m-1] + 2 * COEF_A * line[m-2];
+
+	// UPDATE 1
+	for(unsigned i = 2; i+1 < m; i += 2)
+		line[i] = line[i] + COEF_B * (line[i-1] + line[i+1]);
+	line[0] = line[0] + 2 * COEF_B * line[1];
+	if(m % 2)
+		line[m-1] = line[m-1] + 2 * COEF_B * line[m-2];
+
+	// PREDICT 2
+	for(unsigned i = 1; i+1 < m; i += 2)
+		line[i] = line[i] + COEF_C * (line[i-1] + line[i+1]);
+	if(m % 2 == 0)
+		line[m-1] = line[m-1] + 2 * COEF_C * line[m-2];
+
+	// UPDATE 2
+	for(unsigned i = 2; i+1 < m; i += 2)
+		line[i] = line[i] + COEF_D * (line[i-1] + line[i+1]);
+	line[0] = line[0] + 2 * COEF_D * line[1];
+	if(m % 2)
+		line[m-1] = line[m-1] + 2 * COEF_D * line[m-2];
+
+	// REORDER (the low half takes the odd value)
+	unsigned low = (m+1)/2;
+	for(unsigned i = 0; i < m; ++i)
+		if(i % 2 == 0)
+			tempbank[i/2] = line[i] * COEF_SCALE;
+		else
+			tempbank[low + i/2] = line[i] / COEF_SCALE;
+
+	// SAVE
+	memcpy((void *) line, (void *) tempbank, sizeof(wUnit) * m);
+}
+
 // forward row transform on WxH
-void Flwt::rowTransformF(Matrix<wUnit>& source, unsigned W, unsigned H) {
-	unsigned m = W;
-	unsigned n = H;
+void Flwt::rowTransformF(Matrix<wUnit> &source, unsigned W, unsigned H, wUnit *tempbank) {
+	for(unsigned j = 0; j < H; ++j)
+		lineTransformF(source.getLine(j), W, tempbank);
+}
 
-	wUnit * tempbank = new wUnit[m];
-	
-	for(unsigned j = 0; j < n; ++j) {
-		// PREDICT 1
-		for(unsigned i = 1; i < m-2; i += 2)
-			source(i,j) = source(i,j) + COEF_A * (source(i-1,j) + source(i+1,j));
-		source(m-1,j) = source(m-1,j) + 2 * COEF_A * source(m-2,j);
+// lifting step on s values of a line: at[0] += coef * (at[-1] + at[1])
+static inline void liftLine(wUnit *const *at, unsigned s, wUnit coef) {
+	wUnit *line = at[0];
+	const wUnit *prev = at[-1];
+	const wUnit *next = at[1];
+	for(unsigned c = 0; c < s; ++c)
+		line[c] = line[c] + coef * (prev[c] + next[c]);
+}
 
-		// UPDATE 1
-		for(unsigned i = 2; i < m; i += 2)
-			source(i,j) = source(i,j) + COEF_B * (source(i-1,j) + source(i+1,j));
-		source(0,j) = source(0,j) + 2 * COEF_B * source(1,j);
+// edge lifting step on s values of a line: at[0] += coef * other
+static inline void liftLineEdge(wUnit *const *at, const wUnit *other, unsigned s, wUnit coef) {
+	wUnit *line = at[0];
+	for(unsigned c = 0; c < s; ++c)
+		line[c] = line[c] + coef * other[c];
+}
 
-		// PREDICT 2
-		for(unsigned i = 1; i < m-2; i += 2)
-			source(i,j) = source(i,j) + COEF_C * (source(i-1,j) + source(i+1,j));
-		source(m-1,j) = source(m-1,j) + 2 * COEF_C * source(m-2,j);
+// predict step on odd line j of n (at[0], neighbours around it), the last line takes its upper neighbour twice
+static inline void predictLine(wUnit *const *at, unsigned n, unsigned j, unsigned s, wUnit coef) {
+	if(j + 1 < n)
+		liftLine(at, s, coef);
+	else
+		liftLineEdge(at, at[-1], s, 2 * coef);
+}
 
-		// UPDATE 2
-		for(unsigned i = 2; i < m; i += 2)
-			source(i,j) = source(i,j) + COEF_D * (source(i-1,j) + source(i+1,j));
-		source(0,j) = source(0,j) + 2 * COEF_D * source(1,j);
+// update step on even line j of n, the first line takes its lower neighbour twice,
+// the last one (odd n) its upper one
+static inline void updateLine(wUnit *const *at, unsigned n, unsigned j, unsigned s, wUnit coef) {
+	if(j == 0)
+		liftLineEdge(at, at[1], s, 2 * coef);
+	else if(j + 1 < n)
+		liftLine(at, s, coef);
+	else
+		liftLineEdge(at, at[-1], s, 2 * coef);
+}
 
-		// REORDER
-		for(unsigned i = 0; i < m; ++i)
-			if(i % 2 == 0)
-				tempbank[i/2] = source(i,j) * COEF_SCALE;
-			else
-				tempbank[m/2 + i/2] = source(i,j) / COEF_SCALE;
+// forward column step at even line t of n, lines[k] is line t-5+k:
+// the four lifting steps on t-1..t-4, each of them finds its neighbours in the state
+// the step before left them (same values as step by step over the whole band),
+// steps at t = 2, 4, .. up to n+3 do the band
+void Flwt::columnStepF(wUnit *const *lines, unsigned n, unsigned t, unsigned s) {
+	// PREDICT 1
+	if(t - 1 < n)
+		predictLine(lines + 4, n, t-1, s, COEF_A);
+	// UPDATE 1
+	if(t - 2 < n)
+		updateLine(lines + 3, n, t-2, s, COEF_B);
+	// PREDICT 2
+	if(t >= 3 && t - 3 < n)
+		predictLine(lines + 2, n, t-3, s, COEF_C);
+	// UPDATE 2
+	if(t >= 4 && t - 4 < n)
+		updateLine(lines + 1, n, t-4, s, COEF_D);
+}
 
-		// SAVE
-		for(unsigned i = 0; i < m; ++i)
-			source(i,j) = tempbank[i];
+// inverse column step at even line t of n, lines[k] is line t-4+k: steps on t..t-3 in reverse order
+void Flwt::columnStepI(wUnit *const *lines, unsigned n, unsigned t, unsigned s) {
+	// UPDATE 2
+	if(t < n)
+		updateLine(lines + 4, n, t, s, (-1) * COEF_D);
+	// PREDICT 2
+	if(t >= 1 && t - 1 < n)
+		predictLine(lines + 3, n, t-1, s, (-1) * COEF_C);
+	// UPDATE 1
+	if(t >= 2 && t - 2 < n)
+		updateLine(lines + 2, n, t-2, s, (-1) * COEF_B);
+	// PREDICT 1
+	if(t >= 3 && t - 3 < n)
+		predictLine(lines + 1, n, t-3, s, (-1) * COEF_A);
+}
+
+// REORDER / UNPACK scaling of s values: up (low lines of the forward, high ones of the inverse) or down
+void Flwt::scaleLine(wUnit *dst, const wUnit *src, unsigned s, bool up) {
+	if(up) {
+		for(unsigned c = 0; c < s; ++c)
+			dst[c] = src[c] * COEF_SCALE;
+	} else {
+		for(unsigned c = 0; c < s; ++c)
+			dst[c] = src[c] / COEF_SCALE;
 	}
+}
 
-	delete []tempbank;
+// moves the lines of the columns i..i+s-1 in place, following the cycles of the permutation with one
+// line of scratch: line j goes to j/2 if even, to (n+1)/2 + j/2 if odd (inverse: back from there)
+// and is scaled on the way (REORDER / UNPACK)
+void Flwt::shuffleStrip(Matrix<wUnit> &source, unsigned i, unsigned s, unsigned n, wUnit *tempbank, std::vector<bool> &moved, bool inverse) {
+	unsigned low = (n+1)/2;
+	moved.assign(n, false);
+	for(unsigned start = 0; start < n; ++start) {
+		if(moved[start])
+			continue;
+		memcpy((void *) tempbank, (void *) (source.getLine(start) + i), sizeof(wUnit) * s);
+		unsigned to = start;
+		for(;;) {
+			// line that goes to "to"
+			unsigned from;
+			bool up;
+			if(inverse) {
+				from = (to % 2 == 0) ? to/2 : low + to/2;
+				up = to % 2 == 0;
+			} else {
+				from = (to < low) ? to*2 : (to - low)*2 + 1;
+				up = to < low;
+			}
+			moved[to] = true;
+			scaleLine(source.getLine(to) + i, (from == start) ? tempbank : source.getLine(from) + i, s, up != inverse);
+			if(from == start)
+				break;
+			to = from;
+		}
+	}
 }
 
 // forward column transform on WxH
-void Flwt::columnTransformF(Matrix<wUnit> &source, unsigned W, unsigned H) {
+// strips of columns walk the lines top down once (columnStepF)
+void Flwt::columnTransformF(Matrix<wUnit> &source, unsigned W, unsigned H, wUnit *tempbank, unsigned strip) {
 	unsigned m = W;
 	unsigned n = H;
+	std::vector<bool> moved(n);
+	wUnit *lines[6];
 
-	wUnit * tempbank = new wUnit[n];
-	
-	for(unsigned i = 0; i < m; ++i) {
-		// PREDICT 1
-		for(unsigned j = 1; j < n-2; j += 2)
-			source(i,j) = source(i,j) + COEF_A * (source(i,j-1) + source(i,j+1));
-		source(i,n-1) = source(i,n-1) +  2 * COEF_A * source(i,n-2);
-
-		// UPDATE 1
-		for(unsigned j = 2; j < n; j += 2)
-			source(i,j) = source(i,j) + COEF_B * (source(i,j-1) + source(i,j+1));
-		source(i,0) = source(i,0) + 2 * COEF_B * source(i,1);
-
-		// PREDICT 2
-		for(unsigned j = 1; j < n-2; j += 2)
-			source(i,j) = source(i,j) + COEF_C * (source(i,j-1) + source(i,j+1));
-		source(i,n-1) = source(i,n-1) + 2 * COEF_C * source(i,n-2);
+	for(unsigned i = 0; i < m; i += strip) {
+		unsigned s = (m - i < strip) ? m - i : strip;
 
-		// UPDATE 2
-		for(unsigned j = 2; j < n; j += 2)
-			source(i,j) = source(i,j) + COEF_D * (source(i,j-1) + source(i,j+1));
-		source(i,0) = source(i,0) + 2 * COEF_D * source(i,1);
+		for(unsigned t = 2; t <= n + 3; t += 2) {
+			for(unsigned k = 0; k < 6; ++k)
+				lines[k] = (t + k >= 5 && t + k - 5 < n) ? source.getLine(t + k - 5) + i : 0;
+			columnStepF(lines, n, t, s);
+		}
 
 		// REORDER
-		for(unsigned j = 0; j < n; ++j)
-			if(j % 2 == 0) {
-				tempbank[j/2] = source(i,j) * COEF_SCALE;
-			} else {
-				tempbank[n/2 + j/2] = source(i,j) / COEF_SCALE;
-			}
-
-		// SAVE
-		for(unsigned j = 0; j < n; ++j)
-			source(i,j) = tempbank[j];
+		shuffleStrip(source, i, s, n, tempbank, moved, false);
 	}
-
-	delete []tempbank;
 }
 
 // inverse row transform on WxH
-void Flwt::rowTransformI(Matrix<wUnit> &source, unsigned W, unsigned H) {
+void Flwt::rowTransformI(Matrix<wUnit> &source, unsigned W, unsigned H, wUnit *tempbank) {
 	unsigned m = W;
 	unsigned n = H;
 
-	wUnit * tempbank = new wUnit[m];
-	
 	for(unsigned j = 0; j < n; ++j) {
-		// UNPACK
+		// UNPACK (the low half has the odd value)
+		unsigned low = (m+1)/2;
 		for(unsigned i = 0; i < m/2; ++i) {
 			tempbank[i*2] = source(i,j) / COEF_SCALE;
-			tempbank[i*2+1] = source(i+m/2,j) * COEF_SCALE;
+			tempbank[i*2+1] = source(i+low,j) * COEF_SCALE;
 		}
+		if(m % 2)
+			tempbank[m-1] = source(low-1,j) / COEF_SCALE;
 
 		// STORE
 		for(unsigned i = 0; i < m; ++i)
@@ -115,92 +213,109 @@ void Flwt::rowTransformI(Matrix<wUnit> &source, unsigned W, unsigned H) {
 
 
 		// UPDATE 2
-		for(unsigned i = 2; i < m; i += 2)
+		for(unsigned i = 2; i+1 < m; i += 2)
 			source(i,j) = source(i,j) + (-1) * COEF_D * (source(i-1,j) + source(i+1,j));
 		source(0,j) = source(0,j) + 2 * (-1) * COEF_D * source(1,j);
+		if(m % 2)
+			source(m-1,j) = source(m-1,j) + 2 * (-1) * COEF_D * source(m-2,j);
 
 		// PREDICT 2
-		for(unsigned i = 1; i < m-2; i += 2)
+		for(unsigned i = 1; i+1 < m; i += 2)
 			source(i,j) = source(i,j) + (-1) * COEF_C * (source(i-1,j) + source(i+1,j));
-		source(m-1,j) = source(m-1,j) + 2 * (-1) * COEF_C * source(m-2,j);
+		if(m % 2 == 0)
+			source(m-1,j) = source(m-1,j) + 2 * (-1) * COEF_C * source(m-2,j);
 
 		// UPDATE 1
-		for(unsigned i = 2; i < m; i += 2)
+		for(unsigned i = 2; i+1 < m; i += 2)
 			source(i,j) = source(i,j) + (-1) * COEF_B * (source(i-1,j) + source(i+1,j));
 		source(0,j) = source(0,j) + 2 * (-1) * COEF_B * source(1,j);
+		if(m % 2)
+			source(m-1,j) = source(m-1,j) + 2 * (-1) * COEF_B * source(m-2,j);
 
 		// PREDICT 1
-		for(unsigned i = 1; i < m-2; i += 2)
+		for(unsigned i = 1; i+1 < m; i += 2)
 			source(i,j) = source(i,j) + (-1) * COEF_A * (source(i-1,j) + source(i+1,j));
-		source(m-1,j) = source(m-1,j) + 2 * (-1) * COEF_A * source(m-2,j);
+		if(m % 2 == 0)
+			source(m-1,j) = source(m-1,j) + 2 * (-1) * COEF_A * source(m-2,j);
 	}
-
-	delete []tempbank;
 }
 
 // inverse column transform on WxH
-void Flwt::columnTransformI(Matrix<wUnit> &source, unsigned W, unsigned H) {
+// strips of columns as in the forward one (columnStepI)
+void Flwt::columnTransformI(Matrix<wUnit> &source, unsigned W, unsigned H, wUnit *tempbank, unsigned strip) {
 	unsigned m = W;
 	unsigned n = H;
+	std::vector<bool> moved(n);
+	wUnit *lines[6];
 
-	wUnit * tempbank = new wUnit[n];
-	
-	for(unsigned i = 0; i < m; ++i) {
-		// UNPACK
-		for(unsigned j = 0; j < n/2; ++j) {
-			tempbank[j*2] = source(i,j) / COEF_SCALE;
-			tempbank[j*2+1] = source(i,j+n/2) * COEF_SCALE;
-		}
-
-		// STORE
-		for(unsigned j = 0; j < n; ++j)
-			source(i,j) = tempbank[j];
+	for(unsigned i = 0; i < m; i += strip) {
+		unsigned s = (m - i < strip) ? m - i : strip;
 
-		// UPDATE 2
-		for(unsigned j = 2; j < n; j += 2)
-			source(i,j) = source(i,j) + (-1) * COEF_D * (source(i,j-1) + source(i,j+1));
-		source(i,0) = source(i,0) + 2 * (-1) * COEF_D * source(i,1);
+		// UNPACK
+		shuffleStrip(source, i, s, n, tempbank, moved, true);
 
-		// PREDICT 2
-		for(unsigned j = 1; j < n-2; j += 2)
-			source(i,j) = source(i,j) + (-1) * COEF_C * (source(i,j-1) + source(i,j+1));
-		source(i,n-1) = source(i,n-1) + 2 * (-1) * COEF_C * source(i,n-2);
+		for(unsigned t = 0; t <= n + 2; t += 2) {
+			for(unsigned k = 0; k < 6; ++k)
+				lines[k] = (t + k >= 4 && t + k - 4 < n) ? source.getLine(t + k - 4) + i : 0;
+			columnStepI(lines, n, t, s);
+		}
+	}
+}
 
-		// UPDATE 1
-		for(unsigned j = 2; j < n; j += 2)
-			source(i,j) = source(i,j) + (-1) * COEF_B * (source(i,j-1) + source(i,j+1));
-		source(i,0) = source(i,0) + 2 * (-1) * COEF_B * source(i,1);
+// strip of the column steps: mapped planes take whole lines, the page cache writes back
+// whole (large) folios, so a narrower strip would have them written again for each strip
+unsigned Flwt::stripWidth(const Matrix<wUnit> &matrix) {
+	return matrix.isMapped() ? matrix.getW() : FLWT_STRIP;
+}
 
-		// PREDICT 1
-		for(unsigned j = 1; j < n-2; j += 2)
-			source(i,j) = source(i,j) + (-1) * COEF_A * (source(i,j-1) + source(i,j+1));
-		source(i,n-1) = source(i,n-1) + 2 * (-1) * COEF_A * source(i,n-2);
-	}
+// scratch line for the reorder steps, one per forward / inverse call
+wUnit * Flwt::getTempBank(unsigned size, Arena *arena) {
+	if(arena)
+		return (wUnit *) arena->allocate(sizeof(wUnit) * size);
+	return new wUnit[size];
+}
 
-	delete []tempbank;
+// give the scratch line back
+void Flwt::freeTempBank(wUnit *tempbank, unsigned size, Arena *arena) {
+	if(arena)
+		arena->release((void *) tempbank, sizeof(wUnit) * size);
+	else
+		delete []tempbank;
 }
 
 // forward transform wrapper (continuous)
 // special: if output has already been a subject of transform, carry on from saved bandSizes, not WxH
-void Flwt::forward(unsigned level, Matrix<wUnit>& output) {
+void Flwt::forward(unsigned level, Matrix<wUnit>& output, Arena *arena) {
 	if(level > 0) {
 		unsigned W = output.getW();
 		unsigned H = output.getH();
 		if(output.bandSizeW > 0 && output.bandSizeH > 0) {
 			W = output.bandSizeW; H = output.bandSizeH; 
 		} 
+		unsigned strip = stripWidth(output);
+		unsigned bankSize = (W > H) ? W : H;
+		wUnit * tempbank = getTempBank(bankSize, arena);
 		for(unsigned d = 0; d < level; d++) {
-			if(W%2 || H%2) {
+			if(W < 2 || H < 2) {
 				std::cout << std::endl << "FLWT::forward level setting wrong (too high)" << std::endl;
 				break;
 			}
 
-			Flwt::columnTransformF(output, W, H);
-			Flwt::rowTransformF(output, W, H);
-
-			W = W/2;
-			H = H/2;
+			TraceSpan span("forward WT level", d);
+			PerfSpan counters("forward WT level", d);
+			// mapped planes: column steps sweep the lines once & shuffle them, rows pass once
+			output.advise(PlaneStore::accessNormal);
+			Flwt::columnTransformF(output, W, H, tempbank, strip);
+			output.advise(PlaneStore::accessSequential);
+			Flwt::rowTransformF(output, W, H, tempbank);
+
+			// odd sides: the low band keeps the odd sample
+			W = bandSide(W, 1);
+			H = bandSide(H, 1);
 		}
+		output.advise(PlaneStore::accessNormal);
+
+		freeTempBank(tempbank, bankSize, arena);
 
 		output.bandSizeW = W;
 		output.bandSizeH = H;
@@ -211,35 +326,41 @@ void Flwt::forward(unsigned level, Matrix<wUnit>& output) {
 }
 
 // inverse transfrom wrapper
-void Flwt::inverse(unsigned level, Matrix<wUnit>& output) {
+void Flwt::inverse(unsigned level, Matrix<wUnit>& output, Arena *arena) {
 	
 	if(level > 0) {
 		// dimensions of the highest level
-		unsigned W = output.getW();
-		unsigned H = output.getH();
-		unsigned i = level - 1;
-	
-		while(i > 0) {
-			W /= 2;
-			H /= 2;
-			i--;
-		}
+		unsigned W = bandSide(output.getW(), level - 1);
+		unsigned H = bandSide(output.getH(), level - 1);
 
 		output.bandSizeW = W;
 		output.bandSizeH = H;
 
+		unsigned strip = stripWidth(output);
+		unsigned bankSize = (output.getW() > output.getH()) ? output.getW() : output.getH();
+		wUnit * tempbank = getTempBank(bankSize, arena);
+
 		for(unsigned d = 0; d < level; d++) {
-			if(W%2 || H%2) {
+			if(W < 2 || H < 2) {
 				std::cout << std::endl << "FLWT::inverse level setting wrong (too high)" << std::endl;
 				break;
 			}
-			
-			Flwt::rowTransformI(output, W, H);
-			Flwt::columnTransformI(output, W, H);
 
-			W = W*2;
-			H = H*2;
+			TraceSpan span("inverse WT level", d);
+			PerfSpan counters("inverse WT level", d);
+			output.advise(PlaneStore::accessSequential);
+			Flwt::rowTransformI(output, W, H, tempbank);
+			output.advise(PlaneStore::accessNormal);
+			Flwt::columnTransformI(output, W, H, tempbank, strip);
+
+			// sides of the next lower level, odd ones too
+			if(d + 1 < level) {
+				W = bandSide(output.getW(), level - d - 2);
+				H = bandSide(output.getH(), level - d - 2);
+			}
 		}
+
+		freeTempBank(tempbank, bankSize, arena);
 	} else {
 		std::cout << std::endl << "FLWT::inverse level setting wrong (0)" << std::endl;
 	}
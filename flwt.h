@@ -4,19 +4,50 @@
 #define FLWT_H
 
 #include "general.h"
+#include <vector>
+
+// columns lifted together by the column transforms, walking the lines top down
+#define FLWT_STRIP 16
 
 // this class performs a 2D-DWT on a Matrix<wUnit>
 // using CDF 9/7 fast lifting scheme transform
+// sides of any length >= 2: odd ones are extended symmetrically at the end, the low band
+// gets the odd sample, so the bands of a level are ceil(n/2) and floor(n/2) long (bandSide())
 class Flwt {
+	// micro benchmarks time the lifting steps one by one
+	friend class Bench;
+	// line-based forward transform
+	friend class FlwtStream;
+
 	// direct transform performers
-	static void rowTransformF(Matrix<wUnit> &source, unsigned W, unsigned H);
-	static void columnTransformF(Matrix<wUnit> &source, unsigned W, unsigned H);
-	static void rowTransformI(Matrix<wUnit> &source, unsigned W, unsigned H);
-	static void columnTransformI(Matrix<wUnit> &source, unsigned W, unsigned H);
+	// tempbank: scratch line of at least max(W,H) values
+	static void rowTransformF(Matrix<wUnit> &source, unsigned W, unsigned H, wUnit *tempbank);
+	static void columnTransformF(Matrix<wUnit> &source, unsigned W, unsigned H, wUnit *tempbank, unsigned strip = FLWT_STRIP);
+	static void rowTransformI(Matrix<wUnit> &source, unsigned W, unsigned H, wUnit *tempbank);
+	static void columnTransformI(Matrix<wUnit> &source, unsigned W, unsigned H, wUnit *tempbank, unsigned strip = FLWT_STRIP);
+	// columns of a strip for the plane
+	static unsigned stripWidth(const Matrix<wUnit> &matrix);
+
+	// pieces of the transforms, shared with the line-based one (FlwtStream)
+	// forward row transform of one line of m values
+	static void lineTransformF(wUnit *line, unsigned m, wUnit *tempbank);
+	// column lifting steps due at even line t of a band of n lines, on s values of each line:
+	// forward: lines[k] is line t-5+k, lines t-4 & t-3 are done after it
+	static void columnStepF(wUnit *const *lines, unsigned n, unsigned t, unsigned s);
+	// inverse: lines[k] is line t-4+k
+	static void columnStepI(wUnit *const *lines, unsigned n, unsigned t, unsigned s);
+	// REORDER / UNPACK scaling, up or down
+	static void scaleLine(wUnit *dst, const wUnit *src, unsigned s, bool up);
+	// REORDER / UNPACK of the lines of a column strip in place (moved: flags of n lines)
+	static void shuffleStrip(Matrix<wUnit> &source, unsigned i, unsigned s, unsigned n, wUnit *tempbank, std::vector<bool> &moved, bool inverse);
+	// scratch line handling (arena or heap)
+	static wUnit * getTempBank(unsigned size, Arena *arena);
+	static void freeTempBank(wUnit *tempbank, unsigned size, Arena *arena);
 public:
 	// interface
-	static void forward(unsigned level, Matrix<wUnit> & matrix);
-	static void inverse(unsigned level, Matrix<wUnit> & matrix);
+	// arena: optional source of the scratch memory
+	static void forward(unsigned level, Matrix<wUnit> & matrix, Arena *arena = 0);
+	static void inverse(unsigned level, Matrix<wUnit> & matrix, Arena *arena = 0);
 
 	//// static properties
 	//static unsigned lastBandSizeW;
@@ -0,0 +1,116 @@
+// flwtstream implementation
+#include "flwtstream.h"
+#include <iostream>
+#include <cstring>
+
+// bands of the levels, a ring of lines each
+FlwtStream::FlwtStream(Matrix<wUnit> &output, unsigned levels, Arena *arena)
+	: output_(output), arena_(arena), lines_(0), line_(0), tempbank_(0) {
+	unsigned W = output.getW();
+	unsigned H = output.getH();
+
+	if(levels == 0)
+		std::cout << std::endl << "FLWT::forward level setting wrong (0)" << std::endl;
+	for(unsigned d = 0; d < levels; d++) {
+		if(W < 2 || H < 2) {
+			std::cout << std::endl << "FLWT::forward level setting wrong (too high)" << std::endl;
+			break;
+		}
+		Level level;
+		level.W = W;
+		level.H = H;
+		level.ring = Flwt::getTempBank(FLWTSTREAM_RING * W, arena_);
+		level.lines = 0;
+		levels_.push_back(level);
+
+		W = bandSide(W, 1);
+		H = bandSide(H, 1);
+	}
+
+	if(!levels_.empty()) {
+		line_ = Flwt::getTempBank(output.getW(), arena_);
+		tempbank_ = Flwt::getTempBank(output.getW(), arena_);
+	}
+
+	output_.bandSizeW = W;
+	output_.bandSizeH = H;
+}
+
+// lines back in reverse order (arena pages roll back)
+FlwtStream::~FlwtStream() {
+	if(!levels_.empty()) {
+		Flwt::freeTempBank(tempbank_, output_.getW(), arena_);
+		Flwt::freeTempBank(line_, output_.getW(), arena_);
+	}
+	for(size_t d = levels_.size(); d > 0; --d)
+		Flwt::freeTempBank(levels_[d-1].ring, FLWTSTREAM_RING * levels_[d-1].W, arena_);
+}
+
+// next line of the plane
+void FlwtStream::push(const wUnit *line) {
+	if(lines_ >= output_.getH())
+		return;
+	if(levels_.empty())
+		memcpy((void *) output_.getLine(lines_), (void *) line, sizeof(wUnit) * output_.getW());
+	else
+		pushLevel(0, line);
+	lines_++;
+}
+
+// all lines in
+bool FlwtStream::done() const {
+	return lines_ == output_.getH();
+}
+
+// a column step is due at each even line, the last line runs the two steps of the bottom edge
+// (up to H+3, see Flwt::columnStepF)
+void FlwtStream::pushLevel(unsigned d, const wUnit *line) {
+	Level &level = levels_[d];
+	unsigned j = level.lines++;
+	memcpy((void *) (level.ring + (j % FLWTSTREAM_RING) * level.W), (void *) line, sizeof(wUnit) * level.W);
+
+	if(j % 2 == 0 && j >= 2)
+		step(d, j);
+	if(j == level.H - 1)
+		for(unsigned t = (j & ~1u) + 2; t <= level.H + 3; t += 2)
+			step(d, t);
+}
+
+// lifting steps on t-1..t-4, lines t-4 & t-3 done
+void FlwtStream::step(unsigned d, unsigned t) {
+	Level &level = levels_[d];
+	wUnit *lines[6];
+	for(unsigned k = 0; k < 6; ++k)
+		lines[k] = (t + k >= 5 && t + k - 5 < level.H) ? level.ring + ((t + k - 5) % FLWTSTREAM_RING) * level.W : 0;
+
+	Flwt::columnStepF(lines, level.H, t, level.W);
+
+	if(t >= 4 && t - 4 < level.H)
+		emit(d, t - 4, lines[1]);
+	if(t >= 3 && t - 3 < level.H)
+		emit(d, t - 3, lines[2]);
+}
+
+// REORDER of the columns (scaling, place of the line), row transform, out or down
+void FlwtStream::emit(unsigned d, unsigned j, const wUnit *line) {
+	Level &level = levels_[d];
+	unsigned W = level.W;
+	// low halves take the odd line & value
+	unsigned lowH = (level.H + 1)/2;
+	unsigned lowW = (W + 1)/2;
+
+	Flwt::scaleLine(line_, line, W, j % 2 == 0);
+	Flwt::lineTransformF(line_, W, tempbank_);
+
+	if(j % 2) {
+		memcpy((void *) output_.getLine(lowH + j/2), (void *) line_, sizeof(wUnit) * W);
+	} else {
+		wUnit *out = output_.getLine(j/2);
+		memcpy((void *) (out + lowW), (void *) (line_ + lowW), sizeof(wUnit) * (W - lowW));
+		// line_ is copied into the ring of the next level before it is used again
+		if(d + 1 < levels_.size())
+			pushLevel(d + 1, line_);
+		else
+			memcpy((void *) out, (void *) line_, sizeof(wUnit) * lowW);
+	}
+}
@@ -0,0 +1,57 @@
+// flwtstream: line-based forward WT, lines of a plane go in top down, coefficients go out into the plane
+#ifndef FLWTSTREAM_H
+#define FLWTSTREAM_H
+
+#include "flwt.h"
+#include <vector>
+
+// lines kept per level: the window of a column step
+#define FLWTSTREAM_RING 6
+
+// class FlwtStream
+// forward WT of one plane fed line by line (push), same coefficients as Flwt::forward
+// each level keeps a ring of FLWTSTREAM_RING lines of its band for the column steps (Flwt::columnStepF),
+// a line done there is scaled, gets the row transform and goes out: high lines and the high half of low ones
+// to their place in the output plane, the low half down to the next level as its next line (the last level
+// writes it out too); besides the output it holds O(width x levels) values, the plane of pixels is never there
+// and the output is written once, about in line order
+class FlwtStream {
+	// band of a level & its lines
+	struct Level {
+		unsigned W;
+		unsigned H;
+		wUnit *ring;		// FLWTSTREAM_RING lines of W, line j in slot j % FLWTSTREAM_RING
+		unsigned lines;		// lines received
+	};
+
+	Matrix<wUnit> &output_;
+	Arena *arena_;
+	std::vector<Level> levels_;
+	unsigned lines_;		// lines pushed (no levels: copied straight)
+	wUnit *line_;			// line in the row transform
+	wUnit *tempbank_;		// scratch of the row transform
+
+	// not copyable
+	FlwtStream(const FlwtStream&);
+	FlwtStream& operator= (const FlwtStream&);
+
+	// next line of level d
+	void pushLevel(unsigned d, const wUnit *line);
+	// column step at line t of level d, lines done by it go out
+	void step(unsigned d, unsigned t);
+	// line j of level d done by the column steps
+	void emit(unsigned d, unsigned j, const wUnit *line);
+
+public:
+	// output: plane of the image size (init() done), levels: of the transform, arena: optional source of the lines
+	// levels over what the size allows are cut with the message of Flwt::forward
+	FlwtStream(Matrix<wUnit> &output, unsigned levels, Arena *arena = 0);
+	~FlwtStream();
+
+	// next line of the plane (output width), the last one finishes the transform
+	void push(const wUnit *line);
+	// all lines in, output done
+	bool done() const;
+};
+
+#endif
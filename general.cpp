@@ -11,3 +11,11 @@ wUnit log2(wUnit x)
 wUnit round(wUnit x) {
 	return (x < floor(x) + 0.5) ? floor(x) : ceil(x);
 }
+
+// index of the highest bit set, floor(log2(x)) for integers (0 for x=0)
+unsigned highestBit(qUnit x) {
+	unsigned n = 0;
+	while(x >>= 1)
+		n++;
+	return n;
+}
@@ -8,14 +8,41 @@
 #include <fstream>
 #include <iostream>
 #include <iomanip>
+#include <utility>
+#include <stdint.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#include "arena.h"
+#include "planestore.h"
 
 // unit of pixel values
 typedef double wUnit;
+// unit of quantized coefficient magnitudes
+typedef unsigned qUnit;
 // unit of coordinate values
 typedef unsigned short wCoord;
+// unit of coordinate values of images over 65535 a side
+typedef unsigned wCoordWide;
+// unit of bit counts & positions in bitstreams
+typedef uint64_t bitCount;
 // general algorithm enum
 enum typeVal { typeA, typeB }; 
 
+// images with a side over the range of wCoord are coded with wCoordWide coordinates
+inline bool wideCoords(unsigned width, unsigned height) {
+	return width > 0xFFFF || height > 0xFFFF;
+}
+
+// side of the low band after given WT levels on a side of size: ceil(size / 2^levels),
+// each level keeps the odd sample in the low band, the high band of the level has the rest
+inline unsigned bandSide(unsigned size, unsigned levels) {
+	if(levels >= 32)
+		return size ? 1 : 0;
+	return (unsigned) (((uint64_t) size + ((uint64_t) 1 << levels) - 1) >> levels);
+}
+
 // bitstream versioning
 #define VER_CSPIHT 0x0A
 #define VER_BSPIHT 0x0B
@@ -28,6 +55,8 @@ template <class Type> class Matrix {
 	unsigned w_;
 	unsigned h_;
 	Type *map_;
+	Arena *arena_;	// owner of map_, heap if not set
+	PlaneStore::Backing backing_;	// mapped file instead of the arena / heap (memory budget)
 
 public:	
 	// exceptions
@@ -36,48 +65,50 @@ public:
 
 	// empty map init constructor
 	Matrix()
-		: w_(0), h_(0), map_(0), bandSizeW(0), bandSizeH(0) {}
+		: w_(0), h_(0), map_(0), arena_(0), backing_(PlaneStore::backingMemory), bandSizeW(0), bandSizeH(0) {}
 
 	// map init constructor to size
 	Matrix(unsigned w, unsigned h)
-		: w_(w), h_(h), map_(0), bandSizeW(0), bandSizeH(0) {
+		: w_(w), h_(h), map_(0), arena_(0), backing_(PlaneStore::backingMemory), bandSizeW(0), bandSizeH(0) {
 			init(w, h);
 	}
 
 	// copy constructor
-	Matrix(const Matrix& copy): map_(0), w_(0), h_(0), bandSizeW(0), bandSizeH(0) {
-		w_ = copy.getW();
-		h_ = copy.getH();
-		bandSizeW = copy.bandSizeW;
-		bandSizeH = copy.bandSizeH;
-
-		if(w_ == 0 || h_ == 0) {
-			map_ = 0;
-		} else {
-			init(w_, h_);
-			for(unsigned i=0; i<h_; ++i)
-				memcpy((void *) &map_[i * w_], (void *) copy.getLine(i), sizeof(Type) * w_); 
-		}
+	Matrix(const Matrix& copy): w_(0), h_(0), map_(0), arena_(copy.arena_), backing_(PlaneStore::backingMemory), bandSizeW(0), bandSizeH(0) {
+		assign(copy);
+	}
+
+	// move constructor - steals the buffer, leaves copy empty
+	Matrix(Matrix&& copy): w_(copy.w_), h_(copy.h_), map_(copy.map_), arena_(copy.arena_), backing_(copy.backing_), bandSizeW(copy.bandSizeW), bandSizeH(copy.bandSizeH) {
+		copy.w_ = 0;
+		copy.h_ = 0;
+		copy.map_ = 0;
+		copy.backing_ = PlaneStore::backingMemory;
+		copy.bandSizeW = 0;
+		copy.bandSizeH = 0;
 	}
 
 	// assigment operator 
 	Matrix& operator= (const Matrix& src) {
 		// case of equality
+		if(this != &src)
+			assign(src);
+		return *this; 
+	}
+
+	// move assigment operator - swaps buffers, src frees ours
+	Matrix& operator= (Matrix&& src) {
 		if(this != &src) {
-			w_ = src.getW();
-			h_ = src.getH();
+			std::swap(w_, src.w_);
+			std::swap(h_, src.h_);
+			std::swap(map_, src.map_);
+			std::swap(arena_, src.arena_);
+			std::swap(backing_, src.backing_);
 			bandSizeW = src.bandSizeW;
 			bandSizeH = src.bandSizeH;
-		
-			if(w_ == 0 || h_ == 0) {
-				map_ = 0;
-			} else {
-				init(w_, h_);
-				for(unsigned i=0; i<h_; ++i)
-					memcpy((void *) &map_[i * w_], (void *) src.getLine(i), sizeof(Type) * w_);
-			}
+			src.free();
 		}
-		return *this; 
+		return *this;
 	}
 
 	// () operator overload - mutator
@@ -86,7 +117,7 @@ public:
 			throw ExNotDefined();
 		if(x >= w_ || y >= h_)
 			throw ExOutOfRange();
-		return map_[y*w_ + x];
+		return map_[(size_t) y*w_ + x];
 	}
 
 	// () operator overload - inspector
@@ -95,33 +126,59 @@ public:
 			throw ExNotDefined();
 		if(x >= w_ || y >= h_)
 			throw ExOutOfRange();
-		return map_[y*w_ + x];
+		return map_[(size_t) y*w_ + x];
 	}
 
 
 	// init handler
+	// buffer of the same size is reused, only zeroed
 	void init(unsigned w, unsigned h) {
-		if(map_)
-			delete []map_;
 		if(w == 0 || h == 0) {
+			free();
 			return;
 		}
-		w_ = w;
-		h_ = h;
+		bool zeroed = allocate(w, h);
 		bandSizeW = 0; bandSizeH = 0;
-		map_ = new Type[w * h];
-		// delete all to zero
-		memset((void *) map_, 0, sizeof(Type) * (w * h)); 
+		// delete all to zero (a new mapping is, no need to touch all its pages)
+		if(!zeroed)
+			memset((void *) map_, 0, sizeof(Type) * ((size_t) w * h)); 
 	}
 
 	// free handler (for pairing)
 	void free() {
-		if(map_)
-			delete []map_;
+		if(map_) {
+			if(backing_ != PlaneStore::backingMapped) {
+				if(arena_)
+					arena_->release((void *) map_, sizeof(Type) * ((size_t) w_ * h_));
+				else
+					delete []map_;
+			}
+			PlaneStore::give((void *) map_, sizeof(Type) * ((size_t) w_ * h_), backing_);
+		}
+		map_ = 0;
+		backing_ = PlaneStore::backingMemory;
 		w_ = 0;
 		h_ = 0;
 	}
 
+	// draw further allocations from the arena (0 = heap)
+	// current contents are dropped
+	void setArena(Arena *arena) {
+		free();
+		arena_ = arena;
+	}
+
+	// access pattern of the next stage, taken by mapped planes only
+	void advise(PlaneStore::Access access) const {
+		if(backing_ == PlaneStore::backingMapped)
+			PlaneStore::advise((void *) map_, sizeof(Type) * ((size_t) w_ * h_), access);
+	}
+
+	// buffer is a mapped file
+	bool isMapped() const {
+		return backing_ == PlaneStore::backingMapped;
+	}
+
 	// get width
 	unsigned getW() const {
 		return w_;
@@ -136,11 +193,11 @@ public:
 	Type* getLine(unsigned y) const {
 		if(y >= h_)
 			throw ExOutOfRange();
-		return &map_[y * w_];
+		return &map_[(size_t) y * w_];
 	}
 
 	// copy whole matrix (ins) into matrix at position x,y of width and height w,h
-	bool copyMatrix(unsigned x, unsigned y, unsigned w, unsigned h, Matrix ins) {
+	bool copyMatrix(unsigned x, unsigned y, unsigned w, unsigned h, const Matrix& ins) {
 		// check if wide enough
 		if(x + w > getW() || y + h > getH())		
 			return false;
@@ -187,11 +244,62 @@ public:
 
 	unsigned bandSizeW;
 	unsigned bandSizeH;
+
+private:
+	// (re)alloc to WxH without zeroing, keeps the buffer if the size matches
+	// planes over the memory budget get a mapped file, true if so (reads as zeros)
+	bool allocate(unsigned w, unsigned h) {
+		if(map_ && w_ == w && h_ == h)
+			return false;
+		free();
+		map_ = (Type *) PlaneStore::take(sizeof(Type) * ((size_t) w * h), backing_);
+		bool mapped = map_ != 0;
+		if(!mapped) {
+			if(arena_)
+				map_ = (Type *) arena_->allocate(sizeof(Type) * ((size_t) w * h));
+			else
+				map_ = new Type[(size_t) w * h];
+		}
+		w_ = w;
+		h_ = h;
+		return mapped;
+	}
+
+	// deep copy of src, used by copy constructor and assigment
+	void assign(const Matrix& src) {
+		if(src.getW() == 0 || src.getH() == 0) {
+			free();
+		} else {
+			allocate(src.getW(), src.getH());
+			memcpy((void *) map_, (void *) src.map_, sizeof(Type) * ((size_t) w_ * h_));
+		}
+		bandSizeW = src.bandSizeW;
+		bandSizeH = src.bandSizeH;
+	}
 };
 
 // general function prototypes - definitions in .cpp
 wUnit log2(wUnit x);
 wUnit round(wUnit x);
+unsigned highestBit(qUnit x);
+
+// index of the lowest bit set in a nonzero 64-bit word
+inline unsigned lowestBit64(uint64_t x) {
+#if defined(_MSC_VER) && defined(_M_X64)
+	unsigned long n;
+	_BitScanForward64(&n, x);
+	return (unsigned) n;
+#elif defined(__GNUC__)
+	return (unsigned) __builtin_ctzll(x);
+#else
+	unsigned n = 0;
+	while(!(x & 1)) {
+		x >>= 1;
+		n++;
+	}
+	return n;
+#endif
+}
 
 
 #endif
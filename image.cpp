@@ -1,9 +1,14 @@
 #include "image.h"
+#include "trace.h"
+#include "perfcounters.h"
+#include "flwtstream.h"
 
 #include <iostream>
 #include <fstream>
 #include <string.h>
 #include <cmath>
+#include <utility>
+#include <vector>
 
 // implicit constructor, create memory
 Image::Image(): width_(0), height_(0), loaded_(0) {
@@ -22,34 +27,52 @@ Image::Image(const Image& copy): width_(0), height_(0), loaded_(0) {
 	}
 }
 
+// move constructor, takes over the planes of copy
+Image::Image(Image&& copy): width_(copy.width_), height_(copy.height_), loaded_(copy.loaded_) {
+	image_ = copy.image_;
+	copy.image_ = 0;
+	copy.width_ = 0;
+	copy.height_ = 0;
+	copy.loaded_ = false;
+}
+
 // assigment operator
+// planes of the same size are overwritten in place
 Image& Image::operator= (const Image& src) {
 	// detect case of equality
 	if(this != &src) {
+		if(!image_)
+			image_ = new Matrix<wUnit> [3];
 		// source loaded 
 		if(src.isLoaded()) {
-			// exists? free this memory and realloc
-			if(loaded_) {
-				delete []image_;
-				image_ = new Matrix<wUnit> [3];
-			}
 			width_ = src.getWidth();
 			height_ = src.getHeight();
 			loaded_ = true;
 			for(unsigned i=0; i<3; ++i)
 				image_[i] = src.getMatrix((planeVal) i);
 		} else {
-			// delete, re-alloc, mark not loaded
-			if(loaded_) {
-				delete []image_;
-				image_ = new Matrix<wUnit> [3];
-				loaded_ = false;
-			}
+			// free, mark not loaded
+			for(unsigned i=0; i<3; ++i)
+				image_[i].free();
+			width_ = 0;
+			height_ = 0;
+			loaded_ = false;
 		}
 	}
 	return *this; 
 }
 
+// move assigment operator
+Image& Image::operator= (Image&& src) {
+	if(this != &src) {
+		std::swap(image_, src.image_);
+		std::swap(width_, src.width_);
+		std::swap(height_, src.height_);
+		std::swap(loaded_, src.loaded_);
+	}
+	return *this;
+}
+
 // destructor
 Image::~Image() {
 	delete []image_;
@@ -84,19 +107,20 @@ bool Image::isLoaded() const {
 	return loaded_;
 }
 
-// load BMP image
-// so far accepts only 24bit uncompressed
-// 8bit per channel, values 0...255 !
-bool Image::loadBMP(const char *filename) {
-	std::ifstream file;
+// one pixel RGB to YCbCr, values taken from MATLAB rgb2ycbcr.m
+static inline void rgb2YCbCr(wUnit r, wUnit g, wUnit b, wUnit &y, wUnit &cB, wUnit &cR) {
+	y  =  16.0  + 0.256788235294118 * r   + 0.504129411764706 * g		+ 0.0979058823529412 * b;
+	cB = 128.0  - 0.148223529411765 * r   - 0.290992156862745 * g		+ 0.4392156862745100 * b;
+	cR = 128.0  + 0.439215686274510 * r	- 0.367788235294118 * g		- 0.0714274509803921 * b;
+}
 
-	// open file
-	file.open(filename, std::ios::binary);
-	if(!file.is_open()) {
-		std::cout << "Unable to open file \"" << filename << "\"" << std::endl; 
-		return false;
-	}
+// bytes of a BMP line: 3 per pixel, padded to 4 (widths not divisible by 4)
+static inline size_t bmpLineBytes(unsigned sizex) {
+	return ((size_t) sizex * 3 + 3) & ~(size_t) 3;
+}
 
+// header of a 24-bit BMP, file closed if it's unusable
+bool Image::readBMPHeader(std::ifstream &file, int &sizex, int &sizey) {
 	// BMP head
 	SHeader bmpHeader;
 
@@ -108,7 +132,7 @@ bool Image::loadBMP(const char *filename) {
 		return false;
 	}
 	
-	int sizex, sizey, bpp=0;
+	int bpp=0;
 	sizex = bmpHeader.biWidth;
 	sizey = bmpHeader.biHeight;
 	bpp = bmpHeader.biBitCount;
@@ -118,12 +142,35 @@ bool Image::loadBMP(const char *filename) {
 		file.close();
 		return false;
 	}
+	return true;
+}
+
+// load BMP image
+// so far accepts only 24bit uncompressed
+// 8bit per channel, values 0...255 !
+bool Image::loadBMP(const char *filename) {
+	TraceSpan span("load BMP");
+	PerfSpan counters("load BMP");
+	std::ifstream file;
+
+	// open file
+	file.open(filename, std::ios::binary);
+	if(!file.is_open()) {
+		std::cout << "Unable to open file \"" << filename << "\"" << std::endl; 
+		return false;
+	}
+
+	int sizex, sizey;
+	if(!readBMPHeader(file, sizex, sizey))
+		return false;
 
 	// alloc space for image contents
-	char * buffer = new char[sizex * sizey * 3];
+	size_t lineBytes = bmpLineBytes(sizex);
+	size_t bytes = lineBytes * sizey;
+	char * buffer = new char[bytes];
 	// read the image
-	file.read(buffer, sizex * sizey * 3);
-	if(file.gcount() < sizex * sizey * 3) {
+	file.read(buffer, bytes);
+	if((size_t) file.gcount() < bytes) {
 		std::cout << "BMP image in file either damaged or incomplete" << std::endl; 
 		delete []buffer;
 		file.close();
@@ -134,8 +181,8 @@ bool Image::loadBMP(const char *filename) {
 	clear(sizex, sizey);
 
 	// fill up with values
-	char * ptr = buffer;
 	for(int j=0; j < sizey; ++j) {
+		char * ptr = buffer + lineBytes * j;
 		for(int i=0; i < sizex; ++i) {
 			image_[BMP_RPLANE](i,sizey-j-1) = (wUnit) (unsigned char) *ptr++;
 			image_[BMP_GPLANE](i,sizey-j-1) = (wUnit) (unsigned char) *ptr++;
@@ -151,10 +198,99 @@ bool Image::loadBMP(const char *filename) {
 	return true;
 }
 
+// load BMP image straight into WT coefficients
+// the lines are read bottom up in bands of IMAGE_BMP_BAND (the file is stored bottom up), go through
+// RGB2YCbCr and substract128 and are pushed top down into a line-based forward WT of each plane,
+// the same values as loadBMP, transformRGB2YCbCr, substract128 and Flwt::forward; no pixels are held
+bool Image::loadBMPForward(const char *filename, const unsigned levels[3], Arena *arena) {
+	TraceSpan span("load BMP & forward WT");
+	PerfSpan counters("load BMP & forward WT");
+	std::ifstream file;
+
+	// open file
+	file.open(filename, std::ios::binary);
+	if(!file.is_open()) {
+		std::cout << "Unable to open file \"" << filename << "\"" << std::endl; 
+		return false;
+	}
+
+	int sizex, sizey;
+	if(!readBMPHeader(file, sizex, sizey))
+		return false;
+
+	// the whole image must be there before the planes are touched
+	size_t lineBytes = bmpLineBytes(sizex);
+	file.seekg(0, std::ios::end);
+	if((uint64_t) file.tellg() < 54 + (uint64_t) lineBytes * sizey) {
+		std::cout << "BMP image in file either damaged or incomplete" << std::endl; 
+		file.close();
+		return false;
+	}
+
+	// init planes in image structure, they take the coefficients
+	clear(sizex, sizey);
+	FlwtStream *streams[3];
+	for(unsigned p=0; p<3; ++p)
+		streams[p] = new FlwtStream(image_[p], levels[p], arena);
+
+	std::vector<char> buffer(lineBytes * IMAGE_BMP_BAND);
+	std::vector<wUnit> lines((size_t) sizex * 3);
+	wUnit *yLine = &lines[0];
+	wUnit *cBLine = yLine + sizex;
+	wUnit *cRLine = cBLine + sizex;
+
+	bool read = true;
+	for(int top=0; top < sizey && read; top += IMAGE_BMP_BAND) {
+		int band = (sizey - top < IMAGE_BMP_BAND) ? sizey - top : IMAGE_BMP_BAND;
+		// lines top..top+band-1 are the last ones of the file, in reverse
+		file.seekg(54 + (uint64_t) lineBytes * (sizey - top - band));
+		file.read(&buffer[0], lineBytes * band);
+		if((size_t) file.gcount() < lineBytes * band) {
+			read = false;
+			break;
+		}
+
+		for(int j=0; j < band; ++j) {
+			const unsigned char *ptr = (const unsigned char *) &buffer[lineBytes * (band - j - 1)];
+			for(int i=0; i < sizex; ++i) {
+				// B, G, R
+				rgb2YCbCr((wUnit) ptr[2], (wUnit) ptr[1], (wUnit) ptr[0], yLine[i], cBLine[i], cRLine[i]);
+				yLine[i] = yLine[i] - 128.0;
+				cBLine[i] = cBLine[i] - 128.0;
+				cRLine[i] = cRLine[i] - 128.0;
+				ptr += 3;
+			}
+			streams[y]->push(yLine);
+			streams[cB]->push(cBLine);
+			streams[cR]->push(cRLine);
+		}
+	}
+
+	// last made first: their lines roll back from the top of the arena
+	for(unsigned p=3; p>0; --p)
+		delete streams[p-1];
+	file.close();
+
+	if(!read) {
+		std::cout << "BMP image in file either damaged or incomplete" << std::endl; 
+		for(unsigned p=0; p<3; ++p)
+			image_[p].free();
+		width_ = 0;
+		height_ = 0;
+		loaded_ = false;
+		return false;
+	}
+
+	std::cout << "File \"" << filename << "\" loaded... OK" << std::endl;
+	return true;
+}
+
 // save BMP image
 // very simple, 24-bit format, BGR layout, 54byte header
 // 8bit per channel, values 0...255 !
 bool Image::saveBMP(const char *filename) {
+	TraceSpan span("save BMP");
+	PerfSpan counters("save BMP");
 	if(!loaded_) {
 		std::cout << "Can't save as BMP: No image defined" << std::endl;
 		return false;
@@ -172,7 +308,8 @@ bool Image::saveBMP(const char *filename) {
 	// init structure
 	SHeader bHead;
 	bHead.bfType = BF_TYPE;
-	bHead.bfSize = 54 + (3 * width_ * height_);
+	size_t lineBytes = bmpLineBytes(width_);
+	bHead.bfSize = (unsigned) (54 + lineBytes * height_);
 	bHead.bfReserved1 = 0;
 	bHead.bfReserved2 = 0;
 	bHead.bfOffBits = 54;
@@ -182,7 +319,7 @@ bool Image::saveBMP(const char *filename) {
 	bHead.biPlanes = 1;
 	bHead.biBitCount = 24;
 	bHead.biCompression = 0;
-	bHead.biSizeImage = (3 * width_ * height_);
+	bHead.biSizeImage = (unsigned) (lineBytes * height_);
 	bHead.biXPelsPerMeter = 7200;
 	bHead.biYPelsPerMeter = 7200;
 	bHead.biClrUsed = 0;
@@ -191,12 +328,14 @@ bool Image::saveBMP(const char *filename) {
 	// save structure to file
 	file.write((char *) &bHead, 54);
 
-	// now prepare buffer of chars to write
-	char * buffer = new char[3 * width_ * height_];
+	// now prepare buffer of chars to write (line padding zeroed)
+	size_t bytes = lineBytes * height_;
+	char * buffer = new char[bytes];
+	memset(buffer, 0, bytes);
 	
 	// prepare the bitmap
-	char * ptr = buffer;
 	for(unsigned j=0; j < height_; ++j) {
+		char * ptr = buffer + lineBytes * j;
 		for(unsigned i=0; i < width_; ++i) {
 			*(ptr++) = (char) (unsigned char) image_[BMP_RPLANE](i,height_-j-1);
 			*(ptr++) = (char) (unsigned char) image_[BMP_GPLANE](i,height_-j-1);
@@ -205,7 +344,7 @@ bool Image::saveBMP(const char *filename) {
 	}
 
 	// save the bitmap
-	file.write(buffer, 3 * width_ * height_);
+	file.write(buffer, bytes);
 
 	std::cout << "Image saved to file \"" << filename << "\"... OK" << std::endl;
 	delete []buffer;
@@ -247,6 +386,7 @@ void Image::roundValues() {
 // transform RGB to YCbCr
 // based on Rec 601-1 specs
 void Image::transformRGB2YCbCr() {
+	TraceSpan span("RGB2YCbCr");
 	if(loaded_) {
 		for(unsigned j=0; j<height_; ++j)
 			for(unsigned i=0; i<width_; ++i) {
@@ -255,10 +395,7 @@ void Image::transformRGB2YCbCr() {
 				wUnit g = image_[1](i,j);
 				wUnit b = image_[2](i,j);
 				
-				// do transform, values taken from MATLAB rgb2ycbcr.m
-				image_[0](i,j) =  16.0  + 0.256788235294118 * r   + 0.504129411764706 * g		+ 0.0979058823529412 * b;
-				image_[1](i,j) = 128.0  - 0.148223529411765 * r   - 0.290992156862745 * g		+ 0.4392156862745100 * b;
-				image_[2](i,j) = 128.0  + 0.439215686274510 * r	- 0.367788235294118 * g		- 0.0714274509803921 * b;
+				rgb2YCbCr(r, g, b, image_[0](i,j), image_[1](i,j), image_[2](i,j));
 			}
 	}
 }
@@ -268,6 +405,7 @@ void Image::transformRGB2YCbCr() {
 // transform YCbCr to RGB
 // based on Rec 601-1 specs
 void Image::transformYCbCr2RGB() {
+	TraceSpan span("YCbCr2RGB");
 	if(loaded_) {
 		for(unsigned j=0; j<height_; ++j)
 			for(unsigned i=0; i<width_; ++i) {
@@ -308,7 +446,7 @@ wUnit Image::getMax(unsigned plane) const {
 
 // detect if in the range X,Y,X+Size,Y+Size in the plane P
 // a value is present, that is >= given V
-bool Image::maxTest(wCoord X, wCoord Y, wCoord size, unsigned plane, wUnit value) const {
+bool Image::maxTest(unsigned X, unsigned Y, unsigned size, unsigned plane, wUnit value) const {
 	// check range(s)
 	if(plane > 2)
 		return false;
@@ -327,7 +465,7 @@ bool Image::maxTest(wCoord X, wCoord Y, wCoord size, unsigned plane, wUnit value
 	return false;
 }
 // PSNR difference from other image... luminance (Y)
-wUnit Image::getLummaDifferencePSNR(Image &diff) const {
+wUnit Image::getLummaDifferencePSNR(const Image &diff) const {
 	// init check
 	if(diff.getWidth() != width_ && diff.getHeight() != height_) {
 		return 0.0;
@@ -338,14 +476,14 @@ wUnit Image::getLummaDifferencePSNR(Image &diff) const {
 		for(unsigned i=0; i < width_; ++i)
 			sum += (diff(i,j,y) - image_[0](i,j)) * (diff(i,j,y) - image_[0](i,j));
 
-	sum = sqrt(sum / (width_ * height_));
+	sum = sqrt(sum / ((wUnit) width_ * height_));
 	sum = 20.0 * log10(255.0 / sum) * 100.0;
 	sum = round(sum);
 	return sum/100.0;
 }
 
 // PSNR difference from other image... chrominance (Cb,Cr)
-wUnit Image::getChromaDifferencePSNR(Image &diff) const {
+wUnit Image::getChromaDifferencePSNR(const Image &diff) const {
 	// init check
 	if(diff.getWidth() != width_ && diff.getHeight() != height_) {
 		return 0.0;
@@ -365,7 +503,10 @@ wUnit Image::getChromaDifferencePSNR(Image &diff) const {
 
 // init image to new dimensions
 // width, height included
+// planes already of this size are only zeroed, not reallocated
 void Image::clear(unsigned width, unsigned height) {
+	if(!image_)
+		image_ = new Matrix<wUnit> [3];
 	loaded_ = true;
 	width_ = width;
 	height_ = height;
@@ -374,9 +515,21 @@ void Image::clear(unsigned width, unsigned height) {
 		image_[p].init(width_, height_);
 }
 
+// draw the planes from given arena (0 = heap)
+// image is unloaded, planes are allocated by next clear() or load
+void Image::setArena(Arena *arena) {
+	if(!image_)
+		image_ = new Matrix<wUnit> [3];
+	for(unsigned p=0; p<3; ++p)
+		image_[p].setArena(arena);
+	width_ = 0;
+	height_ = 0;
+	loaded_ = false;
+}
+
 // get mean value of given set
-wUnit Image::computeRangeMean(unsigned x, unsigned y, unsigned w, unsigned h, planeVal p) {
-	unsigned pixelsTotal = w * h;
+wUnit Image::computeRangeMean(unsigned x, unsigned y, unsigned w, unsigned h, planeVal p) const {
+	size_t pixelsTotal = (size_t) w * h;
 
 	// get sum of all pixels
 	wUnit sum = 0.0;
@@ -390,8 +543,8 @@ wUnit Image::computeRangeMean(unsigned x, unsigned y, unsigned w, unsigned h, pl
 
 // get variance value of given set. 
 // It's a variance^2 value, defined by sigma^2 = 1/pixelsTotal * sum[(eachPixel-meanValue)^2]
-wUnit Image::computeRangeVariance(unsigned x, unsigned y, unsigned w, unsigned h, planeVal p) {
-	unsigned pixelsTotal = w * h;
+wUnit Image::computeRangeVariance(unsigned x, unsigned y, unsigned w, unsigned h, planeVal p) const {
+	size_t pixelsTotal = (size_t) w * h;
 	if(pixelsTotal == 0)
 		return 0.0;
 	
@@ -413,7 +566,7 @@ wUnit Image::computeRangeVariance(unsigned x, unsigned y, unsigned w, unsigned h
 // It's a computation of total variance. 
 // sigmaTot^2 = sigmaLL^2 + sum[i=1..n][ 4^(i-1) * (sigmaHHi^2 + sigmaLHi^2 + sigmaHLi^2) ]
 // warning: to get latest bandsize, fetches flwt static members last..
-wUnit Image::computeTotalVariance(Settings &sets, planeVal p) {
+wUnit Image::computeTotalVariance(Settings &sets, planeVal p) const {
 
 	unsigned w = image_[p].bandSizeW;
 	unsigned h = image_[p].bandSizeH;
@@ -430,15 +583,22 @@ wUnit Image::computeTotalVariance(Settings &sets, planeVal p) {
 	// first SUM element (sigmaLL^2)
 	wUnit sum = computeRangeVariance(0, 0, w, h, p);
 
+	// levels below the band (uneven sizes: high bands are one shorter, bandSide())
+	unsigned levels = 0;
+	while(bandSide(width_, levels) > w)
+		levels++;
+
 	// this can be done until condition is OK
 	unsigned i = 0;
-	while(w < width_ && h < height_ && i < varDepth) {
+	while(levels > 0 && i < varDepth) {
 		wUnit tempSum = 0.0;
+		unsigned hw = bandSide(width_, levels - 1) - w;
+		unsigned hh = bandSide(height_, levels - 1) - h;
 		
 		// compute detail subbands of this level
-		tempSum += computeRangeVariance(w, 0, w, h, p);
-		tempSum += computeRangeVariance(0, h, w, h, p);
-		tempSum += computeRangeVariance(w, h, w, h, p);
+		tempSum += computeRangeVariance(w, 0, hw, h, p);
+		tempSum += computeRangeVariance(0, h, w, hh, p);
+		tempSum += computeRangeVariance(w, h, hw, hh, p);
 		
 		// multiplier (4^L-i)
 		tempSum *= (wUnit) pow((wUnit) 4, (wUnit) i);
@@ -447,7 +607,7 @@ wUnit Image::computeTotalVariance(Settings &sets, planeVal p) {
 		sum += tempSum;
 
 		// increase w,h,i
-		w *= 2; h *= 2; i++;
+		w += hw; h += hh; levels--; i++;
 	}
 	
 	//// add color level shift modifier for Y plane
@@ -7,11 +7,15 @@
 #define BMP_GPLANE 1
 #define BMP_BPLANE 0
 
+// lines of the BMP read at once by loadBMPForward
+#define IMAGE_BMP_BAND 64
+
 // specifies value of plane
 enum planeVal { y=0, cB=1, cR=2 };
 
 #include "general.h"
 #include "settings.h"
+#include <fstream>
 
 // class holds together 3 matrices in an Image
 // has methods for loading BMP, saving BMP
@@ -24,14 +28,21 @@ class Image {
 	unsigned height_;
 	bool loaded_;
 
+	// header of a 24-bit BMP, sizes out
+	bool readBMPHeader(std::ifstream &file, int &sizex, int &sizey);
+
 public:
 	// SERVICE METHODS -------------------
 	// implicit constructor, create memory
 	Image();
 	// copy constructor
 	Image(const Image& copy);
+	// move constructor
+	Image(Image&& copy);
 	// assigment operator
 	Image& operator= (const Image& src);
+	// move assigment operator
+	Image& operator= (Image&& src);
 	// destructor
 	~Image();
 
@@ -40,10 +51,12 @@ public:
 	wUnit getMax(unsigned plane) const;
 
 	// detect if in the range X,Y,X+Size,Y+Size in the plane P, a value is present that is >= given value
-	bool maxTest(wCoord X, wCoord Y, wCoord size, unsigned plane, wUnit value) const;
+	bool maxTest(unsigned X, unsigned Y, unsigned size, unsigned plane, wUnit value) const;
 
 	// IMPORT / EXPORT (BMP)--------------
 	bool loadBMP(const char *filename);
+	// encoder: load BMP as YCbCr - 128 & forward WT of given levels per plane, line by line (no pixel planes)
+	bool loadBMPForward(const char *filename, const unsigned levels[3], Arena *arena = 0);
 	bool saveBMP(const char *filename);
 
 	// MODIFIERS -------------------------
@@ -60,6 +73,8 @@ public:
 	// zero image
 	// parameter: width / height
 	void clear(unsigned width, unsigned height);
+	// draw the planes from given arena (0 = heap), drops the contents
+	void setArena(Arena *arena);
 
 	// ACCESS TO VALUES ------------------
 	// () operator overload - mutator
@@ -80,17 +95,17 @@ public:
 
 	// GLOBAL CHARACTERISTICS ------------- 
 	// PSNR difference from other image (lumma)
-	wUnit getLummaDifferencePSNR(Image &diff) const;
+	wUnit getLummaDifferencePSNR(const Image &diff) const;
 	// PSNR difference from other image (chroma)
-	wUnit getChromaDifferencePSNR(Image &diff) const;
+	wUnit getChromaDifferencePSNR(const Image &diff) const;
 	
 	// CODEC ALGORITHMS -------------------
 	// get mean value of given set
-	wUnit computeRangeMean(unsigned x, unsigned y, unsigned w, unsigned h, planeVal p);
+	wUnit computeRangeMean(unsigned x, unsigned y, unsigned w, unsigned h, planeVal p) const;
 	// get variance value of given set. 
-	wUnit computeRangeVariance(unsigned x, unsigned y, unsigned w, unsigned h, planeVal p);
+	wUnit computeRangeVariance(unsigned x, unsigned y, unsigned w, unsigned h, planeVal p) const;
 	// compute total variance up to given depth n.
-	wUnit computeTotalVariance(Settings &sets, planeVal p);
+	wUnit computeTotalVariance(Settings &sets, planeVal p) const;
 
 	// PROPERTIES CHECKOUT ----------------
 	// get image size w
@@ -0,0 +1,75 @@
+// listcache: initial LIP & LIS of the tree topologies, built once per geometry and shared by all runs
+#ifndef LISTCACHE_H
+#define LISTCACHE_H
+
+#include <vector>
+#include <list>
+#include <memory>
+#include <mutex>
+
+// geometries kept per topology, the oldest one goes first
+#define LISTCACHE_ENTRIES 16
+
+// class ListCache
+// the initial lists depend only on the topology and the geometry (width, height, LLtop band),
+// so a batch of images of one size & levels starts every plane from the same lists:
+// the first run of a geometry lets the topology build them and stores a copy, later runs copy them in
+// entries are never changed once stored, runs of parallel jobs share them through shared_ptr
+template <class Topology>
+class ListCache {
+	typedef typename Topology::Coef::Node Node;
+	typedef typename Topology::Coef::Set Set;
+
+public:
+	// initial lists of one geometry
+	struct Lists {
+		unsigned width;
+		unsigned height;
+		unsigned bandW;
+		unsigned bandH;
+		std::vector<Node> lip;
+		std::vector<Set> lis;
+	};
+	typedef std::shared_ptr<const Lists> Entry;
+
+	// lists of the geometry, empty if not stored yet
+	static Entry find(unsigned width, unsigned height, unsigned bandW, unsigned bandH) {
+		std::lock_guard<std::mutex> lock(mutex());
+		std::list<Entry> &all = entries();
+		for(typename std::list<Entry>::iterator it = all.begin(); it != all.end(); ++it)
+			if((*it)->width == width && (*it)->height == height && (*it)->bandW == bandW && (*it)->bandH == bandH)
+				return *it;
+		return Entry();
+	}
+
+	// store the lists built for the geometry
+	template <class NodeList, class SetList>
+	static void store(unsigned width, unsigned height, unsigned bandW, unsigned bandH, const NodeList &lip, const SetList &lis) {
+		std::shared_ptr<Lists> lists(new Lists);
+		lists->width = width;
+		lists->height = height;
+		lists->bandW = bandW;
+		lists->bandH = bandH;
+		lists->lip.assign(lip.begin(), lip.end());
+		lists->lis.assign(lis.begin(), lis.end());
+
+		std::lock_guard<std::mutex> lock(mutex());
+		std::list<Entry> &all = entries();
+		all.push_back(lists);
+		if(all.size() > LISTCACHE_ENTRIES)
+			all.pop_front();
+	}
+
+private:
+	// entries of the topology
+	static std::mutex& mutex() {
+		static std::mutex m;
+		return m;
+	}
+	static std::list<Entry>& entries() {
+		static std::list<Entry> e;
+		return e;
+	}
+};
+
+#endif
@@ -0,0 +1,11 @@
+// LSpiht implementation
+#include "lspiht.h"
+
+// passes & main loops of LSPIHT
+template class SpihtEngine<RegularTree, ArrayStorage>;
+template class SpihtEngine<WideTree<RegularTree>, ArrayStorage>;
+template class SpihtCoder<RegularTree, ArrayStorage>;
+
+// LSpiht constructor
+LSpiht::LSpiht(Image &im, Arena *arena) : SpihtCoder<RegularTree, ArrayStorage>(im, "LSPIHT", arena) {
+}
@@ -0,0 +1,20 @@
+// LSPIHT: BSPIHT with fixed-memory LIP / LSP state
+#ifndef LSPIHT_H
+#define LSPIHT_H
+
+#include "spihtcoder.h"
+
+// class LSPIHT
+// produces and reads the same bitstream as BSPIHT (same version)
+// LIP and LSP are arrays with capacity of the plane size, taken once,
+// LIP is compacted in place while it's swept, LSP is append-only
+// so the memory is fixed by the image size and does not grow with bitrate
+// constructs implementation, takes Image
+class LSpiht : public SpihtCoder<RegularTree, ArrayStorage> {
+public:
+	// constructor
+	// arena: optional job memory for the lists and bitstreams
+	LSpiht(Image& im, Arena *arena = 0);
+};
+
+#endif
@@ -0,0 +1,165 @@
+// perfcounters implementation
+#include "perfcounters.h"
+#include <iostream>
+#include <iomanip>
+#include <cstring>
+#include <cerrno>
+#include <string>
+
+#if !defined(SPIHT_NO_PERF)
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+bool PerfCounters::enabled_ = false;
+std::mutex PerfCounters::mutex_;
+std::vector<PerfStage> PerfCounters::stages_;
+
+#if !defined(SPIHT_NO_PERF)
+// counters of the group, the first one leads
+static const uint64_t perfEvents[4] = {
+	PERF_COUNT_HW_CPU_CYCLES,
+	PERF_COUNT_HW_INSTRUCTIONS,
+	PERF_COUNT_HW_CACHE_MISSES,
+	PERF_COUNT_HW_BRANCH_MISSES
+};
+
+// counter of the calling thread on any CPU, user space only
+static int perfOpen(uint64_t config, int leader) {
+	perf_event_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = PERF_TYPE_HARDWARE;
+	attr.config = config;
+	attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	return (int) syscall(__NR_perf_event_open, &attr, 0, -1, leader, 0);
+}
+#endif
+
+// constructor
+PerfCounters::Group::Group() : tried(false) {
+	for(unsigned i = 0; i < 4; ++i)
+		fd[i] = -1;
+}
+
+// destructor
+PerfCounters::Group::~Group() {
+#if !defined(SPIHT_NO_PERF)
+	for(unsigned i = 0; i < 4; ++i)
+		if(fd[i] >= 0)
+			close(fd[i]);
+#endif
+}
+
+// open the group (first call only), false if any counter is missing
+bool PerfCounters::Group::open() {
+#if !defined(SPIHT_NO_PERF)
+	if(!tried) {
+		tried = true;
+		for(unsigned i = 0; i < 4; ++i) {
+			fd[i] = perfOpen(perfEvents[i], i ? fd[0] : -1);
+			if(fd[i] < 0) {
+				for(unsigned j = 0; j < i; ++j) {
+					close(fd[j]);
+					fd[j] = -1;
+				}
+				break;
+			}
+		}
+	}
+#endif
+	return fd[0] >= 0;
+}
+
+// group of the calling thread
+PerfCounters::Group& PerfCounters::local() {
+	static thread_local Group group;
+	return group;
+}
+
+// turn counting on
+bool PerfCounters::enable() {
+#if defined(SPIHT_NO_PERF)
+	std::cout << "Hardware performance counters are not available in this build, counting is off." << std::endl;
+	return false;
+#else
+	if(!local().open()) {
+		std::cout << "Hardware performance counters are not available (perf_event_open: " << strerror(errno) << "), counting is off." << std::endl;
+		return false;
+	}
+	enabled_ = true;
+	return true;
+#endif
+}
+
+// counts of the calling thread so far
+bool PerfCounters::read(PerfCounts &counts) {
+#if defined(SPIHT_NO_PERF)
+	return false;
+#else
+	Group &group = local();
+	if(!group.open())
+		return false;
+
+	// nr, time enabled, time running, values
+	uint64_t data[3 + 4];
+	if(::read(group.fd[0], data, sizeof(data)) != (ssize_t) sizeof(data) || data[0] != 4)
+		return false;
+
+	// scale up if the group was multiplexed with other users of the PMU
+	double scale = (data[2] > 0 && data[2] < data[1]) ? (double) data[1] / data[2] : 1.0;
+	counts.cycles = (uint64_t) (data[3] * scale);
+	counts.instructions = (uint64_t) (data[4] * scale);
+	counts.cacheMisses = (uint64_t) (data[5] * scale);
+	counts.branchMisses = (uint64_t) (data[6] * scale);
+	return true;
+#endif
+}
+
+// add a run of a stage
+void PerfCounters::record(const char *name, int arg, const PerfCounts &start, const PerfCounts &end) {
+	std::lock_guard<std::mutex> lock(mutex_);
+	size_t i = 0;
+	while(i < stages_.size() && !(stages_[i].arg == arg && strcmp(stages_[i].name, name) == 0))
+		++i;
+	if(i == stages_.size()) {
+		PerfStage stage;
+		memset(&stage, 0, sizeof(stage));
+		stage.name = name;
+		stage.arg = arg;
+		stages_.push_back(stage);
+	}
+
+	PerfStage &stage = stages_[i];
+	++stage.calls;
+	stage.counts.cycles += end.cycles - start.cycles;
+	stage.counts.instructions += end.instructions - start.instructions;
+	stage.counts.cacheMisses += end.cacheMisses - start.cacheMisses;
+	stage.counts.branchMisses += end.branchMisses - start.branchMisses;
+}
+
+// stages so far
+std::vector<PerfStage> PerfCounters::stages() {
+	std::lock_guard<std::mutex> lock(mutex_);
+	return stages_;
+}
+
+// table of the stages
+void PerfCounters::print() {
+	std::vector<PerfStage> all = stages();
+	std::cout << "Hardware counters per stage (user space):" << std::endl;
+	std::cout << std::setw(28) << std::left << "stage" << std::right << std::setw(6) << "calls" << std::setw(14) << "cycles"
+			  << std::setw(14) << "instructions" << std::setw(6) << "IPC" << std::setw(12) << "LLC misses" << std::setw(12) << "br misses" << std::endl;
+	for(size_t i = 0; i < all.size(); ++i) {
+		const PerfStage &s = all[i];
+		std::string name(s.name);
+		if(s.arg >= 0)
+			name += " " + std::to_string(s.arg);
+		std::cout << std::setw(28) << std::left << name << std::right << std::setw(6) << s.calls << std::setw(14) << s.counts.cycles
+				  << std::setw(14) << s.counts.instructions << std::setw(6) << std::setprecision(2) << std::fixed << s.ipc()
+				  << std::setw(12) << s.counts.cacheMisses << std::setw(12) << s.counts.branchMisses << std::endl;
+	}
+}
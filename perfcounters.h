@@ -0,0 +1,101 @@
+// perfcounters: hardware performance counters per pipeline stage (Linux perf_event_open)
+#ifndef PERFCOUNTERS_H
+#define PERFCOUNTERS_H
+
+#include <vector>
+#include <mutex>
+#include <stdint.h>
+
+// compile with SPIHT_NO_PERF defined to leave out all counting (always left out on other systems than Linux)
+#if !defined(__linux__) && !defined(SPIHT_NO_PERF)
+#define SPIHT_NO_PERF
+#endif
+
+// counts of user space work
+struct PerfCounts {
+	uint64_t cycles;
+	uint64_t instructions;
+	uint64_t cacheMisses;		// last level cache
+	uint64_t branchMisses;
+};
+
+// all runs of a stage summed up
+struct PerfStage {
+	const char *name;
+	int arg;					// WT level or bitplane, -1 if none
+	uint64_t calls;
+	PerfCounts counts;
+
+	// instructions per cycle
+	double ipc() const {
+		return counts.cycles ? (double) counts.instructions / counts.cycles : 0.0;
+	}
+};
+
+// class PerfCounters
+// one counter group (cycles, instructions, cache misses, branch misses) per thread, opened on first use,
+// stages are summed by name & arg; a stage counts the thread it runs on only
+// (with -j the work handed to the workers is counted in their own stages, not in the pass)
+class PerfCounters {
+	// counter group of a thread, closed at its end
+	struct Group {
+		int fd[4];
+		bool tried;
+		Group();
+		~Group();
+		bool open();
+	};
+
+	// group of the calling thread
+	static Group& local();
+
+	static bool enabled_;
+	static std::mutex mutex_;				// guards stages_
+	static std::vector<PerfStage> stages_;
+
+public:
+	// counting turned on
+	static bool enabled() {
+#if defined(SPIHT_NO_PERF)
+		return false;
+#else
+		return enabled_;
+#endif
+	}
+	// turn counting on, false (and stays off) if the counters can't be opened
+	static bool enable();
+	// counts of the calling thread so far, false if its counters can't be read
+	static bool read(PerfCounts &counts);
+	// add a run of a stage, name must be a string literal
+	static void record(const char *name, int arg, const PerfCounts &start, const PerfCounts &end);
+	// stages in the order of their first run
+	static std::vector<PerfStage> stages();
+	// table of the stages
+	static void print();
+};
+
+// class PerfSpan
+// counts of the enclosing scope, costs a flag test when counting is off
+class PerfSpan {
+	const char *name_;
+	int arg_;
+	bool on_;
+	PerfCounts start_;
+
+	// not copyable
+	PerfSpan(const PerfSpan&);
+	PerfSpan& operator= (const PerfSpan&);
+
+public:
+	explicit PerfSpan(const char *name, int arg = -1) : name_(name), arg_(arg), on_(PerfCounters::enabled()) {
+		if(on_)
+			on_ = PerfCounters::read(start_);
+	}
+	~PerfSpan() {
+		PerfCounts end;
+		if(on_ && PerfCounters::read(end))
+			PerfCounters::record(name_, arg_, start_, end);
+	}
+};
+
+#endif
@@ -0,0 +1,200 @@
+// planestore implementation
+#include "planestore.h"
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+uint64_t PlaneStore::budget_ = 0;
+std::string PlaneStore::dir_;
+std::mutex PlaneStore::mutex_;
+uint64_t PlaneStore::resident_ = 0;
+uint64_t PlaneStore::residentPeak_ = 0;
+uint64_t PlaneStore::mapped_ = 0;
+uint64_t PlaneStore::mappedPeak_ = 0;
+uint64_t PlaneStore::mappedPlanes_ = 0;
+bool PlaneStore::failed_ = false;
+PlaneStore::Stats PlaneStore::start_;
+
+// budget & directory, paging counters start here
+void PlaneStore::setup(uint64_t budget, const std::string &dir) {
+	budget_ = budget;
+	dir_ = dir;
+	if(dir_.empty()) {
+#if defined(_WIN32)
+		char path[MAX_PATH + 1];
+		DWORD len = GetTempPathA(MAX_PATH + 1, path);
+		dir_ = (len > 0 && len <= MAX_PATH) ? std::string(path, len) : std::string(".");
+#else
+		const char *tmp = getenv("TMPDIR");
+		dir_ = (tmp && *tmp) ? tmp : "/tmp";
+#endif
+	}
+	// no trailing separator
+	while(dir_.size() > 1 && (dir_[dir_.size()-1] == '/' || dir_[dir_.size()-1] == '\\'))
+		dir_.erase(dir_.size()-1);
+
+	memset(&start_, 0, sizeof(start_));
+	usage(start_);
+}
+
+// process page faults & block I/O (not counted on Windows)
+void PlaneStore::usage(Stats &stats) {
+#if !defined(_WIN32)
+	struct rusage ru;
+	if(getrusage(RUSAGE_SELF, &ru) != 0)
+		return;
+	stats.majorFaults = (uint64_t) ru.ru_majflt;
+	stats.minorFaults = (uint64_t) ru.ru_minflt;
+	stats.blocksIn = (uint64_t) ru.ru_inblock;
+	stats.blocksOut = (uint64_t) ru.ru_oublock;
+#endif
+}
+
+// new file in the directory, gone from it at once, mapped shared
+void * PlaneStore::mapFile(size_t bytes) {
+#if defined(_WIN32)
+	char name[MAX_PATH + 1];
+	if(GetTempFileNameA(dir_.c_str(), "spi", 0, name) == 0)
+		return 0;
+	HANDLE file = CreateFileA(name, GENERIC_READ | GENERIC_WRITE, 0, 0, CREATE_ALWAYS,
+							  FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, 0);
+	if(file == INVALID_HANDLE_VALUE)
+		return 0;
+	// the view keeps the mapping & file open, the file is deleted when it is unmapped
+	HANDLE map = CreateFileMappingA(file, 0, PAGE_READWRITE, (DWORD) ((uint64_t) bytes >> 32), (DWORD) bytes, 0);
+	void *ptr = map ? MapViewOfFile(map, FILE_MAP_ALL_ACCESS, 0, 0, bytes) : 0;
+	if(map)
+		CloseHandle(map);
+	CloseHandle(file);
+	return ptr;
+#else
+	std::string name = dir_ + "/spihtplaneXXXXXX";
+	std::vector<char> path(name.begin(), name.end());
+	path.push_back(0);
+	int file = mkstemp(&path[0]);
+	if(file < 0)
+		return 0;
+	unlink(&path[0]);
+
+	void *ptr = 0;
+	if(ftruncate(file, (off_t) bytes) == 0) {
+		ptr = mmap(0, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+		if(ptr == MAP_FAILED)
+			ptr = 0;
+	}
+	// the mapping keeps the file
+	close(file);
+	return ptr;
+#endif
+}
+
+// unmap, the file goes with it
+void PlaneStore::unmapFile(void *ptr, size_t bytes) {
+#if defined(_WIN32)
+	UnmapViewOfFile(ptr);
+#else
+	munmap(ptr, bytes);
+#endif
+}
+
+// mapped buffer if the plane doesn't fit into the budget any more
+void * PlaneStore::take(size_t bytes, Backing &backing) {
+	backing = backingMemory;
+	if(budget_ == 0)
+		return 0;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		if(bytes < PLANESTORE_MIN_BYTES || resident_ + bytes <= budget_ || failed_) {
+			resident_ += bytes;
+			if(resident_ > residentPeak_)
+				residentPeak_ = resident_;
+			backing = backingCharged;
+			return 0;
+		}
+	}
+
+	void *ptr = mapFile(bytes);
+
+	std::lock_guard<std::mutex> lock(mutex_);
+	if(ptr) {
+		mapped_ += bytes;
+		if(mapped_ > mappedPeak_)
+			mappedPeak_ = mapped_;
+		mappedPlanes_++;
+		backing = backingMapped;
+	} else {
+		if(!failed_)
+			std::cout << "Can't map a plane of " << bytes << "B in \"" << dir_ << "\", planes are kept in memory" << std::endl;
+		failed_ = true;
+		resident_ += bytes;
+		if(resident_ > residentPeak_)
+			residentPeak_ = resident_;
+		backing = backingCharged;
+	}
+	return ptr;
+}
+
+// plane given up
+void PlaneStore::give(void *ptr, size_t bytes, Backing backing) {
+	if(backing == backingMemory)
+		return;
+	if(backing == backingMapped && ptr)
+		unmapFile(ptr, bytes);
+
+	std::lock_guard<std::mutex> lock(mutex_);
+	if(backing == backingMapped)
+		mapped_ -= bytes;
+	else
+		resident_ -= bytes;
+}
+
+// access hint, the mapping starts page aligned
+void PlaneStore::advise(void *ptr, size_t bytes, Access access) {
+#if !defined(_WIN32)
+#if defined(MADV_REMOVE)
+	static const int advice[] = { MADV_NORMAL, MADV_SEQUENTIAL, MADV_RANDOM, MADV_WILLNEED, MADV_DONTNEED, MADV_REMOVE };
+#else
+	static const int advice[] = { MADV_NORMAL, MADV_SEQUENTIAL, MADV_RANDOM, MADV_WILLNEED, MADV_DONTNEED, MADV_DONTNEED };
+#endif
+	if(ptr && bytes > 0)
+		madvise(ptr, bytes, advice[access]);
+#endif
+}
+
+// paging since setup()
+PlaneStore::Stats PlaneStore::stats() {
+	Stats now;
+	memset(&now, 0, sizeof(now));
+	usage(now);
+	now.majorFaults -= start_.majorFaults;
+	now.minorFaults -= start_.minorFaults;
+	now.blocksIn -= start_.blocksIn;
+	now.blocksOut -= start_.blocksOut;
+
+	std::lock_guard<std::mutex> lock(mutex_);
+	now.budget = budget_;
+	now.mappedPlanes = mappedPlanes_;
+	now.mappedPeak = mappedPeak_;
+	now.residentPeak = residentPeak_;
+	return now;
+}
+
+// paging lines of -E
+void PlaneStore::print() {
+	Stats s = stats();
+	if(s.budget > 0)
+		std::cout << "Plane memory budget: " << s.budget << "B, " << s.residentPeak << "B in memory at most, "
+				  << s.mappedPlanes << " planes mapped (" << s.mappedPeak << "B at most) in \"" << dir_ << "\"" << std::endl;
+	std::cout << "Paging: " << s.majorFaults << " major / " << s.minorFaults << " minor page faults, "
+			  << s.blocksIn << " blocks in, " << s.blocksOut << " blocks out" << std::endl;
+}
@@ -0,0 +1,82 @@
+// planestore: memory-mapped temporary files backing the planes that don't fit into a memory budget
+#ifndef PLANESTORE_H
+#define PLANESTORE_H
+
+#include <cstddef>
+#include <string>
+#include <mutex>
+#include <stdint.h>
+
+// smallest plane put into a mapped file (bytes), smaller ones stay in memory
+#define PLANESTORE_MIN_BYTES (1 << 20)
+
+// class PlaneStore
+// with a budget set (-M), every Matrix asks here for its buffer: planes are kept in memory
+// while the plane bytes in memory stay within the budget, the planes over it go to unlinked temporary
+// files mapped shared, so the kernel pages them in & out instead of the run failing for memory
+// (a fresh mapping reads as zeros, so the file is sparse until written)
+// Matrix::advise() passes the access pattern of the stage to the mapping: rows read once top down
+// (row lifting steps, quantization) are sequential, the column steps of the WT (whole lines) and tree coding
+// keep the default readahead, coefficients of a coded plane are discarded so that the kernel doesn't write them
+// to the file
+// stats() gives the paging cost of the run: mapped planes & bytes, page faults and block I/O of the process
+class PlaneStore {
+public:
+	// where a Matrix buffer lives
+	enum Backing { backingMemory = 0, backingCharged, backingMapped };
+	// expected access to a plane; discard: contents are dead, dropped without writing them back (reads as zeros)
+	enum Access { accessNormal = 0, accessSequential, accessRandom, accessWillNeed, accessDontNeed, accessDiscard };
+
+	// paging of the run
+	struct Stats {
+		uint64_t budget;			// bytes, 0 = off
+		uint64_t mappedPlanes;		// planes put into mapped files
+		uint64_t mappedPeak;		// high-water mark of mapped plane bytes
+		uint64_t residentPeak;		// high-water mark of plane bytes in memory (counted with the budget on)
+		uint64_t majorFaults;		// page faults that waited for the disk
+		uint64_t minorFaults;
+		uint64_t blocksIn;			// file system blocks read & written
+		uint64_t blocksOut;
+	};
+
+private:
+	static uint64_t budget_;
+	static std::string dir_;
+	static std::mutex mutex_;		// guards the counters
+	static uint64_t resident_;
+	static uint64_t residentPeak_;
+	static uint64_t mapped_;
+	static uint64_t mappedPeak_;
+	static uint64_t mappedPlanes_;
+	static bool failed_;			// mapping failed once, told already
+	static Stats start_;			// process counters at setup()
+
+	// process page faults & block I/O so far
+	static void usage(Stats &stats);
+	// zeroed shared mapping of a new unlinked file, 0 if it can't be made
+	static void * mapFile(size_t bytes);
+	static void unmapFile(void *ptr, size_t bytes);
+
+public:
+	// budget of plane bytes in memory (0 = no mapping) and directory of the mapped files (empty = system temp)
+	// call once before the planes are allocated, starts the paging counters
+	static void setup(uint64_t budget, const std::string &dir);
+	// budget set
+	static bool enabled() {
+		return budget_ > 0;
+	}
+
+	// buffer for a plane of given size: mapped one, or 0 if it goes to memory (arena or heap)
+	static void * take(size_t bytes, Backing &backing);
+	// plane given up; frees a mapped buffer, memory ones are freed by the caller
+	static void give(void *ptr, size_t bytes, Backing backing);
+	// access pattern hint for a mapped plane
+	static void advise(void *ptr, size_t bytes, Access access);
+
+	// paging since setup()
+	static Stats stats();
+	// paging lines of -E
+	static void print();
+};
+
+#endif
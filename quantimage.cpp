@@ -0,0 +1,135 @@
+// quantimage implementation
+#include "quantimage.h"
+#include <cmath>
+
+// constructor
+QuantImage::QuantImage() {
+}
+
+// draw planes from given arena (0 = heap)
+void QuantImage::setArena(Arena *arena) {
+	for(unsigned p=0; p<3; ++p) {
+		mag_[p].setArena(arena);
+		sign_[p].setArena(arena);
+	}
+}
+
+// encoder: magnitude floor(|v|) and sign of each coefficient
+// |v| >= 2^n <=> floor(|v|) >= 2^n, so all later tests are exact
+void QuantImage::quantize(const Image &image, planeVal p) {
+	const Matrix<wUnit>& src = image.getMatrix(p);
+	unsigned w = src.getW();
+	unsigned h = src.getH();
+
+	mag_[p].init(w, h);
+	sign_[p].init(w, h);
+
+	// mapped planes: one pass top down, the coder then goes along the trees with the default readahead
+	src.advise(PlaneStore::accessSequential);
+	for(unsigned j=0; j<h; ++j) {
+		const wUnit * line = src.getLine(j);
+		qUnit * mag = mag_[p].getLine(j);
+		unsigned char * sign = sign_[p].getLine(j);
+		for(unsigned i=0; i<w; ++i) {
+			mag[i] = (qUnit) floor(fabs(line[i]));
+			sign[i] = (line[i] < 0.0) ? 1 : 0;
+		}
+	}
+	src.advise(PlaneStore::accessNormal);
+}
+
+// decoder: zero plane of given size
+void QuantImage::clear(planeVal p, unsigned width, unsigned height) {
+	mag_[p].init(width, height);
+	sign_[p].init(width, height);
+}
+
+// decoder: write values back into the image plane
+void QuantImage::dequantize(Image &image, planeVal p) const {
+	Matrix<wUnit>& dst = image.getMatrix(p);
+	const wUnit scale = 1.0 / (wUnit) (1 << QUANT_FRACBITS);
+
+	mag_[p].advise(PlaneStore::accessSequential);
+	sign_[p].advise(PlaneStore::accessSequential);
+	dst.advise(PlaneStore::accessSequential);
+	for(unsigned j=0; j<mag_[p].getH(); ++j) {
+		wUnit * line = dst.getLine(j);
+		const qUnit * mag = mag_[p].getLine(j);
+		const unsigned char * sign = sign_[p].getLine(j);
+		for(unsigned i=0; i<mag_[p].getW(); ++i)
+			line[i] = (sign[i] ? -scale : scale) * (wUnit) mag[i];
+	}
+	dst.advise(PlaneStore::accessNormal);
+}
+
+// plane coded, its contents are dead
+void QuantImage::discard(planeVal p) const {
+	mag_[p].advise(PlaneStore::accessDiscard);
+	sign_[p].advise(PlaneStore::accessDiscard);
+}
+
+// get max magnitude of the whole plane
+qUnit QuantImage::getMax(unsigned plane) const {
+	if(plane > 2)
+		return 0;
+
+	qUnit maxVal = 0;
+	for(unsigned j=0; j < mag_[plane].getH(); ++j) {
+		const qUnit * mag = mag_[plane].getLine(j);
+		for(unsigned i=0; i < mag_[plane].getW(); ++i)
+			if(mag[i] > maxVal)
+				maxVal = mag[i];
+	}
+
+	return maxVal;
+}
+
+// detect if in the range X,Y,X+W,Y+H in the plane P
+// a magnitude >= 2^n is present: OR of the row, then shift test
+bool QuantImage::maxTest(unsigned X, unsigned Y, unsigned W, unsigned H, unsigned plane, unsigned n) const {
+	// check range(s)
+	if(plane > 2)
+		return false;
+	if(X+W > mag_[plane].getW() || Y+H > mag_[plane].getH())
+		return false;
+
+	CODER_COUNT(scanTally().tests, 1);
+
+	// drop true if any bit >= n detected
+	for(unsigned j=Y; j < Y+H; ++j) {
+		const qUnit * mag = mag_[plane].getLine(j) + X;
+		qUnit bits = 0;
+		for(unsigned i=0; i < W; ++i)
+			bits |= mag[i];
+		if(bits >> n) {
+			CODER_COUNT(scanTally().coefs, (uint64_t) (j - Y + 1) * W);
+			return true;
+		}
+	}
+
+	// else drop false
+	CODER_COUNT(scanTally().coefs, (uint64_t) W * H);
+	return false;
+}
+
+// OR of the magnitudes in the range X,Y,X+W,Y+H in the plane P
+// the set is significant at 2^n when the result has a bit >= n
+qUnit QuantImage::orRange(unsigned X, unsigned Y, unsigned W, unsigned H, unsigned plane) const {
+	// check range(s)
+	if(plane > 2)
+		return 0;
+	if(X+W > mag_[plane].getW() || Y+H > mag_[plane].getH())
+		return 0;
+
+	CODER_COUNT(scanTally().tests, 1);
+	CODER_COUNT(scanTally().coefs, (uint64_t) W * H);
+
+	qUnit bits = 0;
+	for(unsigned j=Y; j < Y+H; ++j) {
+		const qUnit * mag = mag_[plane].getLine(j) + X;
+		for(unsigned i=0; i < W; ++i)
+			bits |= mag[i];
+	}
+
+	return bits;
+}
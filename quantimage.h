@@ -0,0 +1,74 @@
+// quantimage: sign-magnitude integer form of the transformed planes
+#ifndef QUANTIMAGE_H
+#define QUANTIMAGE_H
+
+// decoder keeps magnitudes with this many fractional bits,
+// so that the midpoint reconstruction of the last bitplane (x.5) stays exact
+#define QUANT_FRACBITS 1
+
+#include "general.h"
+#include "image.h"
+#include "arena.h"
+#include "codecstats.h"
+
+// class holds integer magnitudes and signs of 3 planes
+// encoder: quantize() once, then significance is an integer test
+//          and refinement bit n is bit n of the magnitude
+// decoder: rebuilds magnitudes in 1/2^QUANT_FRACBITS units,
+//          dequantize() writes the plane back into the Image once
+class QuantImage {
+	// storage space
+	Matrix<qUnit> mag_[3];
+	Matrix<unsigned char> sign_[3];		// 1 = negative
+
+	// not copyable
+	QuantImage(const QuantImage&);
+	QuantImage& operator= (const QuantImage&);
+
+public:
+	// constructor, planes are allocated by quantize() / clear()
+	QuantImage();
+	// draw planes from given arena (0 = heap)
+	void setArena(Arena *arena);
+
+	// encoder: magnitude floor(|v|) and sign of each coefficient of plane p
+	void quantize(const Image &image, planeVal p);
+	// decoder: zero plane p of given size
+	void clear(planeVal p, unsigned width, unsigned height);
+	// decoder: write +-mag / 2^QUANT_FRACBITS of plane p into the image
+	void dequantize(Image &image, planeVal p) const;
+	// plane p coded: mapped planes drop their contents (no write back), the planes stay allocated
+	void discard(planeVal p) const;
+
+	// get max magnitude of whole plane
+	qUnit getMax(unsigned plane) const;
+	// detect if in the range X,Y,X+Size,Y+Size in the plane P a magnitude with bit >= n is present
+	// maxTest & orRange calls are counted into the scanTally() of the calling thread
+	inline bool maxTest(unsigned X, unsigned Y, unsigned size, unsigned plane, unsigned n) const {
+		return maxTest(X, Y, size, size, plane, n);
+	}
+	// same in the range X,Y,X+W,Y+H (trees of uneven bands)
+	bool maxTest(unsigned X, unsigned Y, unsigned W, unsigned H, unsigned plane, unsigned n) const;
+	// OR of the magnitudes in the range X,Y,X+W,Y+H in the plane P (significance of a set at any n)
+	qUnit orRange(unsigned X, unsigned Y, unsigned W, unsigned H, unsigned plane) const;
+
+	// ACCESS TO VALUES ------------------
+	// magnitude - mutator
+	inline qUnit& operator() (unsigned x, unsigned y, planeVal plane) {
+		return mag_[(unsigned) plane](x,y);
+	}
+	// magnitude - inspector
+	inline qUnit operator() (unsigned x, unsigned y, planeVal plane) const {
+		return mag_[(unsigned) plane](x,y);
+	}
+	// sign - inspector
+	inline bool isNegative(unsigned x, unsigned y, planeVal plane) const {
+		return sign_[(unsigned) plane](x,y) != 0;
+	}
+	// sign - mutator
+	inline void setNegative(unsigned x, unsigned y, planeVal plane, bool negative) {
+		sign_[(unsigned) plane](x,y) = negative ? 1 : 0;
+	}
+};
+
+#endif
@@ -0,0 +1,209 @@
+// report implementation
+#include "report.h"
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <cstring>
+
+// JSON string
+static std::string quoted(const std::string &text) {
+	std::string out("\"");
+	for(size_t i = 0; i < text.size(); ++i) {
+		if(text[i] == '"' || text[i] == '\\')
+			out += '\\';
+		out += text[i];
+	}
+	return out + "\"";
+}
+
+// CSV field, quoted if needed
+static std::string field(const std::string &text) {
+	if(text.find_first_of(",\"\n") == std::string::npos)
+		return text;
+	std::string out("\"");
+	for(size_t i = 0; i < text.size(); ++i) {
+		if(text[i] == '"')
+			out += '"';
+		out += text[i];
+	}
+	return out + "\"";
+}
+
+// fixed point number
+static std::string fixed(double value, int digits) {
+	std::ostringstream out;
+	out << std::fixed << std::setprecision(digits) << value;
+	return out.str();
+}
+
+// constructor
+RunReport::RunReport()
+	: width(0), height(0), levels(0), colorShift(0), threads(1), bits(0), bpp(0.0),
+	  encoded(false), decoded(false), compared(false), bitstreamBits(0), psnrY(0.0), psnrC(0.0),
+	  timeEncoding(0.0), timeDecoding(0.0), highWater(0), reserved(0) {
+	memset(&paging, 0, sizeof(paging));
+}
+
+// PSNR & times
+void RunReport::printResults(bool timing) const {
+	if(compared) {
+		std::cout << std::endl;
+		std::cout << "PSNR difference Y:     " << std::setprecision(2) << psnrY << "dB" << std::endl;
+		std::cout << "PSNR difference cB,cR: " << std::setprecision(2) << psnrC << "dB" << std::endl;
+		std::cout << std::endl;
+	}
+
+	if(timeEncoding > 0.0 && timing)
+		std::cout << "SPIHT CODING time elapsed   (total): " << std::setprecision(8) << timeEncoding << "s" <<  std::endl;
+
+	if(timeDecoding > 0.0 && timing)
+		std::cout << "SPIHT DECODING time elapsed (total): " << std::setprecision(8) << timeDecoding << "s" <<  std::endl;
+}
+
+// write the report
+bool RunReport::save(const std::string &filename, Format format) const {
+	std::ofstream file;
+	file.open(filename.c_str());
+	if(!file.is_open()) {
+		std::cout << "Can't write to file \"" << filename << "\"" << std::endl;
+		return false;
+	}
+
+	if(format == formatCSV)
+		writeCSV(file);
+	else
+		writeJSON(file);
+
+	file.close();
+	std::cout << "Run report saved to file \"" << filename << "\"... OK" << std::endl;
+	return true;
+}
+
+// JSON: run fields, then encoder & decoder with planes & passes
+void RunReport::writeJSON(std::ostream &out) const {
+	out << "{\n"
+		<< "  \"image\": " << quoted(image) << ",\n"
+		<< "  \"coder\": " << quoted(coder) << ",\n"
+		<< "  \"width\": " << width << ",\n"
+		<< "  \"height\": " << height << ",\n"
+		<< "  \"levels\": " << levels << ",\n"
+		<< "  \"colorShift\": " << colorShift << ",\n"
+		<< "  \"threads\": " << threads << ",\n"
+		<< "  \"budgetBits\": " << bits << ",\n"
+		<< "  \"bpp\": " << fixed(bpp, 4) << ",\n"
+		<< "  \"bitstreamBits\": " << bitstreamBits << ",\n"
+		<< "  \"psnrY\": " << (compared ? fixed(psnrY, 4) : "null") << ",\n"
+		<< "  \"psnrCbCr\": " << (compared ? fixed(psnrC, 4) : "null") << ",\n"
+		<< "  \"encodeSeconds\": " << (encoded ? fixed(timeEncoding, 8) : "null") << ",\n"
+		<< "  \"decodeSeconds\": " << (decoded ? fixed(timeDecoding, 8) : "null") << ",\n"
+		<< "  \"peakBytes\": " << highWater << ",\n"
+		<< "  \"reservedBytes\": " << reserved << ",\n"
+		<< "  \"paging\": { \"budgetBytes\": " << paging.budget << ", \"mappedPlanes\": " << paging.mappedPlanes
+		<< ", \"mappedPeakBytes\": " << paging.mappedPeak << ", \"residentPeakBytes\": " << paging.residentPeak
+		<< ", \"majorFaults\": " << paging.majorFaults << ", \"minorFaults\": " << paging.minorFaults
+		<< ", \"blocksIn\": " << paging.blocksIn << ", \"blocksOut\": " << paging.blocksOut << " }";
+
+	for(unsigned c = 0; c < 2; ++c) {
+		const CoderStats &stats = c ? decoder : encoder;
+		out << ",\n  \"" << (c ? "decoder" : "encoder") << "\": ";
+		if(!(c ? decoded : encoded)) {
+			out << "null";
+			continue;
+		}
+
+		out << "{\n    \"planes\": [";
+		bool firstPlane = true;
+		for(unsigned p = 0; p < 3; ++p) {
+			if(stats.planes[p].empty())
+				continue;
+			out << (firstPlane ? "\n" : ",\n")
+				<< "      { \"plane\": " << p << ", \"variance\": " << fixed(stats.variance[p], 4)
+				<< ", \"bits\": " << stats.planeBits[p] << ", \"passes\": [";
+			firstPlane = false;
+
+			for(size_t i = 0; i < stats.planes[p].size(); ++i) {
+				const PassStats &s = stats.planes[p][i];
+				out << (i ? ",\n" : "\n")
+					<< "        { \"step\": " << s.step << ", \"finished\": " << (s.finished ? "true" : "false")
+					<< ", \"sortingBits\": " << s.sortingBits << ", \"refinementBits\": " << s.refinementBits
+					<< ", \"lisSize\": " << s.lisSize << ", \"lipSize\": " << s.lipSize << ", \"lspSize\": " << s.lspSize
+					<< ", \"seconds\": " << fixed(s.seconds, 8)
+					<< ", \"lipVisits\": " << s.lipVisits << ", \"lisVisits\": " << s.lisVisits << ", \"lspRefined\": " << s.lspRefined
+					<< ", \"maxTests\": " << s.maxTests << ", \"coefsScanned\": " << s.coefsScanned
+					<< ", \"expandedA\": " << s.expandedA << ", \"expandedB\": " << s.expandedB
+					<< ", \"insertions\": " << s.insertions << ", \"erasures\": " << s.erasures
+					<< ", \"bytesAllocated\": " << s.bytesAllocated << " }";
+			}
+			out << "\n      ] }";
+		}
+		out << "\n    ]\n  }";
+	}
+
+	out << ",\n  \"perf\": ";
+	if(perf.empty()) {
+		out << "null";
+	} else {
+		out << "[";
+		for(size_t i = 0; i < perf.size(); ++i) {
+			const PerfStage &s = perf[i];
+			out << (i ? ",\n" : "\n")
+				<< "    { \"stage\": " << quoted(s.name) << ", \"arg\": ";
+			if(s.arg >= 0)
+				out << s.arg;
+			else
+				out << "null";
+			out << ", \"calls\": " << s.calls << ", \"cycles\": " << s.counts.cycles << ", \"instructions\": " << s.counts.instructions
+				<< ", \"ipc\": " << fixed(s.ipc(), 4) << ", \"cacheMisses\": " << s.counts.cacheMisses
+				<< ", \"branchMisses\": " << s.counts.branchMisses << " }";
+		}
+		out << "\n  ]";
+	}
+	out << "\n}\n";
+}
+
+// CSV: one line per pass
+void RunReport::writeCSV(std::ostream &out) const {
+	out << "image,coder,width,height,levels,colorShift,threads,budgetBits,bpp,bitstreamBits,psnrY,psnrCbCr,"
+		<< "encodeSeconds,decodeSeconds,peakBytes,reservedBytes,"
+		<< "budgetBytes,mappedPlanes,mappedPeakBytes,residentPeakBytes,majorFaults,minorFaults,blocksIn,blocksOut,"
+		<< "phase,plane,variance,planeBits,step,finished,sortingBits,refinementBits,lisSize,lipSize,lspSize,seconds,"
+		<< "lipVisits,lisVisits,lspRefined,maxTests,coefsScanned,expandedA,expandedB,insertions,erasures,bytesAllocated,"
+		<< "stage,calls,cycles,instructions,ipc,cacheMisses,branchMisses\n";
+
+	// run fields, the same on every line
+	std::ostringstream run;
+	run << field(image) << "," << coder << "," << width << "," << height << "," << levels << "," << colorShift << ","
+		<< threads << "," << bits << "," << fixed(bpp, 4) << "," << bitstreamBits << ","
+		<< (compared ? fixed(psnrY, 4) : "") << "," << (compared ? fixed(psnrC, 4) : "") << ","
+		<< (encoded ? fixed(timeEncoding, 8) : "") << "," << (decoded ? fixed(timeDecoding, 8) : "") << ","
+		<< highWater << "," << reserved << ","
+		<< paging.budget << "," << paging.mappedPlanes << "," << paging.mappedPeak << "," << paging.residentPeak << ","
+		<< paging.majorFaults << "," << paging.minorFaults << "," << paging.blocksIn << "," << paging.blocksOut;
+
+	for(unsigned c = 0; c < 2; ++c) {
+		const CoderStats &stats = c ? decoder : encoder;
+		if(!(c ? decoded : encoded))
+			continue;
+		for(unsigned p = 0; p < 3; ++p)
+			for(size_t i = 0; i < stats.planes[p].size(); ++i) {
+				const PassStats &s = stats.planes[p][i];
+				out << run.str() << "," << (c ? "decode" : "encode") << "," << p << ","
+					<< fixed(stats.variance[p], 4) << "," << stats.planeBits[p] << ","
+					<< s.step << "," << (s.finished ? 1 : 0) << "," << s.sortingBits << "," << s.refinementBits << ","
+					<< s.lisSize << "," << s.lipSize << "," << s.lspSize << "," << fixed(s.seconds, 8) << ","
+					<< s.lipVisits << "," << s.lisVisits << "," << s.lspRefined << "," << s.maxTests << "," << s.coefsScanned << ","
+					<< s.expandedA << "," << s.expandedB << "," << s.insertions << "," << s.erasures << "," << s.bytesAllocated << ",,,,,,,\n";
+			}
+	}
+
+	// stages: phase "perf", the arg (WT level / bitplane) in the step column, pass fields empty
+	for(size_t i = 0; i < perf.size(); ++i) {
+		const PerfStage &s = perf[i];
+		out << run.str() << ",perf,,,,";
+		if(s.arg >= 0)
+			out << s.arg;
+		out << ",,,,,,,,,,,,,,,,,," << field(s.name) << "," << s.calls << "," << s.counts.cycles << "," << s.counts.instructions << ","
+			<< fixed(s.ipc(), 4) << "," << s.counts.cacheMisses << "," << s.counts.branchMisses << "\n";
+	}
+}
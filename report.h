@@ -0,0 +1,59 @@
+// report: measurements of a run, written once as JSON or CSV
+#ifndef REPORT_H
+#define REPORT_H
+
+#include "codecstats.h"
+#include "perfcounters.h"
+#include "planestore.h"
+#include <string>
+#include <ostream>
+
+// class RunReport
+// collects what a run measures: settings, PSNR, times, memory & paging and the per plane & per pass figures
+// of the encoder and the decoder; save() writes it at the end, printResults() prints the same fields
+// JSON: one object, planes with their passes nested in "encoder" / "decoder"
+// CSV: one line per pass, the run fields repeated on each, then one line per stage with hardware counters
+class RunReport {
+	// JSON / CSV writers
+	void writeJSON(std::ostream &out) const;
+	void writeCSV(std::ostream &out) const;
+
+public:
+	enum Format { formatJSON = 0, formatCSV };
+
+	// run
+	std::string image;			// input image or bitstream file
+	std::string coder;			// BSPIHT, LSPIHT, DSPIHT, CSPIHT, SPECK
+	unsigned width;
+	unsigned height;
+	unsigned levels;
+	unsigned colorShift;
+	unsigned threads;
+	uint64_t bits;				// bit budget
+	double bpp;
+
+	// results, parts not done keep their flag down
+	bool encoded;
+	bool decoded;
+	bool compared;				// PSNR against the source
+	uint64_t bitstreamBits;
+	double psnrY;
+	double psnrC;
+	double timeEncoding;
+	double timeDecoding;
+	size_t highWater;			// job memory
+	size_t reserved;
+	PlaneStore::Stats paging;	// mapped planes, page faults & block I/O
+	CoderStats encoder;
+	CoderStats decoder;
+	std::vector<PerfStage> perf;	// hardware counters per stage (-H), empty if off
+
+	// constructor
+	RunReport();
+	// PSNR & total coding times (timing: with the times)
+	void printResults(bool timing) const;
+	// write the report, false if the file can't be written
+	bool save(const std::string &filename, Format format) const;
+};
+
+#endif
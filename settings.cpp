@@ -2,6 +2,7 @@
 #include "settings.h"
 
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
 
 // bailOut function
@@ -14,8 +15,14 @@ void Settings::bailOut(const char err[]) {
 // checks whenever params are OK to go
 // exits app when something wrong
 void Settings::checkUsability() {
+	// benchmarks on generated images, no files needed
+	if(!benchKind.empty()) {
+		mode = benchmark;
+	// mode 0: read file, code it in all given ways, save the report
+	} else if(!(inputImage.empty() || reportFile.empty())) {
+		mode = imageSweep;
 	// mode 1: read file, output file
-	if(!(inputImage.empty() || outputImage.empty())) {
+	} else if(!(inputImage.empty() || outputImage.empty())) {
 		mode = imageToImage;
 	// mode 2: read file, save to bitstream
 	} else if(!(inputImage.empty() || bitStreamFile.empty())) {
@@ -37,13 +44,35 @@ Settings::Settings(int arc, char** arv)
 	inputImage = std::string("");
 	outputImage = std::string("");
 	bitStreamFile = std::string("");
+	cacheDir = std::string("");
+	reportFile = std::string("");
+	traceFile = std::string("");
+	runReportFile = std::string("");
+	benchKind = std::string("");
+	benchBaseline = std::string("");
+	mapDir = std::string("");
+	sizeList = std::string("");
+	regressPercent = 5.0;
+	levelList = std::string("");
+	shiftList = std::string("");
+	bppList = std::string("");
 
 	cspihtFlag = false;
 	dspihtFlag = false;
+	bitSliceFlag = false;
+	fixedStateFlag = false;
+	speckFlag = false;
+	arithFlag = false;
+	runFlag = false;
+	interleaveFlag = false;
+	runReportCSV = false;
 	levels	   = 3;
+	threads	   = 1;
 	colorShift = 0;
 	varianceDepth = 0;
 	bits	   = 2048;
+	bitsFlag   = false;
+	memoryBudget = 0;
 	bpp		   = 0.0;
 	mode	   = notDefined;
 	
@@ -51,6 +80,7 @@ Settings::Settings(int arc, char** arv)
 	printDebug = false;
 	printTiming = false;
 	printExtended = false;
+	perfCounters = false;
 
 	// parse the arguments
 	if(arc > 1) {
@@ -58,6 +88,53 @@ Settings::Settings(int arc, char** arv)
 		while(i < (unsigned) arc) {
 			if(arv[i][0] == '-') {
 				switch(arv[i][1]) {
+					case	'-':
+						// long options
+						if(strcmp(arv[i], "--report") == 0) {
+							if(i+2 < (unsigned) arc && (strcmp(arv[i+1], "json") == 0 || strcmp(arv[i+1], "csv") == 0)) {
+								runReportCSV = strcmp(arv[i+1], "csv") == 0;
+								runReportFile.assign(arv[i+2]);
+								i += 2;
+							} else {
+								bailOut("Run report takes a format (json or csv) and a file.");
+							}
+						} else if(strcmp(arv[i], "--bench") == 0) {
+							if(i+1 < (unsigned) arc && (strcmp(arv[i+1], "micro") == 0 || strcmp(arv[i+1], "codec") == 0)) {
+								benchKind.assign(arv[++i]);
+							} else {
+								bailOut("Benchmark kind not specified (micro or codec).");
+							}
+						} else if(strcmp(arv[i], "--sizes") == 0) {
+							if(++i < (unsigned) arc) {
+								sizeList.assign(arv[i]);
+							} else {
+								bailOut("Image sizes not specified.");
+							}
+						} else if(strcmp(arv[i], "--baseline") == 0) {
+							if(++i < (unsigned) arc) {
+								benchBaseline.assign(arv[i]);
+							} else {
+								bailOut("Baseline file not specified.");
+							}
+						} else if(strcmp(arv[i], "--mapdir") == 0) {
+							if(++i < (unsigned) arc) {
+								mapDir.assign(arv[i]);
+							} else {
+								bailOut("Directory of mapped planes not specified.");
+							}
+						} else if(strcmp(arv[i], "--regress") == 0) {
+							if(++i < (unsigned) arc) {
+								regressPercent = atof(arv[i]);
+								if(regressPercent <= 0.0) {
+									bailOut("Regression threshold must be positive.");
+								}
+							} else {
+								bailOut("Regression threshold not specified.");
+							}
+						} else {
+							bailOut("Invalid specification. See ReadMe.txt for parameter layout.");
+						}
+						break;
 					case	'i':
 						if(++i < (unsigned) arc) {
 							inputImage.assign(arv[i]);
@@ -79,6 +156,27 @@ Settings::Settings(int arc, char** arv)
 							bailOut("Bitstream file not specified.");
 						}
 						break;
+					case	'R':
+						if(++i < (unsigned) arc) {
+							reportFile.assign(arv[i]);
+						} else {
+							bailOut("Report file not specified.");
+						}
+						break;
+					case	't':
+						if(++i < (unsigned) arc) {
+							traceFile.assign(arv[i]);
+						} else {
+							bailOut("Trace file not specified.");
+						}
+						break;
+					case	'C':
+						if(++i < (unsigned) arc) {
+							cacheDir.assign(arv[i]);
+						} else {
+							bailOut("Coefficient cache directory not specified.");
+						}
+						break;
 					case	'c':
 						cspihtFlag = true;
 						break;
@@ -91,11 +189,33 @@ Settings::Settings(int arc, char** arv)
 					case	'T':
 						printTiming = true;
 						break;
+					case	'H':
+						perfCounters = true;
+						break;
 					case	'd':
 						dspihtFlag = true;
 						break;
+					case	'w':
+						bitSliceFlag = true;
+						break;
+					case	'm':
+						fixedStateFlag = true;
+						break;
+					case	'k':
+						speckFlag = true;
+						break;
+					case	'a':
+						arithFlag = true;
+						break;
+					case	'z':
+						runFlag = true;
+						break;
+					case	'P':
+						interleaveFlag = true;
+						break;
 					case	'l':
 						if(++i < (unsigned) arc) {
+							levelList.assign(arv[i]);
 							levels = (unsigned) atoi(arv[i]);
 							if(levels == 0) {
 								bailOut("Levels must be positive and nonzero.");	
@@ -106,6 +226,7 @@ Settings::Settings(int arc, char** arv)
 						break;
 					case	'S':
 						if(++i < (unsigned) arc) {
+							shiftList.assign(arv[i]);
 							colorShift = (unsigned) atoi(arv[i]);
 							if(colorShift < 0) {
 								bailOut("Colorshift must be positive.");	
@@ -114,6 +235,16 @@ Settings::Settings(int arc, char** arv)
 							bailOut("Colorshift number not specified.");
 						}
 						break;
+					case	'j':
+						if(++i < (unsigned) arc) {
+							threads = (unsigned) atoi(arv[i]);
+							if(threads == 0) {
+								bailOut("Threads must be positive and nonzero.");
+							}
+						} else {
+							bailOut("Threads number not specified.");
+						}
+						break;
 					case	'v':
 						if(++i < (unsigned) arc) {
 							varianceDepth = (unsigned) atoi(arv[i]);
@@ -123,14 +254,27 @@ Settings::Settings(int arc, char** arv)
 						break;
 					case	'B':
 						if(++i < (unsigned) arc) {
-							bits = (unsigned) atoi(arv[i]);
+							bits = (uint64_t) strtoull(arv[i], 0, 10);
+							bitsFlag = true;
 						} else {
 							bailOut("Bits number not specified.");
 						}
 						break;
+					case	'M':
+						if(++i < (unsigned) arc) {
+							memoryBudget = (uint64_t) strtoull(arv[i], 0, 10) << 20;
+							if(memoryBudget == 0) {
+								bailOut("Memory budget must be positive and nonzero.");
+							}
+						} else {
+							bailOut("Memory budget not specified.");
+						}
+						break;
 					case	'p':
 						if(++i < (unsigned) arc) {
+							bppList.assign(arv[i]);
 							bpp = (float) atof(arv[i]);
+							bitsFlag = true;
 							if(bpp <= 0) {
 								bailOut("Bpp must be a floating-point number greater than zero (0.0).");
 							}
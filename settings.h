@@ -10,8 +10,9 @@
 #define BIAS_CR 0.50
 
 #include <string>
+#include <stdint.h>
 
-enum appMode {notDefined=0, imageToBitstream, bitstreamToImage, imageToImage};
+enum appMode {notDefined=0, imageToBitstream, bitstreamToImage, imageToImage, imageSweep, benchmark};
 
 // Settings:
 // does fetch the command line
@@ -31,18 +32,43 @@ public:
 	std::string		inputImage;
 	std::string		outputImage;
 	std::string		bitStreamFile;
+	std::string		cacheDir;
+	std::string		reportFile;
+	std::string		traceFile;
+	std::string		runReportFile;
+	std::string		benchKind;
+	std::string		benchBaseline;
+	std::string		mapDir;
+	double			regressPercent;
+	bool		runReportCSV;
 	bool		cspihtFlag;
 	bool		dspihtFlag;
+	bool		bitSliceFlag;
+	bool		fixedStateFlag;
+	bool		speckFlag;
+	bool		arithFlag;
+	bool		runFlag;
+	bool		interleaveFlag;
 	unsigned	levels;
+	unsigned	threads;
 	unsigned	colorShift;
-	unsigned	bits;
+	uint64_t	bits;
+	bool		bitsFlag;		// -B or -p given, else decoding takes the whole bitstream
+	uint64_t	memoryBudget;	// bytes of planes in memory, 0 = no limit
 	unsigned	varianceDepth;
 	float		bpp;
+	// sweep mode: comma separated values of -l, -S & -p as given
+	std::string	levelList;
+	std::string	shiftList;
+	std::string	bppList;
+	// end-to-end benchmark: comma separated image sides
+	std::string	sizeList;
 	
 	// print info modifiers
 	bool	printDebug;
 	bool	printTiming;
 	bool	printExtended;
+	bool	perfCounters;
 	
 	// non-direct fetch
 	appMode		mode;
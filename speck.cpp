@@ -0,0 +1,621 @@
+// Speck implementation
+#include "speck.h"
+#include <cmath>
+#include <iostream>
+#include <iomanip>
+#include "trace.h"
+#include "perfcounters.h"
+
+// Speck constructor
+Speck::Speck(Image &im, Arena *arena) : image(im), passLists_(0), passBytes_(0) {
+	elapsedTime_ = 0.0;
+	arena_ = arena;
+	// call dataGroupInit
+	dt_.DataGroupInit(version, 3, image.getWidth(), image.getHeight(), arena);
+	coefs_.setArena(arena);
+	lists_.setArena(arena);
+	wideLists_.setArena(arena);
+	// pass image to imagePtr
+	imagePtr = &image;
+}
+
+// encode function
+// get settings, planeVal and bits
+// perform encoding of plane
+// IMPORTANT ASSUMPTION: this will be called in proper order - y, cB, cR!!!
+// otherwise can throw ExcOutOfOrder
+void Speck::singleChannelEncode(Settings &sets, planeVal p, bitCount bits) {
+	TraceSpan span("encode plane", p);
+
+	if(sets.printExtended)
+		EXTENDED = true;
+	else
+		EXTENDED = false;
+
+	if(sets.printTiming)
+		TIMING = true;
+	else
+		TIMING = false;
+
+	// compute bandsizes
+	computeBandSize(sets, *sourcePtr, p);
+
+	plane_ = p;
+	// test if out of order
+	if(p > 2) {
+		std::cout << "Wrong plane ID!" << std::endl;
+		throw ExcWrongPlaneID();
+	}
+
+	// 32-bit coordinates only for images over 65535 a side
+	if(wideCoords(sourcePtr->getWidth(), sourcePtr->getHeight()))
+		encodePlane(wideLists_, sets, p, bits);
+	else
+		encodePlane(lists_, sets, p, bits);
+}
+
+// encode plane p on lists L
+template <class C>
+void Speck::encodePlane(Lists<C> &L, Settings &sets, planeVal p, bitCount bits) {
+	// timer ON
+	TraceTimer timer("init", p);
+
+	// integer magnitudes & signs, done once for all passes
+	coefs_.quantize(*sourcePtr, p);
+	// init lists, set magnitudes
+	initLists(L, true);
+	// get nMax
+	nMax_ = computeSteps();
+
+	// timer OFF
+	elapsedTime_ += timer.stop();
+
+	if(TIMING)
+		std::cout << std::fixed << std::setprecision(8) << "Elapsed time on init = " << timer.seconds() << std::endl;
+
+	// init params & bs
+	n_ = nMax_;
+	currThr_ = 1 << nMax_;
+
+	dt_.bs_.push_back(ColorCodec::DataGroup::BitStream(nMax_, bits, (p==y)?sets.levels:(sets.levels+sets.colorShift), arena_,
+		ColorCodec::DataGroup::BitStream::bitsBound((uint64_t) sourcePtr->getWidth() * sourcePtr->getHeight(), nMax_)));
+	// ref to bitstream: is now bs
+	ColorCodec::DataGroup::BitStream& bs = dt_.bs_[plane_];
+
+	if(EXTENDED)
+		std::cout << "SPECK encoder enabled. Encoding plane " << p << "." << std::endl;
+
+	// main loop
+	while(n_ >= 0) {
+		unsigned currStep = nMax_ - n_ + 1;
+
+		// timer ON
+		TraceTimer timer("step", n_);
+		beginPass(L);
+
+		bitCount sout, rout;
+		{
+			TraceSpan span("sorting pass", n_);
+			PerfSpan counters("encoder sorting pass", n_);
+			sout = sortingPassC(L, bs);
+		}
+		{
+			TraceSpan span("refinement pass", n_);
+			PerfSpan counters("encoder refinement pass", n_);
+			rout = refinementPassC(L, bs);
+		}
+
+		// timer OFF
+		double seconds = timer.stop();
+		elapsedTime_ += seconds;
+
+		const PassStats &pass = endPass(L, stats_.planes[p], currStep, sout, rout, seconds, bs.finished);
+		if(EXTENDED)
+			pass.print(false);
+
+		// pass boundary for pass-interleaved files
+		bs.markPass();
+
+		// possible ending - lossless
+		if(n_ == 0) {
+			bs.performClose();
+		}
+
+		// detect possible ending
+		if(bs.finished) {
+			if(EXTENDED)
+				std::cout << "SPECK encoding done. " << bits << " bits (" << std::setprecision(1) << std::fixed
+					  << (double) bits/8.0 << "B) stored in bitstream." << std::endl;
+			break;
+		}
+
+		n_--; currThr_ >>= 1;
+	}
+
+	// coefficients are done with
+	coefs_.discard(p);
+}
+
+// decode function
+// get settings, planeVal
+// perform decoding of plane
+// IMPORTANT ASSUMPTION: this will be called in proper order - y, cB, cR!!!
+// otherwise can throw ExcOutOfOrder
+void Speck::singleChannelDecode(Settings &sets, planeVal p, bitCount bits) {
+	TraceSpan span("decode plane", p);
+
+	// compute bandsizes
+	computeBandSize(sets, image, p);
+
+	if(sets.printExtended)
+		EXTENDED = true;
+	else
+		EXTENDED = false;
+
+	if(sets.printTiming)
+		TIMING = true;
+	else
+		TIMING = false;
+
+	// test if out of order
+	if(p > 2) {
+		std::cout << "Wrong plane ID!" << std::endl;
+		throw ExcWrongPlaneID();
+	}
+
+	dt_.DataGroupCheck(version, 3);
+
+	// ref to bitstream: is now bs
+	plane_ = p;
+	ColorCodec::DataGroup::BitStream& bs = dt_.bs_[plane_];
+
+	// check if this bs is OK, deal with bitsize
+	bs.checkSettings(sets, bits);
+
+	// 32-bit coordinates only for images over 65535 a side
+	if(wideCoords(image.getWidth(), image.getHeight()))
+		decodePlane(wideLists_, bs, p);
+	else
+		decodePlane(lists_, bs, p);
+}
+
+// decode plane p on lists L
+template <class C>
+void Speck::decodePlane(Lists<C> &L, DataGroup::BitStream &bs, planeVal p) {
+	bitCount bitCnt = bs.getTotalBits();
+
+	// timer ON
+	TraceTimer timer("init", p);
+
+	// init lists
+	initLists(L, false);
+	coefs_.clear(p, image.getWidth(), image.getHeight());
+	nMax_ = bs.getMaxSteps();
+
+	// timer OFF
+	elapsedTime_ += timer.stop();
+
+	if(TIMING)
+		std::cout << std::fixed << std::setprecision(8) << "Elapsed time on init = " << timer.seconds() << std::endl;
+
+	// init params & bs
+	n_ = nMax_;
+	decodingOver_ = false;
+	currThr_ = 1 << nMax_;
+
+	if(EXTENDED)
+		std::cout << "SPECK decoder enabled. Decoding plane " << p << "." << std::endl;
+
+	// main loop
+	while(n_ >= 0) {
+		unsigned currStep = nMax_ - n_ + 1;
+
+		// timer ON
+		TraceTimer timer("step", n_);
+		beginPass(L);
+
+		bitCount sout, rout;
+		{
+			TraceSpan span("sorting pass", n_);
+			PerfSpan counters("decoder sorting pass", n_);
+			sout = sortingPassD(L, bs);
+		}
+		{
+			TraceSpan span("refinement pass", n_);
+			PerfSpan counters("decoder refinement pass", n_);
+			rout = refinementPassD(L, bs);
+		}
+
+		// timer OFF
+		double seconds = timer.stop();
+		elapsedTime_ += seconds;
+
+		const PassStats &pass = endPass(L, stats_.planes[p], currStep, sout, rout, seconds, decodingOver_);
+		if(EXTENDED)
+			pass.print(false);
+
+		// possible ending - lossless
+		if(n_ == 0) {
+			bs.performClose();
+		}
+
+		// detect possible ending
+		if(decodingOver_) {
+			if(EXTENDED)
+				std::cout << "SPECK decoding done. " << bitCnt << " bits (" << std::setprecision(1) << std::fixed
+					  << (double) bitCnt/8.0 << "B) from bitstream have been processed." << std::endl;
+			break;
+		}
+
+		n_--; currThr_ >>= 1;
+	}
+
+	// back to the image plane at once
+	coefs_.dequantize(image, p);
+	coefs_.discard(p);
+}
+
+
+// ----------- private methods
+// init LIS - put LLtop as the first S set
+// I set is the rest of the plane
+template <class C>
+void Speck::initLists(Lists<C> &L, bool encoding) {
+	// delete all lists
+	for(unsigned k = 0; k < SPECK_CLASSES; ++k)
+		L.LIS[k].clear();
+	L.LSP.clear();
+
+	Rect<C> s(0, 0, (C) bandSizeW_, (C) bandSizeH_);
+	iW_ = bandSizeW_;
+	iH_ = bandSizeH_;
+	iLevel_ = 0;
+	levels_ = 0;
+	while(bandSide(image.getWidth(), levels_) > bandSizeW_ || bandSide(image.getHeight(), levels_) > bandSizeH_)
+		levels_++;
+
+	if(encoding) {
+		s.bits = coefs_.orRange(0, 0, s.W, s.H, plane_);
+
+		// I set magnitudes of all octaves, from the last (empty) one up
+		iBits_.assign(levels_ + 1, 0);
+		for(int k = (int) levels_ - 1; k >= 0; --k) {
+			Rect<C> o[3];
+			unsigned count = bands((unsigned) k, o, true);
+			iBits_[k] = iBits_[k+1];
+			for(unsigned i = 0; i < count; ++i)
+				iBits_[k] |= o[i].bits;
+		}
+	}
+
+	L.LIS[sizeClass(s)].push_back(s);
+}
+// computes max magnitude of image plane and steps number
+unsigned Speck::computeSteps() {
+	qUnit max = coefs_.getMax(plane_);
+
+	// compute nMax_
+	return highestBit(max);
+}
+// size class of a set: ceil(log2) of its larger side
+template <class C>
+unsigned Speck::sizeClass(const Rect<C> &s) {
+	unsigned side = (s.W > s.H) ? s.W : s.H;
+	unsigned k = highestBit(side);
+	return ((1u << k) < side) ? k + 1 : k;
+}
+// quadtree partitioning: four quadrants of s (top-left one takes the odd line)
+template <class C>
+unsigned Speck::split(const Rect<C> &s, Rect<C> *o, bool encoding) const {
+	C w1 = (C) ((s.W + 1) / 2);
+	C h1 = (C) ((s.H + 1) / 2);
+	unsigned count = 0;
+
+	o[count++] = Rect<C>(s.X, s.Y, w1, h1);
+	if(s.W > w1)
+		o[count++] = Rect<C>(s.X + w1, s.Y, s.W - w1, h1);
+	if(s.H > h1)
+		o[count++] = Rect<C>(s.X, s.Y + h1, w1, s.H - h1);
+	if(s.W > w1 && s.H > h1)
+		o[count++] = Rect<C>(s.X + w1, s.Y + h1, s.W - w1, s.H - h1);
+
+	if(encoding)
+		for(unsigned i = 0; i < count; ++i)
+			o[i].bits = coefs_.orRange(o[i].X, o[i].Y, o[i].W, o[i].H, plane_);
+
+	return count;
+}
+// octave band partitioning: the three subbands of octave k next to the top-left iw x ih rectangle,
+// its low band; high bands of uneven sizes are one shorter than it (bandSide())
+template <class C>
+unsigned Speck::bands(unsigned k, Rect<C> *o, bool encoding) const {
+	unsigned width = image.getWidth();
+	unsigned height = image.getHeight();
+	unsigned iw = bandSide(width, levels_ - k);
+	unsigned ih = bandSide(height, levels_ - k);
+	// sides of the subbands
+	unsigned w0 = iw;
+	unsigned h0 = ih;
+	unsigned w1 = bandSide(width, levels_ - k - 1) - iw;
+	unsigned h1 = bandSide(height, levels_ - k - 1) - ih;
+	unsigned count = 0;
+
+	// top right, bottom left, bottom right
+	if(w1 > 0 && h0 > 0)
+		o[count++] = Rect<C>((C) iw, 0, (C) w1, (C) h0);
+	if(w0 > 0 && h1 > 0)
+		o[count++] = Rect<C>(0, (C) ih, (C) w0, (C) h1);
+	if(w1 > 0 && h1 > 0)
+		o[count++] = Rect<C>((C) iw, (C) ih, (C) w1, (C) h1);
+
+	if(encoding)
+		for(unsigned i = 0; i < count; ++i)
+			o[i].bits = coefs_.orRange(o[i].X, o[i].Y, o[i].W, o[i].H, plane_);
+
+	return count;
+}
+// record of a step: list sizes, scan tally & arena use at its start
+template <class C>
+void Speck::beginPass(const Lists<C> &L) {
+	pass_.clear();
+#if !defined(SPIHT_NO_STATS)
+	passLists_ = L.lisSize() + L.LSP.size();
+	passTally_ = scanTally();
+	passBytes_ = arena_ ? arena_->getAllocated() : 0;
+#endif
+}
+// record of a step: output, list sizes & differences of the counters over it,
+// growth of the lists and the erased sets are the insertions
+template <class C>
+const PassStats& Speck::endPass(const Lists<C> &L, std::vector<PassStats> &stats, unsigned step, bitCount sout, bitCount rout, double seconds, bool finished) {
+	pass_.step = step;
+	pass_.finished = finished;
+	pass_.sortingBits = sout;
+	pass_.refinementBits = rout;
+	pass_.lisSize = L.lisSize();
+	pass_.lspSize = L.LSP.size();
+	pass_.seconds = seconds;
+#if !defined(SPIHT_NO_STATS)
+	const ScanTally &tally = scanTally();
+	pass_.lspRefined = rout;
+	pass_.maxTests = tally.tests - passTally_.tests;
+	pass_.coefsScanned = tally.coefs - passTally_.coefs;
+	pass_.insertions = L.lisSize() + L.LSP.size() + pass_.erasures - passLists_;
+	pass_.bytesAllocated = arena_ ? arena_->getAllocated() - passBytes_ : 0;
+#endif
+	stats.push_back(pass_);
+	return pass_;
+}
+
+// coding: does a sorting pass, output enabled, returns number of bits outputted
+template <class C>
+bitCount Speck::sortingPassC(Lists<C> &L, DataGroup::BitStream &bs) {
+	bitCount bitsOut = 0;
+	// everything in LSP by now is refined in this pass
+	lspOld_ = L.LSP.size();
+
+	// part 1: LIS processing, smallest sets first
+	// new sets of this pass go to smaller classes, already swept
+	for(unsigned k = 0; k < SPECK_CLASSES; ++k) {
+		typename Lists<C>::RectVector &lis = L.LIS[k];
+		// r reads, w writes back sets staying in LIS
+		size_t w = 0;
+		for(size_t r = 0; r < lis.size(); ++r) {
+			Rect<C> s = lis[r];
+			bool sig = (s.bits >> n_) != 0;
+			CODER_COUNT(pass_.lisVisits, 1);
+			// output significance
+			if(!bs.put(sig)) { lis.erase(lis.begin() + w, lis.begin() + r); return bitsOut; } else bitsOut++;
+			if(sig) {
+				// code it, discard from LIS
+				CODER_COUNT(pass_.erasures, 1);
+				if(!codeSC(L, bs, s, bitsOut)) { lis.erase(lis.begin() + w, lis.begin() + r + 1); return bitsOut; }
+			} else {
+				lis[w++] = s;
+			}
+		}
+		lis.resize(w);
+	}
+
+	// part 2: I set processing
+	processIC(L, bs, bitsOut);
+
+	return bitsOut;
+}
+// coding: test & code a set not in LIS
+template <class C>
+bool Speck::processSC(Lists<C> &L, DataGroup::BitStream &bs, const Rect<C> &s, bitCount &bitsOut) {
+	bool sig = (s.bits >> n_) != 0;
+	// output significance
+	if(!bs.put(sig)) return false; else bitsOut++;
+	if(sig)
+		return codeSC(L, bs, s, bitsOut);
+
+	// into LIS
+	L.LIS[sizeClass(s)].push_back(s);
+	return true;
+}
+// coding: code a significant set
+template <class C>
+bool Speck::codeSC(Lists<C> &L, DataGroup::BitStream &bs, const Rect<C> &s, bitCount &bitsOut) {
+	// single coefficient: output sign, move into LSP
+	if(s.W == 1 && s.H == 1) {
+		if(!bs.put(!coefs_.isNegative(s.X, s.Y, plane_))) return false; else bitsOut++;
+		L.LSP.push_back(CoordXY<C>(s.X, s.Y));
+		return true;
+	}
+
+	// quadtree partitioning
+	Rect<C> o[4];
+	unsigned count = split(s, o, true);
+	CODER_COUNT(pass_.expandedA, 1);
+	for(unsigned i = 0; i < count; ++i)
+		if(!processSC(L, bs, o[i], bitsOut)) return false;
+
+	return true;
+}
+// coding: test & partition the I set
+template <class C>
+bool Speck::processIC(Lists<C> &L, DataGroup::BitStream &bs, bitCount &bitsOut) {
+	// until I is empty
+	while(iW_ < image.getWidth() || iH_ < image.getHeight()) {
+		bool sig = (iBits_[iLevel_] >> n_) != 0;
+		// output significance
+		if(!bs.put(sig)) return false; else bitsOut++;
+		if(!sig)
+			return true;
+
+		// octave band partitioning, the rest stays I
+		Rect<C> o[3];
+		unsigned count = bands(iLevel_, o, true);
+		CODER_COUNT(pass_.expandedB, 1);
+		iLevel_++;
+		iW_ = bandSide(image.getWidth(), levels_ - iLevel_);
+		iH_ = bandSide(image.getHeight(), levels_ - iLevel_);
+
+		for(unsigned i = 0; i < count; ++i)
+			if(!processSC(L, bs, o[i], bitsOut)) return false;
+	}
+
+	return true;
+}
+// coding: does a refinement pass, output enabled, returns number of bits outputted
+template <class C>
+bitCount Speck::refinementPassC(Lists<C> &L, DataGroup::BitStream &bs) {
+	bitCount bitsOut = 0;
+
+	// entries of previous passes: output bit n of the magnitude
+	for(size_t i = 0; i < lspOld_; ++i) {
+		if(!bs.put((coefs_(L.LSP[i].X, L.LSP[i].Y, plane_) >> n_) & 1)) return bitsOut; else bitsOut++;
+	}
+
+	return bitsOut;
+}
+
+// decoding: does a sorting pass, returns number of bits processed
+template <class C>
+bitCount Speck::sortingPassD(Lists<C> &L, DataGroup::BitStream &bs) {
+	bitCount bitsOut = 0;
+	signed char getBit = 0;
+	// everything in LSP by now is refined in this pass
+	lspOld_ = L.LSP.size();
+
+	// part 1: LIS processing, smallest sets first
+	for(unsigned k = 0; k < SPECK_CLASSES; ++k) {
+		typename Lists<C>::RectVector &lis = L.LIS[k];
+		// r reads, w writes back sets staying in LIS
+		size_t w = 0;
+		for(size_t r = 0; r < lis.size(); ++r) {
+			Rect<C> s = lis[r];
+			CODER_COUNT(pass_.lisVisits, 1);
+			// read significance
+			if((getBit = bs.get()) == -1) { decodingOver_ = true; lis.erase(lis.begin() + w, lis.begin() + r); return bitsOut; }
+			bitsOut++;
+			if(getBit == 1) {
+				// decode it, discard from LIS
+				CODER_COUNT(pass_.erasures, 1);
+				if(!codeSD(L, bs, s, bitsOut)) { lis.erase(lis.begin() + w, lis.begin() + r + 1); return bitsOut; }
+			} else {
+				lis[w++] = s;
+			}
+		}
+		lis.resize(w);
+	}
+
+	// part 2: I set processing
+	processID(L, bs, bitsOut);
+
+	return bitsOut;
+}
+// decoding: test & decode a set not in LIS
+template <class C>
+bool Speck::processSD(Lists<C> &L, DataGroup::BitStream &bs, const Rect<C> &s, bitCount &bitsOut) {
+	signed char getBit = 0;
+	// read significance
+	if((getBit = bs.get()) == -1) { decodingOver_ = true; return false; }
+	bitsOut++;
+	if(getBit == 1)
+		return codeSD(L, bs, s, bitsOut);
+
+	// into LIS
+	L.LIS[sizeClass(s)].push_back(s);
+	return true;
+}
+// decoding: decode a significant set
+template <class C>
+bool Speck::codeSD(Lists<C> &L, DataGroup::BitStream &bs, const Rect<C> &s, bitCount &bitsOut) {
+	signed char getBit = 0;
+	// single coefficient: get sign, move into LSP
+	if(s.W == 1 && s.H == 1) {
+		if((getBit = bs.get()) == -1) { decodingOver_ = true; return false; }
+		bitsOut++;
+		// 1.5 * threshold, sign according to bit
+		coefs_(s.X, s.Y, plane_) = (3 << n_) << (QUANT_FRACBITS - 1);
+		coefs_.setNegative(s.X, s.Y, plane_, getBit != 1);
+		L.LSP.push_back(CoordXY<C>(s.X, s.Y));
+		return true;
+	}
+
+	// quadtree partitioning
+	Rect<C> o[4];
+	unsigned count = split(s, o, false);
+	CODER_COUNT(pass_.expandedA, 1);
+	for(unsigned i = 0; i < count; ++i)
+		if(!processSD(L, bs, o[i], bitsOut)) return false;
+
+	return true;
+}
+// decoding: test & partition the I set
+template <class C>
+bool Speck::processID(Lists<C> &L, DataGroup::BitStream &bs, bitCount &bitsOut) {
+	signed char getBit = 0;
+	// until I is empty
+	while(iW_ < image.getWidth() || iH_ < image.getHeight()) {
+		// read significance
+		if((getBit = bs.get()) == -1) { decodingOver_ = true; return false; }
+		bitsOut++;
+		if(getBit != 1)
+			return true;
+
+		// octave band partitioning, the rest stays I
+		Rect<C> o[3];
+		unsigned count = bands(iLevel_, o, false);
+		CODER_COUNT(pass_.expandedB, 1);
+		iLevel_++;
+		iW_ = bandSide(image.getWidth(), levels_ - iLevel_);
+		iH_ = bandSide(image.getHeight(), levels_ - iLevel_);
+
+		for(unsigned i = 0; i < count; ++i)
+			if(!processSD(L, bs, o[i], bitsOut)) return false;
+	}
+
+	return true;
+}
+// decoding: does a refinement pass, returns number of bits processed
+template <class C>
+bitCount Speck::refinementPassD(Lists<C> &L, DataGroup::BitStream &bs) {
+	// exit upon finished reading
+	if(decodingOver_)
+		return 0;
+
+	bitCount bitsOut = 0;
+	signed char getBit = 0;
+
+	// refinement step (half threshold)
+	qUnit step = (1 << n_) << (QUANT_FRACBITS - 1);
+
+	// read bits, "refine" magnitudes marked by LSP entries of previous passes
+	for(size_t i = 0; i < lspOld_; ++i) {
+		// get a bit
+		if((getBit = bs.get()) == -1) { decodingOver_ = true; return bitsOut; }
+		bitsOut++;
+
+		// move up or down by half of the interval
+		if(getBit == 1)
+			coefs_(L.LSP[i].X, L.LSP[i].Y, plane_) += step;
+		else
+			coefs_(L.LSP[i].X, L.LSP[i].Y, plane_) -= step;
+	}
+
+	return bitsOut;
+}
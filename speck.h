@@ -0,0 +1,142 @@
+// SPECK: set partitioning embedded block coder, single channel
+#ifndef SPECK_H
+#define SPECK_H
+
+#include "colorcodec.h"
+#include "spiht.h"
+#include "spihtpolicy.h"
+#include "general.h"
+#include "image.h"
+#include "quantimage.h"
+#include "arena.h"
+#include "codecstats.h"
+#include <vector>
+
+// number of set size classes (log2 of the largest side + 1)
+#define SPECK_CLASSES 33
+
+// class SPECK
+// codes the wavelet planes with quadtree (S sets) and octave band (I set) partitioning
+// uses the plane split, bitstream and container of Spiht
+// LIS holds insignificant S sets by size class, processed from the smallest,
+// there is no LIP - single coefficients are the smallest S sets
+// sets & LSP entries have 16-bit coordinates, 32-bit ones only on images over 65535 a side
+// constructs implementation, takes Image
+// implements singleChannelEncode & singleChannelDecode
+class Speck : public Spiht {
+	const static unsigned char version = 0xC0;
+
+	// S set: rectangle of coefficients, coordinates of type C,
+	// encoder keeps OR of its magnitudes, so significance is one shift
+	template <class C> struct Rect {
+		C X;
+		C Y;
+		C W;
+		C H;
+		qUnit bits;
+		Rect(): X(0), Y(0), W(0), H(0), bits(0) {};
+		explicit Rect(C x, C y, C w, C h): X(x), Y(y), W(w), H(h), bits(0) {};
+	};
+
+	// LIS by size class & LSP on coordinates of type C, drawn from the job arena
+	template <class C> struct Lists {
+		typedef std::vector<Rect<C>, ArenaAllocator<Rect<C> > > RectVector;
+		typedef std::vector<CoordXY<C>, ArenaAllocator<CoordXY<C> > > XYVector;
+
+		RectVector LIS[SPECK_CLASSES];
+		XYVector LSP;
+
+		// draw from given arena (0 = heap)
+		void setArena(Arena *arena) {
+			for(unsigned k = 0; k < SPECK_CLASSES; ++k)
+				LIS[k] = RectVector(ArenaAllocator<Rect<C> >(arena));
+			LSP = XYVector(ArenaAllocator<CoordXY<C> >(arena));
+		}
+		// count of sets in LIS
+		size_t lisSize() const {
+			size_t size = 0;
+			for(unsigned k = 0; k < SPECK_CLASSES; ++k)
+				size += LIS[k].size();
+			return size;
+		}
+	};
+
+	// privates
+	Image& image;
+	planeVal plane_;
+	QuantImage coefs_;		// integer coefficients of the coded plane
+
+	// on-the-fly properties
+	int		 n_;			// current step
+	unsigned nMax_;			// max steps
+	qUnit currThr_;			// current threshold (2^n_)
+	size_t lspOld_;			// LSP entries from previous passes (to be refined)
+	bool decodingOver_;		// flag for decoding is over
+
+	// I set: everything but the top-left iW_ x iH_ rectangle (low band after levels_ - iLevel_ WT levels)
+	unsigned iW_;
+	unsigned iH_;
+	unsigned iLevel_;				// octave of the I set
+	unsigned levels_;				// WT levels of the plane (octaves)
+	std::vector<qUnit> iBits_;		// (encoding) OR of magnitudes of the I set of each octave
+
+	// lists
+	Lists<wCoord> lists_;
+	Lists<wCoordWide> wideLists_;	// same on 32-bit coordinates
+
+	// record of the current step; list sizes, scan tally & arena use at its start
+	PassStats pass_;
+	size_t passLists_;
+	ScanTally passTally_;
+	size_t passBytes_;
+
+	// ----------- private methods
+	// passes of plane p on lists L (encoding: bits given, decoding: bits of bs to be read)
+	template <class C> void encodePlane(Lists<C> &L, Settings &sets, planeVal p, bitCount bits);
+	template <class C> void decodePlane(Lists<C> &L, DataGroup::BitStream &bs, planeVal p);
+	// init LIS, I set (and its magnitudes when encoding)
+	template <class C> void initLists(Lists<C> &L, bool encoding);
+	// computes max magnitude of the plane, returns maxSteps property
+	unsigned computeSteps();
+	// size class of a set
+	template <class C> static unsigned sizeClass(const Rect<C> &s);
+	// quadtree partitioning of S set, returns number of (non-empty) offspring
+	template <class C> unsigned split(const Rect<C> &s, Rect<C> *o, bool encoding) const;
+	// octave band partitioning of the I set of octave k into 3 S sets, returns number of (non-empty) ones
+	template <class C> unsigned bands(unsigned k, Rect<C> *o, bool encoding) const;
+	// record of a step: start, end (bits of the passes, their time, bitstream over) appended to stats
+	template <class C> void beginPass(const Lists<C> &L);
+	template <class C> const PassStats& endPass(const Lists<C> &L, std::vector<PassStats> &stats, unsigned step, bitCount sout, bitCount rout, double seconds, bool finished);
+
+	// (encoding) does a sorting pass, output enabled, returns number of bits outputted
+	template <class C> bitCount sortingPassC(Lists<C> &L, DataGroup::BitStream &bs);
+	// (encoding) does a refinement pass, output enabled, returns number of bits outputted
+	template <class C> bitCount refinementPassC(Lists<C> &L, DataGroup::BitStream &bs);
+	// (encoding) test & code a set not in LIS, false if bitstream full
+	template <class C> bool processSC(Lists<C> &L, DataGroup::BitStream &bs, const Rect<C> &s, bitCount &bitsOut);
+	// (encoding) code a significant set, false if bitstream full
+	template <class C> bool codeSC(Lists<C> &L, DataGroup::BitStream &bs, const Rect<C> &s, bitCount &bitsOut);
+	// (encoding) test & partition the I set, false if bitstream full
+	template <class C> bool processIC(Lists<C> &L, DataGroup::BitStream &bs, bitCount &bitsOut);
+
+	// (decoding) does a sorting pass, returns number of bits processed
+	template <class C> bitCount sortingPassD(Lists<C> &L, DataGroup::BitStream &bs);
+	// (decoding) does a refinement pass, returns number of bits processed
+	template <class C> bitCount refinementPassD(Lists<C> &L, DataGroup::BitStream &bs);
+	// (decoding) test & decode a set not in LIS, false if bitstream exhausted
+	template <class C> bool processSD(Lists<C> &L, DataGroup::BitStream &bs, const Rect<C> &s, bitCount &bitsOut);
+	// (decoding) decode a significant set, false if bitstream exhausted
+	template <class C> bool codeSD(Lists<C> &L, DataGroup::BitStream &bs, const Rect<C> &s, bitCount &bitsOut);
+	// (decoding) test & partition the I set, false if bitstream exhausted
+	template <class C> bool processID(Lists<C> &L, DataGroup::BitStream &bs, bitCount &bitsOut);
+
+public:
+	// constructor
+	// arena: optional job memory for the lists and bitstreams
+	Speck(Image& im, Arena *arena = 0);
+	// virtual overloads
+	virtual void singleChannelEncode(Settings &sets, planeVal p, bitCount bits);
+	virtual void singleChannelDecode(Settings &sets, planeVal p, bitCount bits);
+};
+
+#endif
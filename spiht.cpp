@@ -3,8 +3,9 @@
 #include <iostream>
 #include <iomanip>
 #include <vector>
+#include <algorithm>
 #include "general.h"
-#include "tbb/tick_count.h"
+#include "trace.h"
 
 // encodes separated channels using settings
 // and calls appropriate number of singleChannelEncode()
@@ -27,17 +28,21 @@ void Spiht::encode(Settings &sets) {
 	
 	// erase bitstream
 	dt_.bs_.clear();
+	dt_.interleaved_ = sets.interleaveFlag;
 	wUnit varY, varCB, varCR;
 	elapsedTime_ = 0.0;
+	stats_.clear();
 	
-	tbb::tick_count t0 = tbb::tick_count::now();
+	TraceTimer timer("variance");
 	
 	varY = imagePtr->computeTotalVariance(sets,y);
 	varCB = sets.biasCB * imagePtr->computeTotalVariance(sets,cB);
 	varCR = sets.biasCR * imagePtr->computeTotalVariance(sets,cR);
+	stats_.variance[y] = varY;
+	stats_.variance[cB] = varCB;
+	stats_.variance[cR] = varCR;
 	
-	tbb::tick_count t1 = tbb::tick_count::now();
-	elapsedTime_ += (t1-t0).seconds();
+	elapsedTime_ += timer.stop();
 	
 	if(TIMING)
 		std::cout << "Variance measurement elapsed time: " <<  std::fixed << std::setprecision(8)  << elapsedTime_ << std::endl; 
@@ -45,24 +50,27 @@ void Spiht::encode(Settings &sets) {
 	
 	if(EXTENDED) {
 		std::cout << "Total variance for plane y at depth " << sets.varianceDepth << " is " 
-				  << varY << std::endl;
+				  << stats_.variance[y] << std::endl;
 		std::cout << "Total variance for plane cB at depth " << sets.varianceDepth << " (biased) is " 
-				  << varCB << std::endl;
+				  << stats_.variance[cB] << std::endl;
 		std::cout << "Total variance for plane cR at depth " << sets.varianceDepth << " (biased) is " 
-				  << varCR << std::endl;
+				  << stats_.variance[cR] << std::endl;
 	}
 
-	// finish DWT
+	// finish DWT, on a copy
+	sourcePtr = imagePtr;
 	if(!sets.computeDeepVariance && sets.colorShift > 0) {
 		double elapsedTemp;
 		
-		tbb::tick_count t0 = tbb::tick_count::now();
+		TraceTimer timer("CLS forward WT");
 		
-		Flwt::forward(sets.colorShift, imagePtr->getMatrix(cB));
-		Flwt::forward(sets.colorShift, imagePtr->getMatrix(cR));
+		shifted_.setArena(arena_);
+		shifted_ = *imagePtr;
+		Flwt::forward(sets.colorShift, shifted_.getMatrix(cB), arena_);
+		Flwt::forward(sets.colorShift, shifted_.getMatrix(cR), arena_);
+		sourcePtr = &shifted_;
 		
-		tbb::tick_count t1 = tbb::tick_count::now();
-		elapsedTemp = (t1-t0).seconds();
+		elapsedTemp = timer.stop();
 		elapsedTime_ += elapsedTemp;
 		
 		if(TIMING)
@@ -81,19 +89,19 @@ void Spiht::encode(Settings &sets) {
 		else
 			pct = varCR / (varY + varCB + varCR);
 
-		unsigned bits = (unsigned) ceil(pct * (wUnit) sets.bits);
+		stats_.planeBits[p] = (bitCount) ceil(pct * (wUnit) sets.bits);
 		if(EXTENDED)
-			std::cout << std::endl << "For plane " << p << " algorithm assigned " << bits << "/" << sets.bits 
+			std::cout << std::endl << "For plane " << p << " algorithm assigned " << stats_.planeBits[p] << "/" << sets.bits 
 				  << " bits (" << std::setprecision(2) << pct * 100.0 << "%)" << std::endl; 
 					
 		// call for singleChannelEncode
-		singleChannelEncode(sets, (planeVal) p, bits);			
+		singleChannelEncode(sets, (planeVal) p, stats_.planeBits[p]);			
 	}
 }
 
 // decodes separated channels using settings
 // and calls appropriate number of singleChannelDecode()
-void Spiht::decode(Settings &sets, unsigned desiredBits) {
+void Spiht::decode(Settings &sets, bitCount desiredBits) {
 	
 	if(sets.printExtended)
 		EXTENDED = true;
@@ -111,21 +119,45 @@ void Spiht::decode(Settings &sets, unsigned desiredBits) {
 		throw ExcWrongBitStream();	
 	}
 	elapsedTime_ = 0.0;
+	stats_.clear();
 	// clear & init image
 	imagePtr->clear(dt_.getWidth(), dt_.getHeight());
 
-	std::cout << std::endl;
+	if(EXTENDED)
+		std::cout << std::endl;
 	
-	std::vector<unsigned> bitCounts(3,0);
+	std::vector<bitCount> bitCounts(3,0);
 		
-	unsigned bitSum = dt_.bs_[0].getTotalBits() + dt_.bs_[1].getTotalBits() + dt_.bs_[2].getTotalBits();
+	bitCount bitSum = dt_.bs_[0].getTotalBits() + dt_.bs_[1].getTotalBits() + dt_.bs_[2].getTotalBits();
 	// "ratio-ize" the bitCounts
 	if(desiredBits > 0 && desiredBits < bitSum) {
-		for(unsigned p = 0; p < 3; p ++)
-			bitCounts[p] = (unsigned) floor(((wUnit) dt_.bs_[p].getTotalBits() / (wUnit) bitSum) * (wUnit) bitSum);
+		if(!dt_.chunks_.empty()) {
+			// pass-interleaved file: planes as in the file prefix, at least one bit (0 means all)
+			dt_.prefixBits(desiredBits, bitCounts);
+			for(unsigned p = 0; p < 3; p ++)
+				bitCounts[p] = std::max(bitCounts[p], (bitCount) 1);
+		} else {
+			// planes in proportion to their streams, the bits lost by rounding down go to the first ones
+			bitCount given = 0;
+			for(unsigned p = 0; p < 3; p ++) {
+				bitCount total = dt_.bs_[p].getTotalBits();
+				bitCounts[p] = std::min(total, (bitCount) floor((wUnit) total * (wUnit) desiredBits / (wUnit) bitSum));
+				given += bitCounts[p];
+			}
+			for(unsigned p = 0; p < 3 && given < desiredBits; p ++) {
+				bitCount more = std::min(desiredBits - given, dt_.bs_[p].getTotalBits() - bitCounts[p]);
+				bitCounts[p] += more;
+				given += more;
+			}
+			// at least one bit (0 means all)
+			for(unsigned p = 0; p < 3; p ++)
+				bitCounts[p] = std::max(bitCounts[p], (bitCount) 1);
+		}
 	}
 
 	for(unsigned p = 0; p < 3; p ++) {
+		// 0 = whole stream
+		stats_.planeBits[p] = bitCounts[p] ? bitCounts[p] : dt_.bs_[p].getTotalBits();
 		// call for singleChannelDecode
 		singleChannelDecode(sets, (planeVal) p, bitCounts[p]);			
 	}
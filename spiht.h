@@ -20,34 +20,19 @@ protected:
 	// image, instead of reference this will be ptr
 	// WARNING! must be initialized in inheritant's constructor
 	Image *imagePtr;
+	// (encoding) planes to code: imagePtr, or the copy with CLS carried on in shifted_,
+	// so encoding leaves the image as it is (shared by several coders)
+	const Image *sourcePtr;
+	Image shifted_;
 
 public:
-	// inherited datatypes
-	// struct for X,Y,P coordinate storage
-	struct XY {
-		wCoord X;
-		wCoord Y;
-		XY(): X(0), Y(0) {};
-		explicit XY(wCoord x, wCoord y): X(x), Y(y) {};
-			
-	};
-
-	// struct for X,Y,type coordinate storage
-	struct XYT {
-		wCoord X;
-		wCoord Y;
-		typeVal T;
-		XYT(): X(0), Y(0), T(typeA) {};
-		explicit XYT(wCoord x, wCoord y, typeVal t): X(x), Y(y), T(t) {};
-	};
-
 	// inherited interface
 	virtual void encode(Settings &sets);
-	virtual void decode(Settings &sets, unsigned desiredBits=0);
+	virtual void decode(Settings &sets, bitCount desiredBits=0);
 	
 	// proposed interface
-	virtual void singleChannelEncode(Settings &sets, planeVal p, unsigned bits) = 0;
-	virtual void singleChannelDecode(Settings &sets, planeVal p, unsigned bits) = 0;
+	virtual void singleChannelEncode(Settings &sets, planeVal p, bitCount bits) = 0;
+	virtual void singleChannelDecode(Settings &sets, planeVal p, bitCount bits) = 0;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,217 @@
+// spihtcoder: single channel SPIHT coders as instantiations of the pass engine
+#ifndef SPIHTCODER_H
+#define SPIHTCODER_H
+
+#include "colorcodec.h"
+#include "spiht.h"
+#include "spihtengine.h"
+#include "general.h"
+#include "image.h"
+#include <iostream>
+#include <iomanip>
+#include "trace.h"
+
+// class SpihtCoder
+// constructs implementation, takes Image
+// implements singleChannelEncode & singleChannelDecode on SpihtEngine<Topology, Storage>,
+// on SpihtEngine<WideTree<Topology>, Storage> for images over 65535 a side
+// the bitstream version is given by the topology (+ ARITH_VERSION when arithmetic coded, + SPIHT_RUN_VERSION when zero-run coded)
+template <class Topology, template <class> class Storage = ListStorage>
+class SpihtCoder : public Spiht {
+protected:
+	typedef SpihtEngine<Topology, Storage> Engine;
+	typedef SpihtEngine<Topology, Storage, ArithStream> ArithEngine;
+	typedef SpihtEngine<WideTree<Topology>, Storage> WideEngine;
+	typedef SpihtEngine<WideTree<Topology>, Storage, ArithStream> WideArithEngine;
+
+	// privates
+	Image& image;
+	Engine engine_;				// plain bits
+	ArithEngine arithEngine_;	// arithmetic coded symbols
+	WideEngine wideEngine_;		// same on 32-bit coordinates
+	WideArithEngine wideArithEngine_;
+	const char *name_;		// coder name for messages
+
+	// encode / decode plane p on given engine, true if the bitstream got finished / exhausted
+	template <class E> bool encodePlane(E &engine, Settings &sets, planeVal p, bitCount bits);
+	template <class E> bool decodePlane(E &engine, planeVal p, bool runs);
+
+public:
+	// constructor
+	// arena: optional job memory for the lists and bitstreams
+	SpihtCoder(Image& im, const char *name, Arena *arena = 0);
+	// virtual overloads
+	virtual void singleChannelEncode(Settings &sets, planeVal p, bitCount bits);
+	virtual void singleChannelDecode(Settings &sets, planeVal p, bitCount bits);
+};
+
+// constructor
+template <class T, template <class> class S>
+SpihtCoder<T,S>::SpihtCoder(Image &im, const char *name, Arena *arena)
+	: image(im), engine_(arena), arithEngine_(arena), wideEngine_(arena), wideArithEngine_(arena), name_(name) {
+	elapsedTime_ = 0.0;
+	arena_ = arena;
+	// call dataGroupInit
+	dt_.DataGroupInit(T::version, 3, image.getWidth(), image.getHeight(), arena);
+	// pass image to imagePtr
+	imagePtr = &image;
+}
+
+// encode function
+// get settings, planeVal and bits
+// perform encoding of plane
+// IMPORTANT ASSUMPTION: this will be called in proper order - y, cB, cR!!!
+// otherwise can throw ExcOutOfOrder
+template <class T, template <class> class S>
+void SpihtCoder<T,S>::singleChannelEncode(Settings &sets, planeVal p, bitCount bits) {
+	TraceSpan span("encode plane", p);
+
+	if(sets.printExtended)
+		EXTENDED = true;
+	else
+		EXTENDED = false;
+
+	if(sets.printTiming)
+		TIMING = true;
+	else
+		TIMING = false;
+
+	// compute bandsizes
+	computeBandSize(sets, *sourcePtr, p);
+
+	// test if out of order
+	if(p > 2) {
+		std::cout << "Wrong plane ID!" << std::endl;
+		throw ExcWrongPlaneID();
+	}
+
+	// arithmetic / zero-run coding is a bitstream property
+	dt_.hdr_.version = (unsigned char) (sets.arithFlag ? (T::version | ARITH_VERSION) : sets.runFlag ? (T::version | SPIHT_RUN_VERSION) : T::version);
+
+	// 32-bit coordinates only for images over 65535 a side
+	bool wide = wideCoords(sourcePtr->getWidth(), sourcePtr->getHeight());
+	bool done;
+	if(sets.arithFlag)
+		done = wide ? encodePlane(wideArithEngine_, sets, p, bits) : encodePlane(arithEngine_, sets, p, bits);
+	else
+		done = wide ? encodePlane(wideEngine_, sets, p, bits) : encodePlane(engine_, sets, p, bits);
+	if(done && EXTENDED)
+		std::cout << name_ << " encoding done. " << bits << " bits (" << std::setprecision(1) << std::fixed
+			  << (double) bits/8.0 << "B) stored in bitstream." << std::endl;
+}
+
+// encode plane p on given engine
+template <class T, template <class> class S>
+template <class E>
+bool SpihtCoder<T,S>::encodePlane(E &engine, Settings &sets, planeVal p, bitCount bits) {
+	// timer ON
+	TraceTimer timer("init", p);
+
+	// init lists, integer coefficients, nMax
+	engine.startEncode(*sourcePtr, p, bandSizeW_, bandSizeH_, sets.bitSliceFlag, sets.runFlag, workers_);
+
+	// timer OFF
+	elapsedTime_ += timer.stop();
+
+	if(TIMING)
+		std::cout << std::fixed << std::setprecision(8) << "Elapsed time on init = " << timer.seconds() << std::endl;
+
+	// init bs
+	dt_.bs_.push_back(ColorCodec::DataGroup::BitStream(engine.nMax_, bits, (p==y)?sets.levels:(sets.levels+sets.colorShift), arena_,
+		ColorCodec::DataGroup::BitStream::bitsBound((uint64_t) sourcePtr->getWidth() * sourcePtr->getHeight(), engine.nMax_)));
+	// ref to bitstream: is now bs
+	ColorCodec::DataGroup::BitStream& bs = dt_.bs_[p];
+
+	if(EXTENDED)
+		std::cout << name_ << " encoder enabled. Encoding plane " << p << "." << std::endl;
+
+	// main loop
+	bool done = encodeStream(engine, bs, EXTENDED, elapsedTime_, &stats_.planes[p]);
+
+	// coefficients are done with
+	engine.finishEncode();
+
+	return done;
+}
+
+// decode function
+// get settings, planeVal
+// perform decoding of plane
+// IMPORTANT ASSUMPTION: this will be called in proper order - y, cB, cR!!!
+// otherwise can throw ExcOutOfOrder
+template <class T, template <class> class S>
+void SpihtCoder<T,S>::singleChannelDecode(Settings &sets, planeVal p, bitCount bits) {
+	TraceSpan span("decode plane", p);
+
+	// compute bandsizes
+	computeBandSize(sets, image, p);
+
+	if(sets.printExtended)
+		EXTENDED = true;
+	else
+		EXTENDED = false;
+
+	if(sets.printTiming)
+		TIMING = true;
+	else
+		TIMING = false;
+
+	// test if out of order
+	if(p > 2) {
+		std::cout << "Wrong plane ID!" << std::endl;
+		throw ExcWrongPlaneID();
+	}
+
+	// plain, arithmetic or zero-run coded bitstream
+	bool arith = dt_.hdr_.version == (T::version | ARITH_VERSION);
+	bool runs = dt_.hdr_.version == (T::version | SPIHT_RUN_VERSION);
+	dt_.DataGroupCheck(arith ? (T::version | ARITH_VERSION) : runs ? (T::version | SPIHT_RUN_VERSION) : T::version, 3);
+
+	// ref to bitstream: is now bs
+	ColorCodec::DataGroup::BitStream& bs = dt_.bs_[p];
+
+	// check if this bs is OK, deal with bitsize
+	bitCount bitCnt = bs.checkSettings(sets, bits);
+
+	bool wide = wideCoords(image.getWidth(), image.getHeight());
+	bool done;
+	if(arith)
+		done = wide ? decodePlane(wideArithEngine_, p, false) : decodePlane(arithEngine_, p, false);
+	else
+		done = wide ? decodePlane(wideEngine_, p, runs) : decodePlane(engine_, p, runs);
+	if(done && EXTENDED)
+		std::cout << name_ << " decoding done. " << bitCnt << " bits (" << std::setprecision(1) << std::fixed
+			  << (double) bitCnt/8.0 << "B) from bitstream have been processed." << std::endl;
+}
+
+// decode plane p on given engine
+template <class T, template <class> class S>
+template <class E>
+bool SpihtCoder<T,S>::decodePlane(E &engine, planeVal p, bool runs) {
+	ColorCodec::DataGroup::BitStream& bs = dt_.bs_[p];
+
+	// timer ON
+	TraceTimer timer("init", p);
+
+	// init lists, empty coefficients
+	engine.startDecode(image.getWidth(), image.getHeight(), p, bandSizeW_, bandSizeH_, bs.getMaxSteps(), runs, workers_);
+
+	// timer OFF
+	elapsedTime_ += timer.stop();
+
+	if(TIMING)
+		std::cout << std::fixed << std::setprecision(8) << "Elapsed time on init = " << timer.seconds() << std::endl;
+
+	if(EXTENDED)
+		std::cout << name_ << " decoder enabled. Decoding plane " << p << "." << std::endl;
+
+	// main loop
+	bool done = decodeStream(engine, bs, EXTENDED, elapsedTime_, &stats_.planes[p]);
+
+	// back to the image plane at once
+	engine.finishDecode(image);
+
+	return done;
+}
+
+#endif
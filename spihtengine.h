@@ -0,0 +1,1203 @@
+// spihtengine: SPIHT sorting and refinement passes, written once
+// specialized at compile time by the policies of spihtpolicy.h
+#ifndef SPIHTENGINE_H
+#define SPIHTENGINE_H
+
+#include "general.h"
+#include "image.h"
+#include "colorcodec.h"
+#include "quantimage.h"
+#include "bitslice.h"
+#include "spihtpolicy.h"
+#include "arena.h"
+#include "workerpool.h"
+#include "arithstream.h"
+#include "codecstats.h"
+#include "listcache.h"
+#include "subbands.h"
+#include <list>
+#include <vector>
+#include <algorithm>
+#include <type_traits>
+#include <iostream>
+#include <iomanip>
+#include "trace.h"
+#include "perfcounters.h"
+
+// LIS entries per task of the speculative evaluation
+#define SPIHT_SPEC_CHUNK 512
+// LSP entries per task of the parallel refinement pass (multiple of 64)
+#define SPIHT_REFINE_CHUNK 8192
+// added to the coder version byte of zero-run coded bitstreams
+#define SPIHT_RUN_VERSION 0x04
+// zero-run codes: longest unary part (then the run follows in 32 bits, 64 if the lists may pass 2^32 entries),
+// start & max Rice parameter
+#define SPIHT_RUN_QMAX 24
+#define SPIHT_RUN_K 2
+#define SPIHT_RUN_KMAX 24
+
+// kinds of coded symbols, entropy coded sinks keep separate contexts for each
+// (16 per kind: subband level x neighbourhood state, see SpihtEngine::context())
+enum SymbolKind { symLip = 0, symChild, symSetA, symSetB, symSign, symRefine };
+
+// class SpihtEngine
+// holds the coding state (lists, integer coefficients, threshold) of one run
+// and performs the passes over it
+// Topology: tree policy (RegularTree, DegradedTree, CrossPlaneTree, WideTree of them), brings the coefficient policy
+// Storage: LIP / LSP storage policy (ListStorage, ArrayStorage)
+// Sink: plain bitstream (put, putBits, get, performClose, markPass, finished, bit positions)
+//       or entropy coded one (put & get with a context, positional = false)
+template <class Topology, template <class> class Storage = ListStorage, class Sink = ColorCodec::DataGroup::BitStream>
+class SpihtEngine {
+public:
+	typedef typename Topology::Coef Coef;
+	typedef typename Coef::Node Node;
+	typedef typename Coef::Set Set;
+	typedef Storage<Node> Store;
+	typedef typename Store::List NodeList;
+	typedef std::list<Set, ArenaAllocator<Set> > SetList;
+	// sink addresses bits directly (word-parallel & chunked passes)
+	typedef std::integral_constant<bool, Sink::positional> Positional;
+
+	// geometry of the coded planes
+	unsigned width_;
+	unsigned height_;
+	unsigned bandSizeW_;
+	unsigned bandSizeH_;
+	Subbands subbands_;		// their bands & tree families (any size)
+	planeVal plane_;		// plane of the run (single plane coefficients)
+
+	QuantImage coefs_;		// integer coefficients of the coded planes
+	BitSlices slices_;		// their bitplanes (word-parallel passes)
+
+	// on-the-fly properties
+	int		 n_;			// current step
+	unsigned nMax_;			// max steps
+	qUnit currThr_;			// current threshold (2^n_)
+	bool decodingOver_;		// flag for decoding is over
+	bool sliced_;			// encoder uses the word-parallel passes
+	unsigned magShift_;		// fractional bits of the magnitudes (decoder)
+	bool runs_;				// zero-run coding of LIP & LIS significance
+	unsigned runK_[2];		// Rice parameters of LIP & LIS runs
+	unsigned runBits_;		// bits of a run after the longest unary part
+
+	// lists
+	SetList LIS_;
+	NodeList LIP_;
+	NodeList LSP_;
+	// pass-of-significance index: LSP length at the start of each sorting pass,
+	// entries of pass k are LSP_[passStart_[k] .. passStart_[k+1])
+	std::vector<size_t> passStart_;
+
+	// threads evaluating LIS ahead of the output (encoding) & running the refinement passes, 0 = serial
+	WorkerPool *workers_;
+	std::vector<const Set*> specSets_;	// LIS entries of the current wave
+	std::vector<unsigned> spec_;		// their results, see evaluate()
+	// refinement chunks: first LSP entry & end index of each
+	std::vector<typename NodeList::iterator> chunkFrom_;
+	std::vector<size_t> chunkEnd_;
+
+	// record of the current step; list sizes, scan tally & arena use at its start
+	Arena *arena_;
+	PassStats pass_;
+	size_t passLists_;
+	ScanTally passTally_;
+	size_t passBytes_;
+	std::vector<ScanTally> specTally_;	// tests of the speculation tasks
+
+	// constructor
+	// arena: optional job memory for lists and coefficients
+	explicit SpihtEngine(Arena *arena = 0);
+
+	// encoder: lists, integer coefficients & steps of the planes of a run started on plane p
+	// runs: zero-run coding (plain bitstreams), workers: optional threads for the sorting & refinement passes
+	void startEncode(const Image &image, planeVal p, unsigned bandW, unsigned bandH, bool sliced, bool runs, WorkerPool *workers = 0);
+	// decoder: lists & empty coefficients for nMax steps
+	// runs: zero-run coded bitstream, workers: optional threads for the refinement pass
+	void startDecode(unsigned width, unsigned height, planeVal p, unsigned bandW, unsigned bandH, unsigned nMax, bool runs, WorkerPool *workers = 0);
+	// decoder: write the coefficients back into the image planes
+	void finishDecode(Image &image) const;
+	// encoder: coefficients of the run not needed any more
+	void finishEncode() const;
+
+	// encoder main loop, true if bitstream got finished
+	// elapsed time of the passes is added to elapsed, work counters of each step to stats (if given)
+	bool encodeSteps(Sink &bs, bool extended, double &elapsed, std::vector<PassStats> *stats = 0);
+	// decoder main loop, true if bitstream got exhausted
+	bool decodeSteps(Sink &bs, bool extended, double &elapsed, std::vector<PassStats> *stats = 0);
+
+	// (encoding) does a sorting pass, output enabled, returns number of bits outputted
+	bitCount sortingPassC(Sink &bs);
+	// (encoding) does a refinement pass, output enabled, returns number of bits outputted
+	bitCount refinementPassC(Sink &bs);
+	// (decoding) does a sorting pass, returns number of bits processed
+	bitCount sortingPassD(Sink &bs);
+	// (decoding) does a refinement pass, returns number of bits processed
+	bitCount refinementPassD(Sink &bs);
+
+	// tree significance searcher from family f of direct offspring down - see implementation
+	bool descend(Family f, planeVal P, bool startNow) const;
+
+private:
+	// (encoding) significance of LIS entries from it on, evaluated in parallel into spec_, returns their count
+	size_t speculate(typename SetList::iterator it);
+	// (encoding) significance of set s (bit 0) and of its direct offspring i (bit i+1, typeA only)
+	unsigned evaluate(const Set &s) const;
+	// (encoding) word-parallel LIP part of sorting pass, false if bitstream full
+	bool lipPassW(Sink &bs, bitCount &bitsOut, std::true_type);
+	// (encoding) word-parallel refinement pass, returns number of bits outputted
+	bitCount refinementPassW(Sink &bs, std::true_type);
+	// (encoding) refinement pass in chunks on the workers, returns number of bits outputted
+	bitCount refinementPassPC(Sink &bs, std::true_type);
+	// (decoding) refinement pass in chunks on the workers, returns number of bits processed
+	bitCount refinementPassPD(Sink &bs, std::true_type);
+	// (encoding) zero-run coded LIP part of sorting pass, false if bitstream full
+	bool lipPassZC(Sink &bs, bitCount &bitsOut, std::true_type);
+	// (decoding) zero-run coded LIP part of sorting pass, false if bitstream exhausted
+	bool lipPassZD(Sink &bs, bitCount &bitsOut, std::true_type);
+	// (encoding) run of r insignificant entries, Rice parameter k, false if bitstream full
+	bool putRun(Sink &bs, size_t r, unsigned &k, bitCount &bitsOut, std::true_type);
+	// (decoding) run of at most left insignificant entries into r, false if bitstream exhausted (or bad run)
+	bool getRun(Sink &bs, size_t &r, size_t left, unsigned &k, bitCount &bitsOut, std::true_type);
+	// entropy coded sinks have no bit positions, the passes above are never taken
+	bool lipPassW(Sink &, bitCount &, std::false_type) { return false; }
+	bool lipPassZC(Sink &, bitCount &, std::false_type) { return false; }
+	bool lipPassZD(Sink &, bitCount &, std::false_type) { return false; }
+	bool putRun(Sink &, size_t, unsigned &, bitCount &, std::false_type) { return false; }
+	bool getRun(Sink &, size_t &, size_t, unsigned &, bitCount &, std::false_type) { return false; }
+	bitCount refinementPassW(Sink &, std::false_type) { return 0; }
+	bitCount refinementPassPC(Sink &, std::false_type) { return 0; }
+	bitCount refinementPassPD(Sink &, std::false_type) { return 0; }
+	// split count LSP entries coded from bit position start into chunks, returns their number
+	unsigned refinementChunks(size_t count, bitCount start);
+	// clear lists & make initial ones
+	void initLists();
+	// record of a step: start, end (bits of the passes, their time, bitstream over) appended to stats
+	void beginPass();
+	const PassStats& endPass(std::vector<PassStats> *stats, bitCount sout, bitCount rout, double seconds, bool finished);
+
+	// symbol output / input about node or set n: plain bitstreams take the bit,
+	// entropy coded sinks its context as well
+	template <class N> inline bool putSymbol(Sink &bs, bool bit, unsigned kind, const N &n) {
+		return putSymbol(bs, bit, kind, n, Positional());
+	}
+	template <class N> inline unsigned char getSymbol(Sink &bs, unsigned kind, const N &n) {
+		return getSymbol(bs, kind, n, Positional());
+	}
+	template <class N> inline bool putSymbol(Sink &bs, bool bit, unsigned, const N &, std::true_type) { return bs.put(bit); }
+	template <class N> inline bool putSymbol(Sink &bs, bool bit, unsigned kind, const N &n, std::false_type) { return bs.put(bit, context(kind, n)); }
+	template <class N> inline unsigned char getSymbol(Sink &bs, unsigned, const N &, std::true_type) { return bs.get(); }
+	template <class N> inline unsigned char getSymbol(Sink &bs, unsigned kind, const N &n, std::false_type) { return bs.get(context(kind, n)); }
+	// context of a symbol of given kind about node or set n
+	template <class N> unsigned context(unsigned kind, const N &n) const;
+
+	// access to coefficients of nodes
+	inline planeVal planeOf(const Node &n) const { return Coef::plane(n, plane_); }
+	inline qUnit& mag(const Node &n) { return coefs_(n.X, n.Y, planeOf(n)); }
+	inline qUnit mag(const Node &n) const { return coefs_(n.X, n.Y, planeOf(n)); }
+	inline bool isNegative(const Node &n) const { return coefs_.isNegative(n.X, n.Y, planeOf(n)); }
+
+	// not copyable
+	SpihtEngine(const SpihtEngine&);
+	SpihtEngine& operator= (const SpihtEngine&);
+};
+
+// ----------- implementation
+
+// constructor
+template <class T, template <class> class S, class K>
+SpihtEngine<T,S,K>::SpihtEngine(Arena *arena)
+	: width_(0), height_(0), bandSizeW_(0), bandSizeH_(0), plane_(y), n_(0), nMax_(0), currThr_(0),
+	  decodingOver_(false), sliced_(false), magShift_(0), runs_(false), runBits_(32),
+	  LIS_(ArenaAllocator<Set>(arena)), LIP_(ArenaAllocator<Node>(arena)), LSP_(ArenaAllocator<Node>(arena)), workers_(0),
+	  arena_(arena), passLists_(0), passBytes_(0) {
+	coefs_.setArena(arena);
+	slices_.setArena(arena);
+}
+
+// clear lists & make initial ones
+template <class T, template <class> class S, class K>
+void SpihtEngine<T,S,K>::initLists() {
+	// delete all lists
+	LIS_.clear();
+	LSP_.clear();
+	LIP_.clear();
+	passStart_.clear();
+
+	// capacity of every coefficient of the coded planes (fixed storage)
+	size_t nodes = (size_t) width_ * height_ * (Coef::lastPlane(plane_) - Coef::firstPlane(plane_) + 1);
+	Store::reserve(LIP_, nodes);
+	Store::reserve(LSP_, nodes);
+	runBits_ = (nodes > 0xFFFFFFFFu) ? 64 : 32;
+
+	// built by the topology on the first run of this geometry, copied on the next ones
+	typename ListCache<T>::Entry lists = ListCache<T>::find(width_, height_, bandSizeW_, bandSizeH_);
+	if(lists) {
+		LIP_.insert(LIP_.end(), lists->lip.begin(), lists->lip.end());
+		LIS_.insert(LIS_.end(), lists->lis.begin(), lists->lis.end());
+	} else {
+		T::initLists(*this);
+		ListCache<T>::store(width_, height_, bandSizeW_, bandSizeH_, LIP_, LIS_);
+	}
+}
+
+// encoder: lists, integer coefficients & steps
+template <class T, template <class> class S, class K>
+void SpihtEngine<T,S,K>::startEncode(const Image &image, planeVal p, unsigned bandW, unsigned bandH, bool sliced, bool runs, WorkerPool *workers) {
+	workers_ = workers;
+	width_ = image.getWidth();
+	height_ = image.getHeight();
+	bandSizeW_ = bandW;
+	bandSizeH_ = bandH;
+	subbands_.set(width_, height_, bandW, bandH);
+	plane_ = p;
+
+	// init lists
+	initLists();
+
+	// integer magnitudes & signs, done once for all passes; get nMax
+	qUnit max = 0;
+	for(unsigned q = Coef::firstPlane(p); q <= Coef::lastPlane(p); ++q) {
+		coefs_.quantize(image, (planeVal) q);
+		max = std::max(max, coefs_.getMax(q));
+	}
+	nMax_ = highestBit(max);
+
+	// bitplanes for the word-parallel passes
+	sliced_ = sliced && K::positional;
+	magShift_ = 0;
+	runs_ = runs && K::positional;
+	runK_[0] = runK_[1] = SPIHT_RUN_K;
+	if(sliced_)
+		for(unsigned q = Coef::firstPlane(p); q <= Coef::lastPlane(p); ++q)
+			slices_.build(coefs_, (planeVal) q, width_, height_, nMax_);
+
+	// init params
+	n_ = nMax_;
+	currThr_ = 1 << nMax_;
+}
+
+// decoder: lists & empty coefficients
+template <class T, template <class> class S, class K>
+void SpihtEngine<T,S,K>::startDecode(unsigned width, unsigned height, planeVal p, unsigned bandW, unsigned bandH, unsigned nMax, bool runs, WorkerPool *workers) {
+	workers_ = workers;
+	width_ = width;
+	height_ = height;
+	bandSizeW_ = bandW;
+	bandSizeH_ = bandH;
+	subbands_.set(width_, height_, bandW, bandH);
+	plane_ = p;
+
+	// init lists
+	initLists();
+	for(unsigned q = Coef::firstPlane(p); q <= Coef::lastPlane(p); ++q)
+		coefs_.clear((planeVal) q, width_, height_);
+
+	// init params
+	nMax_ = nMax;
+	n_ = nMax_;
+	decodingOver_ = false;
+	sliced_ = false;
+	magShift_ = QUANT_FRACBITS;
+	runs_ = runs && K::positional;
+	runK_[0] = runK_[1] = SPIHT_RUN_K;
+	currThr_ = 1 << nMax_;
+}
+
+// decoder: back to the image planes at once
+template <class T, template <class> class S, class K>
+void SpihtEngine<T,S,K>::finishDecode(Image &image) const {
+	for(unsigned q = Coef::firstPlane(plane_); q <= Coef::lastPlane(plane_); ++q) {
+		coefs_.dequantize(image, (planeVal) q);
+		coefs_.discard((planeVal) q);
+	}
+}
+
+// encoder: drop the coefficients (mapped planes aren't written back)
+template <class T, template <class> class S, class K>
+void SpihtEngine<T,S,K>::finishEncode() const {
+	for(unsigned q = Coef::firstPlane(plane_); q <= Coef::lastPlane(plane_); ++q)
+		coefs_.discard((planeVal) q);
+}
+
+// record of a step: list sizes, scan tally & arena use at its start
+template <class T, template <class> class S, class K>
+void SpihtEngine<T,S,K>::beginPass() {
+	pass_.clear();
+#if !defined(SPIHT_NO_STATS)
+	passLists_ = LIP_.size() + LIS_.size() + LSP_.size();
+	passTally_ = scanTally();
+	passBytes_ = arena_ ? arena_->getAllocated() : 0;
+#endif
+}
+
+// record of a step: output, list sizes & differences of the counters over it
+// every entry erased from a list (LIP moves, split LIS entries) was counted, the rest of the growth are insertions
+template <class T, template <class> class S, class K>
+const PassStats& SpihtEngine<T,S,K>::endPass(std::vector<PassStats> *stats, bitCount sout, bitCount rout, double seconds, bool finished) {
+	pass_.step = nMax_ - n_ + 1;
+	pass_.finished = finished;
+	pass_.sortingBits = sout;
+	pass_.refinementBits = rout;
+	pass_.lisSize = LIS_.size();
+	pass_.lipSize = LIP_.size();
+	pass_.lspSize = LSP_.size();
+	pass_.seconds = seconds;
+#if !defined(SPIHT_NO_STATS)
+	const ScanTally &tally = scanTally();
+	pass_.lspRefined = rout;
+	pass_.maxTests += tally.tests - passTally_.tests;
+	pass_.coefsScanned += tally.coefs - passTally_.coefs;
+	pass_.erasures += pass_.expandedA + pass_.expandedB;
+	pass_.insertions = LIP_.size() + LIS_.size() + LSP_.size() + pass_.erasures - passLists_;
+	pass_.bytesAllocated = arena_ ? arena_->getAllocated() - passBytes_ : 0;
+#endif
+	if(stats)
+		stats->push_back(pass_);
+	return pass_;
+}
+
+// encoder main loop
+template <class T, template <class> class S, class K>
+bool SpihtEngine<T,S,K>::encodeSteps(K &bs, bool extended, double &elapsed, std::vector<PassStats> *stats) {
+	while(n_ >= 0) {
+		// timer ON
+		TraceTimer timer("step", n_);
+		beginPass();
+
+		bitCount sout, rout;
+		{
+			TraceSpan span("sorting pass", n_);
+			PerfSpan counters("encoder sorting pass", n_);
+			sout = sortingPassC(bs);
+		}
+		{
+			TraceSpan span("refinement pass", n_);
+			PerfSpan counters("encoder refinement pass", n_);
+			rout = refinementPassC(bs);
+		}
+
+		// timer OFF
+		double seconds = timer.stop();
+		elapsed += seconds;
+
+		const PassStats &pass = endPass(stats, sout, rout, seconds, bs.finished);
+		if(extended)
+			pass.print(true);
+
+		// pass boundary for pass-interleaved files
+		bs.markPass();
+
+		// possible ending - lossless
+		if(n_ == 0) {
+			bs.performClose();
+		}
+
+		// detect possible ending
+		if(bs.finished)
+			return true;
+
+		n_--; currThr_ >>= 1;
+	}
+
+	return false;
+}
+
+// decoder main loop
+template <class T, template <class> class S, class K>
+bool SpihtEngine<T,S,K>::decodeSteps(K &bs, bool extended, double &elapsed, std::vector<PassStats> *stats) {
+	while(n_ >= 0) {
+		// timer ON
+		TraceTimer timer("step", n_);
+		beginPass();
+
+		bitCount sout, rout;
+		{
+			TraceSpan span("sorting pass", n_);
+			PerfSpan counters("decoder sorting pass", n_);
+			sout = sortingPassD(bs);
+		}
+		{
+			TraceSpan span("refinement pass", n_);
+			PerfSpan counters("decoder refinement pass", n_);
+			rout = refinementPassD(bs);
+		}
+
+		// timer OFF
+		double seconds = timer.stop();
+		elapsed += seconds;
+
+		const PassStats &pass = endPass(stats, sout, rout, seconds, decodingOver_);
+		if(extended)
+			pass.print(true);
+
+		// possible ending - lossless
+		if(n_ == 0) {
+			bs.performClose();
+		}
+
+		// detect possible ending
+		if(decodingOver_)
+			return true;
+
+		n_--; currThr_ >>= 1;
+	}
+
+	return false;
+}
+
+// coding: does a sorting pass, output enabled, returns number of bits outputted
+template <class T, template <class> class S, class K>
+bitCount SpihtEngine<T,S,K>::sortingPassC(K &bs) {
+	bitCount bitsOut = 0;
+	// everything in LSP by now is refined in this pass
+	passStart_.push_back(LSP_.size());
+
+	// part 1: LIP processing
+	if(runs_) {
+		// zero-run coded variant
+		if(!lipPassZC(bs, bitsOut, Positional())) return bitsOut;
+	} else if(sliced_) {
+		// word-parallel variant
+		if(!lipPassW(bs, bitsOut, Positional())) return bitsOut;
+	} else {
+		typename Store::Sweep LIPit(LIP_);
+		while(!LIPit.done()) {
+			Node curr = *LIPit;
+			CODER_COUNT(pass_.lipVisits, 1);
+			// check for significance
+			if(mag(curr) >= currThr_) {
+				// output 1
+				if(!putSymbol(bs, 1, symLip, curr)) { LIPit.close(); return bitsOut; } else bitsOut++;
+				// output sign
+				if(!putSymbol(bs, !isNegative(curr), symSign, curr)) { LIPit.close(); return bitsOut; } else bitsOut++;
+				// move into LSP
+				LSP_.push_back(curr);
+				LIPit.drop();
+				CODER_COUNT(pass_.erasures, 1);
+			} else {
+				// output 0
+				if(!putSymbol(bs, 0, symLip, curr)) { LIPit.close(); return bitsOut; } else bitsOut++;
+				LIPit.keep();
+			}
+		}
+		LIPit.close();
+	}
+
+	// part 2: LIS processing
+	// with workers, significance is evaluated ahead for all entries up to the list end (a wave),
+	// the loop below only replays it in list order, writing bits & editing lists;
+	// entries appended meanwhile form the next wave
+	size_t wave = 0;
+	unsigned spec = 0;
+	size_t zeros = 0;		// (zero-run coding) insignificant sets since the last significant one
+	typename SetList::iterator LISit = LIS_.begin();
+	while(LISit != LIS_.end()) {
+		// backup iterator: fetch current item into it, move to the next
+		typename SetList::iterator LIScurr = LISit;
+
+		if(workers_) {
+			if(wave == 0)
+				wave = speculate(LISit);
+			spec = spec_[spec_.size() - wave--];
+		}
+
+		unsigned setKind = LIScurr->T == typeA ? symSetA : symSetB;
+		CODER_COUNT(pass_.lisVisits, 1);
+
+		// check significance
+		if(workers_ ? (spec & 1) != 0 : T::significant(*this, *LIScurr)) {
+			// output 1 / the run of zeros ended by this set
+			if(runs_) {
+				if(!putRun(bs, zeros, runK_[1], bitsOut, Positional())) return bitsOut;
+				zeros = 0;
+			} else {
+				if(!putSymbol(bs, 1, setKind, *LIScurr)) return bitsOut; else bitsOut++;
+			}
+
+			// direct offspring, split: which of them are partitioned (typeB)
+			Node child[SUBBANDS_MAX_OFFSPRING];
+			unsigned split;
+			unsigned count = T::offspring(*this, *LIScurr, child, split);
+
+			for(unsigned i = 0; i < count; ++i) {
+				// process typeA
+				if(LIScurr->T == typeA) {
+					// test for significance (single-element)
+					if(workers_ ? ((spec >> (i+1)) & 1) != 0 : mag(child[i]) >= currThr_) {
+						// output 1
+						if(!putSymbol(bs, 1, symChild, child[i])) return bitsOut; else bitsOut++;
+						// output sign
+						if(!putSymbol(bs, !isNegative(child[i]), symSign, child[i])) return bitsOut; else bitsOut++;
+						// move into LSP
+						LSP_.push_back(child[i]);
+					} else {
+						// output 0
+						if(!putSymbol(bs, 0, symChild, child[i])) return bitsOut; else bitsOut++;
+						// move to LIP
+						LIP_.push_back(child[i]);
+					}
+
+				// process typeB
+				} else if(split & (1 << i)) {
+					// partitioning
+					LIS_.push_back(Coef::set(child[i], typeA));
+				}
+			}
+
+			// possible typeB entry creation
+			if(LIScurr->T == typeA) {
+				// check if image allows more descendants
+				if(subbands_.hasOffspring(child[count-1].X, child[count-1].Y)) {
+					// put into LIS as entry type B
+					LIS_.push_back(Coef::set(*LIScurr, typeB));
+				}
+			}
+
+			// partitioning done, discard LIS entry
+			// IMPORTANT / iterate before discard (new ones might be added)
+			CODER_COUNT(setKind == symSetA ? pass_.expandedA : pass_.expandedB, 1);
+			LISit++;
+			LIS_.erase(LIScurr);
+
+		} else {
+			// output 0 / count it into the run
+			if(runs_)
+				zeros++;
+			else if(!putSymbol(bs, 0, setKind, *LIScurr)) return bitsOut; else bitsOut++;
+			LISit++;
+		}
+	}
+
+	// run of zeros up to the list end
+	if(zeros > 0)
+		putRun(bs, zeros, runK_[1], bitsOut, Positional());
+
+	return bitsOut;
+}
+
+// coding: significance of LIS entries from it to the list end, evaluated by the workers
+// results depend only on the coefficients and the threshold, not on the output order
+template <class T, template <class> class S, class K>
+size_t SpihtEngine<T,S,K>::speculate(typename SetList::iterator it) {
+	// entries stay in place until processed, appending does not move them
+	specSets_.clear();
+	for(; it != LIS_.end(); ++it)
+		specSets_.push_back(&*it);
+
+	size_t count = specSets_.size();
+	spec_.resize(count);
+
+	unsigned tasks = (unsigned) ((count + SPIHT_SPEC_CHUNK - 1) / SPIHT_SPEC_CHUNK);
+	specTally_.resize(tasks);
+	workers_->run(tasks, [this, count](unsigned t) {
+		// tests of the task go to its own slot, not to the tally of the thread running it
+		ScanTally &tally = scanTally();
+		ScanTally before = tally;
+		size_t end = std::min(count, (size_t) (t+1) * SPIHT_SPEC_CHUNK);
+		for(size_t i = (size_t) t * SPIHT_SPEC_CHUNK; i < end; ++i)
+			spec_[i] = evaluate(*specSets_[i]);
+		specTally_[t].tests = tally.tests - before.tests;
+		specTally_[t].coefs = tally.coefs - before.coefs;
+		tally = before;
+	});
+	for(unsigned t = 0; t < tasks; ++t) {
+		CODER_COUNT(pass_.maxTests, specTally_[t].tests);
+		CODER_COUNT(pass_.coefsScanned, specTally_[t].coefs);
+	}
+
+	return count;
+}
+
+// coding: significance of a set and of its direct offspring
+template <class T, template <class> class S, class K>
+unsigned SpihtEngine<T,S,K>::evaluate(const Set &s) const {
+	if(!T::significant(*this, s))
+		return 0;
+
+	unsigned result = 1;
+	if(s.T == typeA) {
+		Node child[SUBBANDS_MAX_OFFSPRING];
+		unsigned split;
+		unsigned count = T::offspring(*this, s, child, split);
+		for(unsigned i = 0; i < count; ++i)
+			if(mag(child[i]) >= currThr_)
+				result |= 2 << i;
+	}
+
+	return result;
+}
+
+// context of a symbol: kind, subband level & what the decoder already knows around n
+// - significance of a node: other members of its 2x2 quad group significant in earlier passes
+// - significance of a set: its root significant in earlier passes
+// - refinement: first refinement of the coefficient or a later one
+// a coefficient is significant since an earlier pass if its magnitude reaches twice the threshold,
+// both at the encoder (exact magnitude) and at the decoder (reconstructed one)
+template <class T, template <class> class S, class K>
+template <class N>
+unsigned SpihtEngine<T,S,K>::context(unsigned kind, const N &n) const {
+	planeVal p = Coef::plane(n, plane_);
+	unsigned shift = n_ + 1 + magShift_;
+
+	// subband level: 0 = top band, then from the coarsest level on (3 = the finer ones)
+	unsigned band = std::max(n.X / bandSizeW_, n.Y / bandSizeH_);
+	unsigned level = band ? std::min(3u, highestBit(band) + 1) : 0;
+
+	unsigned state = 0;
+	switch(kind) {
+		case symLip:
+		case symChild: {
+			unsigned qx = n.X & ~1u, qy = n.Y & ~1u;
+			for(unsigned j = qy; j < qy + 2 && j < height_; ++j)
+				for(unsigned i = qx; i < qx + 2 && i < width_; ++i)
+					if((i != n.X || j != n.Y) && (coefs_(i, j, p) >> shift) != 0)
+						state++;
+			break;
+		}
+		case symSetA:
+		case symSetB:
+			state = (coefs_(n.X, n.Y, p) >> shift) != 0;
+			break;
+		case symRefine:
+			state = (coefs_(n.X, n.Y, p) >> (shift + 1)) == 0;
+			break;
+	}
+
+	return kind * 16 + level * 4 + state;
+}
+
+// coding: does a refinement pass, output enabled, returns number of bits outputted
+template <class T, template <class> class S, class K>
+bitCount SpihtEngine<T,S,K>::refinementPassC(K &bs) {
+	// chunks on the workers
+	if(K::positional && workers_ && passStart_.back() >= 2*SPIHT_REFINE_CHUNK)
+		return refinementPassPC(bs, Positional());
+
+	// word-parallel variant
+	if(sliced_)
+		return refinementPassW(bs, Positional());
+
+	bitCount bitsOut = 0;
+	size_t lspOld = passStart_.back();
+	// LSP processing
+	typename NodeList::iterator LSPit = LSP_.begin();
+
+	// entries of previous passes: output bit n of the magnitude
+	for(size_t i = 0; i < lspOld; ++i, ++LSPit) {
+		if(!putSymbol(bs, (mag(*LSPit) >> n_) & 1, symRefine, *LSPit)) return bitsOut; else bitsOut++;
+	}
+
+	return bitsOut;
+}
+
+// coding: word-parallel LIP part of the sorting pass (bit-sliced), same output as the scalar loop
+// LIP entries were insignificant at 2^(n+1), so their significance is bit n of the magnitude
+// adds bits outputted to bitsOut, returns false if the bitstream got full
+template <class T, template <class> class S, class K>
+bool SpihtEngine<T,S,K>::lipPassW(K &bs, bitCount &bitsOut, std::true_type) {
+	typename Store::Sweep LIPit(LIP_);
+
+	while(!LIPit.done()) {
+		// gather significance of the next run of up to 64 entries
+		Node run[64];
+		unsigned count = LIPit.peek(run, 64);
+		CODER_COUNT(pass_.lipVisits, count);
+		uint64_t sig = 0;
+		for(unsigned k = 0; k < count; ++k)
+			sig |= (uint64_t) slices_.test(run[k].X, run[k].Y, planeOf(run[k]), n_) << k;
+
+		// zeros in bulk, 1 + sign for each significant entry
+		unsigned pos = 0;
+		unsigned out;
+		while(sig) {
+			unsigned k = lowestBit64(sig);
+			sig &= sig - 1;
+
+			out = bs.putBits(0, k - pos);
+			bitsOut += out;
+			LIPit.keep(out);
+			if(out < k - pos) { LIPit.close(); return false; }
+
+			out = bs.putBits(isNegative(run[k]) ? 1 : 3, 2);
+			bitsOut += out;
+			if(out < 2) { LIPit.close(); return false; }
+
+			// move into LSP
+			LSP_.push_back(run[k]);
+			LIPit.drop();
+			CODER_COUNT(pass_.erasures, 1);
+			pos = k + 1;
+		}
+
+		out = bs.putBits(0, count - pos);
+		bitsOut += out;
+		LIPit.keep(out);
+		if(out < count - pos) { LIPit.close(); return false; }
+	}
+
+	LIPit.close();
+	return true;
+}
+
+// coding: zero-run coded LIP part of sorting pass
+// significance of 64 entries at once (bitplanes when sliced, magnitudes otherwise),
+// insignificant ones are only counted, every significant one gets the run before it & its sign
+template <class T, template <class> class S, class K>
+bool SpihtEngine<T,S,K>::lipPassZC(K &bs, bitCount &bitsOut, std::true_type) {
+	typename Store::Sweep LIPit(LIP_);
+	size_t zeros = 0;
+
+	while(!LIPit.done()) {
+		Node run[64];
+		unsigned count = LIPit.peek(run, 64);
+		CODER_COUNT(pass_.lipVisits, count);
+		uint64_t sig = 0;
+		for(unsigned k = 0; k < count; ++k)
+			if(sliced_ ? slices_.test(run[k].X, run[k].Y, planeOf(run[k]), n_) : mag(run[k]) >= currThr_)
+				sig |= (uint64_t) 1 << k;
+
+		unsigned pos = 0;
+		while(sig) {
+			unsigned k = lowestBit64(sig);
+			sig &= sig - 1;
+
+			zeros += k - pos;
+			LIPit.keep(k - pos);
+			if(!putRun(bs, zeros, runK_[0], bitsOut, Positional())) { LIPit.close(); return false; }
+			zeros = 0;
+			// output sign
+			if(!bs.put(!isNegative(run[k]))) { LIPit.close(); return false; } else bitsOut++;
+
+			// move into LSP
+			LSP_.push_back(run[k]);
+			LIPit.drop();
+			CODER_COUNT(pass_.erasures, 1);
+			pos = k + 1;
+		}
+
+		zeros += count - pos;
+		LIPit.keep(count - pos);
+	}
+	LIPit.close();
+
+	// run of zeros up to the list end
+	if(zeros > 0 && !putRun(bs, zeros, runK_[0], bitsOut, Positional()))
+		return false;
+
+	return true;
+}
+
+// decoding: zero-run coded LIP part of sorting pass
+// a run keeps its entries at once, the entry ending it is significant
+template <class T, template <class> class S, class K>
+bool SpihtEngine<T,S,K>::lipPassZD(K &bs, bitCount &bitsOut, std::true_type) {
+	typename Store::Sweep LIPit(LIP_);
+	size_t left = LIP_.size();
+
+	while(left > 0) {
+		size_t r;
+		if(!getRun(bs, r, left, runK_[0], bitsOut, Positional())) { LIPit.close(); return false; }
+		LIPit.keep(r);
+		left -= r;
+		CODER_COUNT(pass_.lipVisits, r);
+		if(left == 0)
+			break;
+		CODER_COUNT(pass_.lipVisits, 1);
+
+		// get sign
+		Node curr = *LIPit;
+		signed char getBit;
+		if((getBit = bs.get()) == -1) { LIPit.close(); return false; }
+		bitsOut++;
+		// 1.5 * threshold, sign according to bit
+		mag(curr) = (3 << n_) << (QUANT_FRACBITS - 1);
+		coefs_.setNegative(curr.X, curr.Y, planeOf(curr), getBit != 1);
+
+		// move into LSP
+		LSP_.push_back(curr);
+		LIPit.drop();
+		CODER_COUNT(pass_.erasures, 1);
+		left--;
+	}
+	LIPit.close();
+
+	return true;
+}
+
+// coding: run length r as adaptive Rice code - unary r >> k (ones, then a zero), low k bits of r;
+// unary parts reaching SPIHT_RUN_QMAX are followed by r in runBits_ bits instead,
+// k grows after long quotients and shrinks after zero ones
+template <class T, template <class> class S, class K>
+bool SpihtEngine<T,S,K>::putRun(K &bs, size_t r, unsigned &k, bitCount &bitsOut, std::true_type) {
+	size_t q = r >> k;
+	unsigned out;
+
+	if(q < SPIHT_RUN_QMAX) {
+		out = bs.putBits(((uint64_t) 1 << q) - 1, (unsigned) q + 1);
+		bitsOut += out;
+		if(out < q + 1) return false;
+		out = bs.putBits(r & ((1u << k) - 1), k);
+		bitsOut += out;
+		if(out < k) return false;
+	} else {
+		out = bs.putBits(((uint64_t) 1 << SPIHT_RUN_QMAX) - 1, SPIHT_RUN_QMAX);
+		bitsOut += out;
+		if(out < SPIHT_RUN_QMAX) return false;
+		out = bs.putBits(r, runBits_);
+		bitsOut += out;
+		if(out < runBits_) return false;
+	}
+
+	if(q == 0) {
+		if(k > 0) k--;
+	} else if(q > 1 && k < SPIHT_RUN_KMAX) {
+		k++;
+	}
+	return true;
+}
+
+// decoding: run length, see putRun
+template <class T, template <class> class S, class K>
+bool SpihtEngine<T,S,K>::getRun(K &bs, size_t &r, size_t left, unsigned &k, bitCount &bitsOut, std::true_type) {
+	signed char getBit;
+	size_t q = 0;
+
+	// unary part
+	while(q < SPIHT_RUN_QMAX) {
+		if((getBit = bs.get()) == -1) return false;
+		bitsOut++;
+		if(getBit == 0) break;
+		q++;
+	}
+
+	// low bits / whole run
+	unsigned bits = (q < SPIHT_RUN_QMAX) ? k : runBits_;
+	size_t low = 0;
+	for(unsigned i = 0; i < bits; ++i) {
+		if((getBit = bs.get()) == -1) return false;
+		bitsOut++;
+		low |= (size_t) getBit << i;
+	}
+	r = (q < SPIHT_RUN_QMAX) ? ((q << k) | low) : low;
+
+	if(q == 0) {
+		if(k > 0) k--;
+	} else if(q > 1 && k < SPIHT_RUN_KMAX) {
+		k++;
+	}
+	return r <= left;
+}
+
+// coding: word-parallel refinement pass (bit-sliced), same output as refinementPassC
+template <class T, template <class> class S, class K>
+bitCount SpihtEngine<T,S,K>::refinementPassW(K &bs, std::true_type) {
+	bitCount bitsOut = 0;
+	size_t lspOld = passStart_.back();
+	typename NodeList::iterator LSPit = LSP_.begin();
+
+	size_t i = 0;
+	while(i < lspOld) {
+		// gather bit n of up to 64 entries, append at once
+		uint64_t word = 0;
+		unsigned count = 0;
+		for(; count < 64 && i < lspOld; ++count, ++i, ++LSPit)
+			word |= (uint64_t) slices_.test(LSPit->X, LSPit->Y, planeOf(*LSPit), n_) << count;
+
+		unsigned out = bs.putBits(word, count);
+		bitsOut += out;
+		if(out < count) return bitsOut;
+	}
+
+	return bitsOut;
+}
+
+// split the refined LSP entries into chunks for the workers
+// chunks start on 64-bit stream positions (but the first), so no two share a bitstream item;
+// the LSP is walked once to find the first entry of each (a step for arrays)
+template <class T, template <class> class S, class K>
+unsigned SpihtEngine<T,S,K>::refinementChunks(size_t count, bitCount start) {
+	chunkFrom_.clear();
+	chunkEnd_.clear();
+
+	typename NodeList::iterator LSPit = LSP_.begin();
+	size_t at = 0;
+	for(size_t end = SPIHT_REFINE_CHUNK - start % 64; ; end += SPIHT_REFINE_CHUNK) {
+		chunkFrom_.push_back(LSPit);
+		chunkEnd_.push_back(std::min(end, count));
+		if(end >= count)
+			break;
+		std::advance(LSPit, end - at);
+		at = end;
+	}
+
+	return (unsigned) chunkEnd_.size();
+}
+
+// coding: refinement pass on the workers
+// bit count is known ahead, the space is claimed at once & every chunk fills its own part
+template <class T, template <class> class S, class K>
+bitCount SpihtEngine<T,S,K>::refinementPassPC(K &bs, std::true_type) {
+	bitCount start;
+	bitCount count = bs.reserveBits(passStart_.back(), start);
+
+	workers_->run(refinementChunks((size_t) count, start), [this, &bs, start](unsigned t) {
+		typename NodeList::iterator LSPit = chunkFrom_[t];
+		size_t i = t ? chunkEnd_[t-1] : 0;
+		while(i < chunkEnd_[t]) {
+			// gather bit n of up to 64 entries
+			uint64_t word = 0;
+			unsigned c = 0;
+			for(; c < 64 && i < chunkEnd_[t]; ++c, ++i, ++LSPit)
+				word |= (uint64_t) ((mag(*LSPit) >> n_) & 1) << c;
+			bs.writeBits(start + i - c, word, c);
+		}
+	});
+
+	return count;
+}
+
+// decoding: refinement pass on the workers
+// every chunk reads its own part of the bits & refines its own coefficients
+template <class T, template <class> class S, class K>
+bitCount SpihtEngine<T,S,K>::refinementPassPD(K &bs, std::true_type) {
+	size_t lspOld = passStart_.back();
+	bitCount start;
+	bitCount count = bs.takeBits(lspOld, start);
+
+	// refinement step (half threshold)
+	qUnit step = (1 << n_) << (QUANT_FRACBITS - 1);
+
+	workers_->run(refinementChunks((size_t) count, start), [this, &bs, start, step](unsigned t) {
+		typename NodeList::iterator LSPit = chunkFrom_[t];
+		size_t i = t ? chunkEnd_[t-1] : 0;
+		while(i < chunkEnd_[t]) {
+			// up to 64 bits at once, move up or down by half of the interval
+			unsigned c = (unsigned) std::min((size_t) 64, chunkEnd_[t] - i);
+			uint64_t word = bs.readBits(start + i, c);
+			for(unsigned b = 0; b < c; ++b, ++LSPit)
+				if((word >> b) & 1)
+					mag(*LSPit) += step;
+				else
+					mag(*LSPit) -= step;
+			i += c;
+		}
+	});
+
+	// bitstream exhausted inside the pass
+	if(count < lspOld)
+		decodingOver_ = true;
+
+	return count;
+}
+
+// tree significance searcher
+// compares descendants against the current threshold value
+// if max(abs(... detected anywhere in the tree, just bail out with true without more checking
+// params: f, P - family of the direct offspring (quadgroup on dyadic sizes), its subtree will be checked
+// startNow - put true if you want to start right now, with false it will not check the first round (typeB entry)
+template <class T, template <class> class S, class K>
+bool SpihtEngine<T,S,K>::descend(Family f, planeVal P, bool startNow) const {
+	// loop to most possible depth
+	do {
+		// search for significance
+		if(startNow) {
+			if(coefs_.maxTest(f.x0, f.y0, f.width(), f.height(), P, n_)) return true;
+		} else {
+			startNow = true;
+		}
+
+	// next generation while the image has one
+	} while(subbands_.next(f));
+
+	// not found
+	return false;
+}
+
+// decoding: does a sorting pass, returns number of bits processed
+template <class T, template <class> class S, class K>
+bitCount SpihtEngine<T,S,K>::sortingPassD(K &bs) {
+	bitCount bitsOut = 0;
+	signed char getBit = 0;
+	// everything in LSP by now is refined in this pass
+	passStart_.push_back(LSP_.size());
+
+	// part 1: LIP processing
+	if(runs_) {
+		// zero-run coded variant
+		if(!lipPassZD(bs, bitsOut, Positional())) { decodingOver_ = true; return bitsOut; }
+	} else {
+		typename Store::Sweep LIPit(LIP_);
+		while(!LIPit.done()) {
+			Node curr = *LIPit;
+			CODER_COUNT(pass_.lipVisits, 1);
+
+			// read a bit
+			if((getBit = getSymbol(bs, symLip, curr)) == -1) { decodingOver_ = true; LIPit.close(); return bitsOut; }
+			bitsOut++;
+
+			// check for significance
+			if(getBit == 1) {
+				// get sign
+				if((getBit = getSymbol(bs, symSign, curr)) == -1) { decodingOver_ = true; LIPit.close(); return bitsOut; }
+				bitsOut++;
+				// 1.5 * threshold, sign according to bit
+				mag(curr) = (3 << n_) << (QUANT_FRACBITS - 1);
+				coefs_.setNegative(curr.X, curr.Y, planeOf(curr), getBit != 1);
+
+				// move into LSP
+				LSP_.push_back(curr);
+				LIPit.drop();
+				CODER_COUNT(pass_.erasures, 1);
+			} else {
+				LIPit.keep();
+			}
+		}
+		LIPit.close();
+	}
+
+	// part 2: LIS processing
+	size_t left = LIS_.size();		// (zero-run coding) sets from LISit to the list end
+	typename SetList::iterator LISit = LIS_.begin();
+	while(LISit != LIS_.end()) {
+		if(runs_) {
+			// a run of insignificant sets, ended by a significant one or by the list end
+			size_t r;
+			if(!getRun(bs, r, left, runK_[1], bitsOut, Positional())) { decodingOver_ = true; return bitsOut; }
+			CODER_COUNT(pass_.lisVisits, r);
+			if(r == left)
+				break;
+			std::advance(LISit, r);
+			left -= r;
+			getBit = 1;
+		}
+
+		// backup iterator: fetch current item into it, move to the next
+		typename SetList::iterator LIScurr = LISit;
+		size_t before = LIS_.size();
+		CODER_COUNT(pass_.lisVisits, 1);
+
+		// read a bit
+		if(!runs_) {
+			if((getBit = getSymbol(bs, LIScurr->T == typeA ? symSetA : symSetB, *LIScurr)) == -1) { decodingOver_ = true; return bitsOut; }
+			bitsOut++;
+		}
+		// check significance
+		if(getBit == 1) {
+			// direct offspring, split: which of them are partitioned (typeB)
+			Node child[SUBBANDS_MAX_OFFSPRING];
+			unsigned split;
+			unsigned count = T::offspring(*this, *LIScurr, child, split);
+
+			for(unsigned i = 0; i < count; ++i) {
+				// process typeA
+				if(LIScurr->T == typeA) {
+					// read a bit
+					if((getBit = getSymbol(bs, symChild, child[i])) == -1) { decodingOver_ = true; return bitsOut; }
+					bitsOut++;
+					// test for significance (single-element)
+					if(getBit == 1) {
+						// get sign
+						if((getBit = getSymbol(bs, symSign, child[i])) == -1) { decodingOver_ = true; return bitsOut; }
+						bitsOut++;
+						// 1.5 * threshold, sign according to bit
+						mag(child[i]) = (3 << n_) << (QUANT_FRACBITS - 1);
+						coefs_.setNegative(child[i].X, child[i].Y, planeOf(child[i]), getBit != 1);
+
+						// move into LSP
+						LSP_.push_back(child[i]);
+					} else {
+						// move to LIP
+						LIP_.push_back(child[i]);
+					}
+
+				// process typeB
+				} else if(split & (1 << i)) {
+					// partitioning
+					LIS_.push_back(Coef::set(child[i], typeA));
+				}
+			}
+
+			// possible typeB entry creation
+			if(LIScurr->T == typeA) {
+				// check if image allows more descendants
+				if(subbands_.hasOffspring(child[count-1].X, child[count-1].Y)) {
+					// put into LIS as entry type B
+					LIS_.push_back(Coef::set(*LIScurr, typeB));
+				}
+			}
+
+			// partitioning done, discard LIS entry
+			// IMPORTANT / iterate before discard (new ones might be added)
+			CODER_COUNT(LIScurr->T == typeA ? pass_.expandedA : pass_.expandedB, 1);
+			LISit++;
+			LIS_.erase(LIScurr);
+			left = left + LIS_.size() - before;
+
+		} else {
+			// iter only
+			LISit++;
+		}
+	}
+
+	return bitsOut;
+}
+
+// decoding: does a refinement pass, returns number of bits processed
+template <class T, template <class> class S, class K>
+bitCount SpihtEngine<T,S,K>::refinementPassD(K &bs) {
+	// exit upon finished reading
+	if(decodingOver_)
+		return 0;
+
+	// chunks on the workers
+	if(K::positional && workers_ && passStart_.back() >= 2*SPIHT_REFINE_CHUNK)
+		return refinementPassPD(bs, Positional());
+
+	bitCount bitsOut = 0;
+	signed char getBit = 0;
+	size_t lspOld = passStart_.back();
+	// LSP processing iterator
+	typename NodeList::iterator LSPit = LSP_.begin();
+
+	// refinement step (half threshold)
+	qUnit step = (1 << n_) << (QUANT_FRACBITS - 1);
+
+	// read bits, "refine" magnitudes marked by LSP entries of previous passes
+	for(size_t i = 0; i < lspOld; ++i, ++LSPit) {
+		// get a bit
+		if((getBit = getSymbol(bs, symRefine, *LSPit)) == -1) { decodingOver_ = true; return bitsOut; }
+		bitsOut++;
+
+		// move up or down by half of the interval
+		if(getBit == 1)
+			mag(*LSPit) += step;
+		else
+			mag(*LSPit) -= step;
+	}
+
+	return bitsOut;
+}
+
+// ----------- main loops on a plane bitstream
+// plain engines code into it directly, entropy coded ones through their sink over it
+template <class T, template <class> class S>
+bool encodeStream(SpihtEngine<T,S> &engine, ColorCodec::DataGroup::BitStream &bs, bool extended, double &elapsed, std::vector<PassStats> *stats = 0) {
+	return engine.encodeSteps(bs, extended, elapsed, stats);
+}
+template <class T, template <class> class S, class K>
+bool encodeStream(SpihtEngine<T,S,K> &engine, ColorCodec::DataGroup::BitStream &bs, bool extended, double &elapsed, std::vector<PassStats> *stats = 0) {
+	K sink(bs, true, wideCoords(engine.width_, engine.height_));
+	return engine.encodeSteps(sink, extended, elapsed, stats);
+}
+template <class T, template <class> class S>
+bool decodeStream(SpihtEngine<T,S> &engine, ColorCodec::DataGroup::BitStream &bs, bool extended, double &elapsed, std::vector<PassStats> *stats = 0) {
+	return engine.decodeSteps(bs, extended, elapsed, stats);
+}
+template <class T, template <class> class S, class K>
+bool decodeStream(SpihtEngine<T,S,K> &engine, ColorCodec::DataGroup::BitStream &bs, bool extended, double &elapsed, std::vector<PassStats> *stats = 0) {
+	K sink(bs, false, wideCoords(engine.width_, engine.height_));
+	return engine.decodeSteps(sink, extended, elapsed, stats);
+}
+
+#endif
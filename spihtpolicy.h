@@ -0,0 +1,366 @@
+// spihtpolicy: compile-time policies of the SPIHT pass engine
+// coefficient addressing (node types), LIP / LSP storage and tree topology
+#ifndef SPIHTPOLICY_H
+#define SPIHTPOLICY_H
+
+#include "general.h"
+#include "image.h"
+#include "arena.h"
+#include "subbands.h"
+#include <list>
+#include <vector>
+
+// ----------- nodes
+// coordinates of type C: wCoord, or wCoordWide for images over 65535 a side
+
+// struct for X,Y coordinate storage
+template <class C> struct CoordXY {
+	C X;
+	C Y;
+	CoordXY(): X(0), Y(0) {};
+	explicit CoordXY(C x, C y): X(x), Y(y) {};
+};
+
+// struct for X,Y,type coordinate storage
+template <class C> struct CoordXYT {
+	C X;
+	C Y;
+	typeVal T;
+	CoordXYT(): X(0), Y(0), T(typeA) {};
+	explicit CoordXYT(C x, C y, typeVal t): X(x), Y(y), T(t) {};
+};
+
+// struct for X,Y,P coordinate storage
+template <class C> struct CoordXYP {
+	C X;
+	C Y;
+	planeVal P;
+	CoordXYP(): X(0), Y(0), P(y) {};
+	explicit CoordXYP(C x, C y, planeVal p): X(x), Y(y), P(p) {};
+};
+
+// struct for X,Y,P,type coordinate storage
+template <class C> struct CoordXYPT {
+	C X;
+	C Y;
+	planeVal P;
+	typeVal T;
+	CoordXYPT(): X(0), Y(0), P(y), T(typeA) {};
+	explicit CoordXYPT(C x, C y, planeVal p, typeVal t): X(x), Y(y), P(p), T(t) {};
+};
+
+// 16-bit nodes
+typedef CoordXY<wCoord> XY;
+typedef CoordXYT<wCoord> XYT;
+typedef CoordXYP<wCoord> XYP;
+typedef CoordXYPT<wCoord> XYPT;
+
+// ----------- coefficient policies
+// which planes one run codes and how a node addresses its coefficient
+
+// PlaneCoef: one plane per run (BSPIHT, DSPIHT), the plane is not stored in nodes
+template <class C = wCoord> struct PlaneCoef {
+	typedef CoordXY<C> Node;
+	typedef CoordXYT<C> Set;
+	// same on 32-bit coordinates
+	typedef PlaneCoef<wCoordWide> Wide;
+
+	// planes coded by a run started on plane p
+	static inline unsigned firstPlane(planeVal p) { return p; }
+	static inline unsigned lastPlane(planeVal p) { return p; }
+
+	// plane of a node
+	static inline planeVal plane(const Node &, planeVal p) { return p; }
+	static inline planeVal plane(const Set &, planeVal p) { return p; }
+	// node constructors
+	static inline Node node(unsigned x, unsigned y, planeVal) { return Node((C) x, (C) y); }
+	static inline Set set(const Node &n, typeVal t) { return Set(n.X, n.Y, t); }
+	static inline Set set(const Set &s, typeVal t) { return Set(s.X, s.Y, t); }
+};
+
+// ColorCoef: all planes in one run (CSPIHT), every node carries its plane
+template <class C = wCoord> struct ColorCoef {
+	typedef CoordXYP<C> Node;
+	typedef CoordXYPT<C> Set;
+	// same on 32-bit coordinates
+	typedef ColorCoef<wCoordWide> Wide;
+
+	// planes coded by a run
+	static inline unsigned firstPlane(planeVal) { return 0; }
+	static inline unsigned lastPlane(planeVal) { return 2; }
+
+	// plane of a node
+	static inline planeVal plane(const Node &n, planeVal) { return n.P; }
+	static inline planeVal plane(const Set &s, planeVal) { return s.P; }
+	// node constructors
+	static inline Node node(unsigned x, unsigned y, planeVal p) { return Node((C) x, (C) y, p); }
+	static inline Set set(const Node &n, typeVal t) { return Set(n.X, n.Y, n.P, t); }
+	static inline Set set(const Set &s, typeVal t) { return Set(s.X, s.Y, s.P, t); }
+};
+
+// ----------- LIP / LSP storage policies
+// both keep list order, LSP is append-only, LIP is swept in order
+// with entries being kept or dropped (moved to LSP)
+
+// ListStorage: linked lists, dropped entries are erased on the spot
+template <class Node> struct ListStorage {
+	typedef std::list<Node, ArenaAllocator<Node> > List;
+
+	// nothing to take in advance
+	static inline void reserve(List &, size_t) {}
+
+	// in-order sweep over LIP
+	class Sweep {
+		List &list_;
+		typename List::iterator it_;
+	public:
+		explicit Sweep(List &list) : list_(list), it_(list.begin()) {}
+		// all entries visited
+		inline bool done() const { return it_ == list_.end(); }
+		// current entry
+		inline const Node& operator* () const { return *it_; }
+		// copy up to max entries from the current one on into run, returns count
+		unsigned peek(Node *run, unsigned max) const {
+			typename List::const_iterator it = it_;
+			unsigned count = 0;
+			for(; count < max && it != list_.end(); ++count, ++it)
+				run[count] = *it;
+			return count;
+		}
+		// leave count entries in LIP
+		inline void keep(size_t count = 1) { while(count--) ++it_; }
+		// remove current entry
+		inline void drop() { it_ = list_.erase(it_); }
+		// sweep done or interrupted, unvisited entries stay
+		inline void close() {}
+	};
+};
+
+// ArrayStorage: arrays of fixed capacity (the plane size), taken once
+// each coefficient enters LIP at most once and LSP at most once,
+// so memory is bounded by the image and does not grow with bitrate
+template <class Node> struct ArrayStorage {
+	typedef std::vector<Node, ArenaAllocator<Node> > List;
+
+	// capacity for every coefficient of the coded planes
+	static inline void reserve(List &list, size_t count) { list.reserve(count); }
+
+	// in-order sweep over LIP, compacts in place:
+	// r reads, w writes back entries staying in LIP
+	class Sweep {
+		List &list_;
+		size_t r_;
+		size_t w_;
+	public:
+		explicit Sweep(List &list) : list_(list), r_(0), w_(0) {}
+		// all entries visited
+		inline bool done() const { return r_ == list_.size(); }
+		// current entry
+		inline const Node& operator* () const { return list_[r_]; }
+		// copy up to max entries from the current one on into run, returns count
+		unsigned peek(Node *run, unsigned max) const {
+			unsigned count = (list_.size() - r_ < max) ? (unsigned) (list_.size() - r_) : max;
+			for(unsigned k = 0; k < count; ++k)
+				run[k] = list_[r_ + k];
+			return count;
+		}
+		// leave count entries in LIP
+		inline void keep(size_t count = 1) { while(count--) list_[w_++] = list_[r_++]; }
+		// remove current entry
+		inline void drop() { ++r_; }
+		// sweep done or interrupted: drop the gap [w, r), unvisited entries stay
+		inline void close() { list_.erase(list_.begin() + w_, list_.begin() + r_); r_ = w_; }
+	};
+};
+
+// ----------- topology policies
+// initial lists, direct offspring of a set and significance of its descendants
+// E is the engine (see spihtengine.h), nodes & sets are of its coefficient policy
+
+// RegularTree: BSPIHT, 3/4 of each LLtop quadgroup are roots
+struct RegularTree {
+	typedef PlaneCoef<> Coef;
+	const static unsigned char version = 0xB0;
+
+	// LIP contains all pixels from LLtop.
+	// LIS contains only 3/4 of each quadgroup from LLtop.
+	template <class E> static void initLists(E &e) {
+		typedef typename E::Node Node;
+		typedef typename E::Set Set;
+		for(unsigned j=0; j < e.bandSizeH_; ++j) {
+			for(unsigned i=0; i < e.bandSizeW_; ++i) {
+				e.LIP_.push_back(Node(i,j));
+				if(!(i % 2 == 0 && j % 2 == 0))
+					e.LIS_.push_back(Set(i,j,typeA));
+			}
+		}
+	}
+
+	// direct offspring of s: one family (quadgroup on dyadic sizes), all partitioned
+	template <class E> static unsigned offspring(const E &e, const typename E::Set &s, typename E::Node *child, unsigned &split) {
+		Family f;
+		base(e, s.X, s.Y, f);
+		split = (1u << SUBBANDS_MAX_OFFSPRING) - 1;
+		return members<typename E::Coef>(child, f, e.plane_);
+	}
+
+	// significance of the descendants (typeA) or grand-descendants (typeB) of s
+	template <class E> static bool significant(const E &e, const typename E::Set &s) {
+		Family f;
+		base(e, s.X, s.Y, f);
+		return e.descend(f, e.plane_, s.T == typeA);
+	}
+
+	// offspring family of a node
+	template <class E> static inline void base(const E &e, unsigned X, unsigned Y, Family &f) {
+		if(X < e.bandSizeW_ && Y < e.bandSizeH_) {
+			// inside LLtop: top right / bottom left / bottom right of the LLtop quadgroup
+			e.subbands_.rootFamily(X, Y, f);
+		} else {
+			// regular quad-tree
+			e.subbands_.family(X, Y, f);
+		}
+	}
+
+	// nodes of a family in scanning order, of plane P
+	template <class Coef> static inline unsigned members(typename Coef::Node *child, const Family &f, planeVal P) {
+		if(f.width() == 2 && f.height() == 2) {
+			// quadgroup
+			child[0] = Coef::node(f.x0, f.y0, P);
+			child[1] = Coef::node(f.x0+1, f.y0, P);
+			child[2] = Coef::node(f.x0, f.y0+1, P);
+			child[3] = Coef::node(f.x0+1, f.y0+1, P);
+			return 4;
+		}
+		unsigned count = 0;
+		for(unsigned j = f.y0; j < f.y1; ++j)
+			for(unsigned i = f.x0; i < f.x1; ++i)
+				child[count++] = Coef::node(i, j, P);
+		return count;
+	}
+};
+
+// DegradedTree: DSPIHT, LLtop only in LIP, the highest band starts the trees
+struct DegradedTree {
+	typedef PlaneCoef<> Coef;
+	const static unsigned char version = 0xB1;
+
+	// LIP contains LLtop and the highest band, LIS the highest band
+	template <class E> static void initLists(E &e) {
+		typedef typename E::Node Node;
+		typedef typename E::Set Set;
+		// init LIP in bandsize
+		for(unsigned j=0; j < e.bandSizeH_; ++j)
+			for(unsigned i=0; i < e.bandSizeW_; ++i)
+				e.LIP_.push_back(Node(i,j));
+
+		// check if highest band is present
+		unsigned levels = e.subbands_.levels();
+		if(levels == 0)
+			return;
+
+		// init LIP & LIS in the highest band
+		for(unsigned j=0; j < e.subbands_.sideH(levels - 1); ++j) {
+			for(unsigned i=0; i < e.subbands_.sideW(levels - 1); ++i) {
+				if(i < e.bandSizeW_ && j < e.bandSizeH_)
+					continue;
+				e.LIP_.push_back(Node(i,j));
+				e.LIS_.push_back(Set(i,j,typeA));
+			}
+		}
+	}
+
+	// direct offspring of s: regular family (quadgroup on dyadic sizes)
+	template <class E> static unsigned offspring(const E &e, const typename E::Set &s, typename E::Node *child, unsigned &split) {
+		Family f;
+		e.subbands_.family(s.X, s.Y, f);
+		split = (1u << SUBBANDS_MAX_OFFSPRING) - 1;
+		return RegularTree::members<typename E::Coef>(child, f, e.plane_);
+	}
+
+	// significance of the descendants (typeA) or grand-descendants (typeB) of s
+	template <class E> static bool significant(const E &e, const typename E::Set &s) {
+		Family f;
+		if(!e.subbands_.family(s.X, s.Y, f))
+			return false;
+		return e.descend(f, e.plane_, s.T == typeA);
+	}
+};
+
+// CrossPlaneTree: CSPIHT, trees of the y plane, the top-left LLtop node
+// of each quadgroup has the chroma LLtop quadgroups as offspring
+struct CrossPlaneTree {
+	typedef ColorCoef<> Coef;
+	const static unsigned char version = 0xA0;
+
+	// LIP and LIS contain all pixels from LLtop of plane y
+	template <class E> static void initLists(E &e) {
+		typedef typename E::Node Node;
+		typedef typename E::Set Set;
+		for(unsigned j=0; j < e.bandSizeH_; ++j)
+			for(unsigned i=0; i < e.bandSizeW_; ++i) {
+				e.LIS_.push_back(Set(i,j,y,typeA));
+				e.LIP_.push_back(Node(i,j,y));
+			}
+	}
+
+	// direct offspring of s
+	// top-left node: quadgroups of cB and cR (cut at the end of an odd LLtop), their top-left nodes are not partitioned
+	template <class E> static unsigned offspring(const E &e, const typename E::Set &s, typename E::Node *child, unsigned &split) {
+		Family f;
+		if(topLeftNode(e, s.X, s.Y)) {
+			e.subbands_.rootFamily(s.X, s.Y, f);
+			unsigned count = RegularTree::members<typename E::Coef>(child, f, cB);
+			RegularTree::members<typename E::Coef>(child + count, f, cR);
+			split = ((1u << (2*count)) - 1) & ~(1u | (1u << count));
+			return 2*count;
+		}
+
+		RegularTree::base(e, s.X, s.Y, f);
+		split = (1u << SUBBANDS_MAX_OFFSPRING) - 1;
+		return RegularTree::members<typename E::Coef>(child, f, s.P);
+	}
+
+	// significance of the descendants (typeA) or grand-descendants (typeB) of s
+	template <class E> static bool significant(const E &e, const typename E::Set &s) {
+		return check(e, s.X, s.Y, s.P, s.T == typeA);
+	}
+
+	// recursive tree significance searcher, see SpihtEngine::descend
+	template <class E> static bool check(const E &e, unsigned X, unsigned Y, planeVal P, bool startNow) {
+		Family f;
+		if(topLeftNode(e, X, Y)) {
+			// top left - exception of root node of color plane!S! (CSPIHT version 0.2)
+			// first check the 8 relatives (fewer at the end of an odd LLtop), if startNow is on
+			e.subbands_.rootFamily(X, Y, f);
+			if(startNow && e.coefs_.maxTest(f.x0, f.y0, f.width(), f.height(), cB, e.n_)) return true;
+			if(startNow && e.coefs_.maxTest(f.x0, f.y0, f.width(), f.height(), cR, e.n_)) return true;
+
+			// now we have to make 6 calls to checkSignificance and gather the results
+			// NOTE: very broad check!
+			for(unsigned p = cB; p <= cR; ++p)
+				for(unsigned j = f.y0; j < f.y1; ++j)
+					for(unsigned i = f.x0; i < f.x1; ++i)
+						if((i != X || j != Y) && check(e, i, j, (planeVal) p, true)) return true;
+
+			// can't go beyond this point
+			return false;
+		}
+
+		RegularTree::base(e, X, Y, f);
+		return e.descend(f, P, startNow);
+	}
+
+	// LLtop: top-left node of a quadgroup
+	template <class E> static inline bool topLeftNode(const E &e, unsigned X, unsigned Y) {
+		return X < e.bandSizeW_ && Y < e.bandSizeH_ && X % 2 == 0 && Y % 2 == 0;
+	}
+};
+
+// WideTree: topology T on 32-bit coordinates, for images over 65535 a side
+// same trees & bitstream, only the list entries are larger
+template <class T> struct WideTree : T {
+	typedef typename T::Coef::Wide Coef;
+};
+
+#endif
@@ -0,0 +1,153 @@
+// subbands: band sizes of a transformed plane and the node families of the SPIHT trees on them
+#ifndef SUBBANDS_H
+#define SUBBANDS_H
+
+#include "general.h"
+#include <algorithm>
+
+// deepest transform of a plane (levels)
+#define SUBBANDS_MAX_LEVELS 32
+// most direct offspring of a node: 3 x 3 at the end of uneven bands (the cross-plane root has 8)
+#define SUBBANDS_MAX_OFFSPRING 9
+
+// one generation of descendants of a tree node: the nodes x0..x1-1 x y0..y1-1 of the bands of level
+// highX, highY: side in the high band of the level, else in its low part (0 .. side of the level)
+struct Family {
+	unsigned x0, x1;
+	unsigned y0, y1;
+	unsigned level;
+	bool highX, highY;
+	inline unsigned width() const { return x1 - x0; }
+	inline unsigned height() const { return y1 - y0; }
+};
+
+// class Subbands
+// geometry of a plane after levels of the WT: side L_k = ceil(size / 2^k) of the low band of level k
+// (bandSide()), the high band of level k on a side is L_k .. L_(k-1)-1, LLtop is L_levels
+// trees: a node of level k has the nodes of level k-1 at the same place as offspring, on each side
+// - in a high band: band index i gets 2i, 2i+1 of the high band one level down, the last one
+//   takes the rest (3 at the end of uneven bands)
+// - in the low part: c gets 2c, 2c+1 inside the low part one level down
+// - in LLtop: odd c has the pair of the high band of the top level, even c the pair of LLtop it starts
+//   (last odd c takes the rest of the band)
+// so every node below LLtop has one parent and nodes get 1 to 9 direct offspring
+// when both sides are divisible by 2^(levels+1) (dyadic) all of it is the quadgroup 2X, 2Y: taken directly
+class Subbands {
+	unsigned width_;
+	unsigned height_;
+	unsigned levels_;
+	bool dyadic_;
+	unsigned sideW_[SUBBANDS_MAX_LEVELS + 1];
+	unsigned sideH_[SUBBANDS_MAX_LEVELS + 1];
+
+	// level of the band holding c: k for L_k <= c < L_(k-1), levels + 1 in LLtop
+	inline unsigned levelOf(unsigned c, const unsigned *side) const {
+		if(c < side[levels_])
+			return levels_ + 1;
+		unsigned k = levels_;
+		while(c >= side[k-1])
+			k--;
+		return k;
+	}
+
+	// nodes c0..c1-1 of a side at level j: their offspring at level j-1
+	static inline void down(unsigned &c0, unsigned &c1, bool high, const unsigned *side, unsigned j) {
+		if(high) {
+			bool last = c1 == side[j-1];
+			c0 = side[j-1] + 2 * (c0 - side[j]);
+			c1 = last ? side[j-2] : side[j-1] + 2 * (c1 - side[j]);
+		} else {
+			c0 = 2 * c0;
+			c1 = std::min(2 * c1, side[j-1]);
+		}
+	}
+
+	// side of a node c of LLtop: odd ones take a pair of the high band, even ones their pair of LLtop
+	inline void root(unsigned c, unsigned &c0, unsigned &c1, bool &high, const unsigned *side) const {
+		unsigned band = side[levels_];
+		high = c % 2 != 0;
+		if(high) {
+			c0 = band + c - 1;
+			c1 = (c + 2 >= band) ? side[levels_ - 1] : band + c + 1;
+		} else {
+			c0 = c;
+			c1 = std::min(c + 2, band);
+		}
+	}
+
+public:
+	Subbands() : width_(0), height_(0), levels_(0), dyadic_(true) {}
+
+	// plane of width x height with LLtop bandW x bandH
+	void set(unsigned width, unsigned height, unsigned bandW, unsigned bandH) {
+		width_ = width;
+		height_ = height;
+		levels_ = 0;
+		while(levels_ < SUBBANDS_MAX_LEVELS && (bandSide(width, levels_) > bandW || bandSide(height, levels_) > bandH))
+			levels_++;
+		for(unsigned k = 0; k <= levels_; ++k) {
+			sideW_[k] = bandSide(width, k);
+			sideH_[k] = bandSide(height, k);
+		}
+		// quadgroups of LLtop too: even LLtop
+		dyadic_ = ((uint64_t) bandW << levels_) == width && ((uint64_t) bandH << levels_) == height
+				  && bandW % 2 == 0 && bandH % 2 == 0;
+	}
+
+	// levels of the transform & low band sides of level k (0 = whole plane)
+	inline unsigned levels() const { return levels_; }
+	inline unsigned sideW(unsigned k) const { return sideW_[k]; }
+	inline unsigned sideH(unsigned k) const { return sideH_[k]; }
+
+	// direct offspring of LLtop node X,Y (top-left nodes of the quadgroups: their own quadgroup)
+	inline void rootFamily(unsigned X, unsigned Y, Family &f) const {
+		f.level = levels_;
+		if(dyadic_) {
+			f.x0 = (X & ~1u) + ((X % 2) ? sideW_[levels_] : 0);
+			f.y0 = (Y & ~1u) + ((Y % 2) ? sideH_[levels_] : 0);
+			f.x1 = f.x0 + 2;
+			f.y1 = f.y0 + 2;
+			return;
+		}
+		root(X, f.x0, f.x1, f.highX, sideW_);
+		root(Y, f.y0, f.y1, f.highY, sideH_);
+	}
+
+	// direct offspring of node X,Y below LLtop, false if it has none (finest level)
+	inline bool family(unsigned X, unsigned Y, Family &f) const {
+		if(dyadic_) {
+			f.x0 = 2*X; f.x1 = f.x0 + 2;
+			f.y0 = 2*Y; f.y1 = f.y0 + 2;
+			return f.x0 < width_ && f.y0 < height_;
+		}
+		f.x0 = X; f.x1 = X + 1;
+		f.y0 = Y; f.y1 = Y + 1;
+		unsigned kx = levelOf(X, sideW_);
+		unsigned ky = levelOf(Y, sideH_);
+		f.level = std::min(kx, ky);
+		f.highX = kx == f.level;
+		f.highY = ky == f.level;
+		return next(f);
+	}
+
+	// the generation below f, false if f is at the finest level
+	inline bool next(Family &f) const {
+		if(dyadic_) {
+			f.x0 *= 2; f.x1 *= 2; f.y0 *= 2; f.y1 *= 2;
+			return f.x0 < width_ && f.y0 < height_;
+		}
+		if(f.level <= 1)
+			return false;
+		down(f.x0, f.x1, f.highX, sideW_, f.level);
+		down(f.y0, f.y1, f.highY, sideH_, f.level);
+		f.level--;
+		return true;
+	}
+
+	// node X,Y has offspring: not in a band of the finest level (LLtop ones always)
+	inline bool hasOffspring(unsigned X, unsigned Y) const {
+		return levels_ > 0 && X < sideW_[1] && Y < sideH_[1];
+	}
+};
+
+#endif
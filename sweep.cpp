@@ -0,0 +1,234 @@
+// sweep implementation
+#include "sweep.h"
+#include "flwt.h"
+#include "arena.h"
+#include "bspiht.h"
+#include "dspiht.h"
+#include "lspiht.h"
+#include "cspiht.h"
+#include "speck.h"
+#include <cstdlib>
+#include <cmath>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include "trace.h"
+
+// codec of a job
+static ColorCodec * makeCodec(char coder, bool fixedState, Image &image, Arena *arena) {
+	if(coder == 'c')
+		return new CSpiht(image, arena);
+	if(coder == 'd')
+		return new DSpiht(image, arena);
+	if(coder == 'k')
+		return new Speck(image, arena);
+	if(fixedState)
+		return new LSpiht(image, arena);
+	return new BSpiht(image, arena);
+}
+
+// name of the codec of a job
+static const char * codecName(char coder, bool fixedState) {
+	if(coder == 'c')
+		return "CSPIHT";
+	if(coder == 'd')
+		return "DSPIHT";
+	if(coder == 'k')
+		return "SPECK";
+	return fixedState ? "LSPIHT" : "BSPIHT";
+}
+
+// constructor
+Sweep::Sweep(Settings &sets, WorkerPool &workers) : sets_(sets), workers_(workers) {
+}
+
+// comma separated numbers
+bool Sweep::parseList(const std::string &list, std::vector<double> &values) {
+	values.clear();
+	size_t pos = 0;
+	while(pos <= list.size()) {
+		size_t end = list.find(',', pos);
+		if(end == std::string::npos)
+			end = list.size();
+		std::string item = list.substr(pos, end - pos);
+		char *stop = 0;
+		double value = strtod(item.c_str(), &stop);
+		if(item.empty() || *stop != '\0')
+			return false;
+		values.push_back(value);
+		pos = end + 1;
+	}
+	return !values.empty();
+}
+
+// transformed copy of the pixels, as codec.cpp does it before coding
+unsigned Sweep::prepare(unsigned levelsY, unsigned levelsC) {
+	for(unsigned i = 0; i < prepared_.size(); ++i)
+		if(preparedY_[i] == levelsY && preparedC_[i] == levelsC)
+			return i;
+
+	Image copy(original_);
+	copy.substract128();
+	Flwt::forward(levelsY, copy.getMatrix(y));
+	Flwt::forward(levelsC, copy.getMatrix(cB));
+	Flwt::forward(levelsC, copy.getMatrix(cR));
+
+	prepared_.push_back(std::move(copy));
+	preparedY_.push_back(levelsY);
+	preparedC_.push_back(levelsC);
+	return (unsigned) prepared_.size() - 1;
+}
+
+// run all
+bool Sweep::run() {
+	// lists, single values if not given
+	std::vector<double> levels, shifts, rates;
+	if(!parseList(sets_.levelList.empty() ? "3" : sets_.levelList, levels)
+		|| !parseList(sets_.shiftList.empty() ? "0" : sets_.shiftList, shifts)
+		|| (!sets_.bppList.empty() && !parseList(sets_.bppList, rates))) {
+		std::cout << "Sweep: -l, -S and -p take comma separated lists of numbers." << std::endl;
+		return false;
+	}
+
+	// pixels, once
+	if(!original_.loadBMP(sets_.inputImage.c_str()))
+		return false;
+	original_.transformRGB2YCbCr();
+	double pixels = (double) original_.getWidth() * original_.getHeight() * 3.0;
+
+	// jobs: levels x coders x color shifts x rates
+	const char coders[] = { 'b', 'd', 'c', 'k' };
+	TraceTimer prepareTimer("sweep transform");
+	for(size_t l = 0; l < levels.size(); ++l) {
+		for(unsigned c = 0; c < sizeof(coders); ++c) {
+			if(coders[c] == 'k' && !sets_.speckFlag)
+				continue;
+			for(size_t s = 0; s < shifts.size(); ++s) {
+				// CSPIHT codes all planes at the same level
+				if(coders[c] == 'c' && s > 0)
+					continue;
+
+				Job job;
+				job.coder = coders[c];
+				job.levels = (unsigned) levels[l];
+				job.colorShift = (coders[c] == 'c') ? 0 : (unsigned) shifts[s];
+				bool deep = sets_.computeDeepVariance && job.colorShift > 0;
+				job.prepared = prepare(job.levels, deep ? job.levels + job.colorShift : job.levels);
+
+				for(size_t r = 0; r < rates.size() || (r == 0 && rates.empty()); ++r) {
+					job.bpp = rates.empty() ? sets_.bits / pixels : rates[r];
+					job.bits = rates.empty() ? sets_.bits : (bitCount) ceil(rates[r] * pixels);
+					job.done = false;
+					job.bitsOut = 0;
+					job.psnrY = job.psnrC = 0.0;
+					job.timeEncoding = job.timeDecoding = 0.0;
+					job.highWater = 0;
+					jobs_.push_back(job);
+				}
+			}
+		}
+	}
+	prepareTimer.stop();
+
+	std::cout << "Sweep: " << prepared_.size() << " transformed copies, " << jobs_.size() << " jobs on "
+			  << workers_.getThreads() << " threads." << std::endl;
+	if(sets_.printTiming)
+		std::cout << "Sweep transform elapsed time: " << std::fixed << std::setprecision(8) << prepareTimer.seconds() << std::endl;
+
+	TraceTimer codingTimer("sweep coding");
+	workers_.run((unsigned) jobs_.size(), [this](unsigned i) { runJob(jobs_[i]); });
+
+	codingTimer.stop();
+	if(sets_.printTiming)
+		std::cout << "Sweep coding elapsed time: " << std::fixed << std::setprecision(8) << codingTimer.seconds() << std::endl;
+
+	for(size_t i = 0; i < jobs_.size(); ++i)
+		if(!jobs_[i].done)
+			std::cout << "Sweep: " << codecName(jobs_[i].coder, sets_.fixedStateFlag) << " -l " << jobs_[i].levels
+					  << " -S " << jobs_[i].colorShift << " failed, left out of the report." << std::endl;
+
+	return writeReport();
+}
+
+// one job, its own arena & settings, the transformed copy is only read
+void Sweep::runJob(Job &job) {
+	TraceSpan span("sweep job", (int) (&job - &jobs_[0]));
+	Arena arena;
+	Settings sets = sets_;
+	sets.levels = job.levels;
+	sets.colorShift = job.colorShift;
+	sets.bits = job.bits;
+	sets.bpp = (float) job.bpp;
+	sets.cspihtFlag = job.coder == 'c';
+	sets.dspihtFlag = job.coder == 'd';
+	sets.speckFlag = job.coder == 'k';
+	// output of parallel jobs would mix
+	sets.printExtended = false;
+	sets.printTiming = false;
+	sets.printDebug = false;
+
+	Image decoded;
+	decoded.setArena(&arena);
+	ColorCodec *encoder = 0;
+	ColorCodec *decoder = 0;
+
+	try {
+		encoder = makeCodec(job.coder, sets.fixedStateFlag, prepared_[job.prepared], &arena);
+		encoder->encode(sets);
+		job.timeEncoding = encoder->getElapsedTime();
+		job.bitsOut = encoder->getBitCount();
+
+		decoder = makeCodec(job.coder, sets.fixedStateFlag, decoded, &arena);
+		decoder->takeBitStream(*encoder);
+		// the whole streams just coded (the per-plane ceil may put them over sets.bits)
+		decoder->decode(sets, 0);
+		job.timeDecoding = decoder->getElapsedTime();
+
+		// inverse WT as codec.cpp does
+		for(unsigned p = 0; p < 3; p ++) {
+			unsigned level = sets.levels;
+			if(p > 0 && sets.colorShift > 0 && !sets.cspihtFlag)
+				level += sets.colorShift;
+			Flwt::inverse(level, decoded.getMatrix((planeVal) p), &arena);
+		}
+		decoded.add128();
+
+		job.psnrY = decoded.getLummaDifferencePSNR(original_);
+		job.psnrC = decoded.getChromaDifferencePSNR(original_);
+		job.done = true;
+	}
+
+	catch(...) {
+		job.done = false;
+	}
+
+	delete decoder;
+	delete encoder;
+	job.highWater = arena.getHighWater();
+}
+
+// CSV report
+bool Sweep::writeReport() const {
+	std::ofstream file;
+	file.open(sets_.reportFile.c_str());
+	if(!file.is_open()) {
+		std::cout << "Can't write to file \"" << sets_.reportFile << "\"" << std::endl;
+		return false;
+	}
+
+	file << "coder,levels,colorShift,bpp,bits,psnrY,psnrCbCr,encodeSeconds,decodeSeconds,peakBytes" << std::endl;
+	for(size_t i = 0; i < jobs_.size(); ++i) {
+		const Job &job = jobs_[i];
+		if(!job.done)
+			continue;
+		file << codecName(job.coder, sets_.fixedStateFlag) << "," << job.levels << "," << job.colorShift << ","
+			 << std::setprecision(4) << std::fixed << job.bpp << "," << job.bitsOut << ","
+			 << std::setprecision(2) << job.psnrY << "," << job.psnrC << ","
+			 << std::setprecision(6) << job.timeEncoding << "," << job.timeDecoding << ","
+			 << job.highWater << std::endl;
+	}
+
+	file.close();
+	std::cout << "Report saved to file \"" << sets_.reportFile << "\"... OK" << std::endl;
+	return true;
+}
@@ -0,0 +1,67 @@
+// sweep: one image coded by several algorithms, levels, color shifts and rates, one RD report
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include "settings.h"
+#include "image.h"
+#include "workerpool.h"
+#include <vector>
+#include <string>
+
+// class Sweep
+// loads the image once and keeps one transformed copy per WT setting (levels & deep CLS levels),
+// codes BSPIHT (LSPIHT with -m), DSPIHT, CSPIHT (and SPECK with -k) at every level, color shift & rate
+// given as comma separated lists (-l, -S, -p), decodes each and measures PSNR
+// jobs run on the worker pool against the shared read-only copies, each with its own arena
+// writes one CSV line per job: bits, PSNR Y / CbCr, coding & decoding time, memory high-water mark
+class Sweep {
+	// one coded configuration & its results
+	struct Job {
+		char coder;				// b, d, c, k
+		unsigned levels;
+		unsigned colorShift;
+		double bpp;
+		bitCount bits;			// budget
+		unsigned prepared;		// index of the transformed copy
+
+		bool done;
+		bitCount bitsOut;		// bits in the bitstream
+		double psnrY;
+		double psnrC;
+		double timeEncoding;
+		double timeDecoding;
+		size_t highWater;		// arena high-water mark (bytes)
+	};
+
+	Settings &sets_;
+	WorkerPool &workers_;
+
+	Image original_;				// YCbCr pixels (PSNR reference)
+	std::vector<Image> prepared_;	// transformed copies
+	std::vector<unsigned> preparedY_;	// WT levels of luma & chroma of each copy
+	std::vector<unsigned> preparedC_;
+	std::vector<Job> jobs_;
+
+	// not copyable
+	Sweep(const Sweep&);
+	Sweep& operator= (const Sweep&);
+
+	// transformed copy for given levels, made on first use
+	unsigned prepare(unsigned levelsY, unsigned levelsC);
+	// code, decode & measure one job (worker thread, writes nothing but the job)
+	void runJob(Job &job);
+	// write the CSV report
+	bool writeReport() const;
+
+public:
+	// parse comma separated list, false if empty or not a number
+	static bool parseList(const std::string &list, std::vector<double> &values);
+
+	// constructor
+	Sweep(Settings &sets, WorkerPool &workers);
+	// load the image, run all jobs, save the report
+	// false if the image can't be loaded, the lists are wrong or the report can't be written
+	bool run();
+};
+
+#endif
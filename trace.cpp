@@ -0,0 +1,77 @@
+// trace implementation
+#include "trace.h"
+#include <iostream>
+#include <fstream>
+
+bool Trace::enabled_ = false;
+Trace::Clock::time_point Trace::start_;
+std::thread::id Trace::main_;
+std::mutex Trace::mutex_;
+std::vector<Trace::Buffer *> Trace::buffers_;
+
+// start recording
+void Trace::enable() {
+	start_ = Clock::now();
+	main_ = std::this_thread::get_id();
+	enabled_ = true;
+}
+
+// buffer of the calling thread
+Trace::Buffer * Trace::local() {
+	static thread_local Buffer *buffer = 0;
+	if(!buffer) {
+		buffer = new Buffer;
+		buffer->main = std::this_thread::get_id() == main_;
+		std::lock_guard<std::mutex> lock(mutex_);
+		buffer->tid = (unsigned) buffers_.size();
+		buffers_.push_back(buffer);
+	}
+	return buffer;
+}
+
+// add a span
+void Trace::record(const char *name, int arg, Clock::time_point start, Clock::time_point end) {
+	Event e;
+	e.name = name;
+	e.arg = arg;
+	e.start = std::chrono::duration_cast<std::chrono::nanoseconds>(start - start_).count();
+	e.duration = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+	local()->events.push_back(e);
+}
+
+// write the trace-event JSON, times in microseconds
+// call with the worker threads idle
+bool Trace::save(const char *filename) {
+	std::ofstream file;
+	file.open(filename);
+	if(!file.is_open()) {
+		std::cout << "Can't write to file \"" << filename << "\"" << std::endl;
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(mutex_);
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[" << std::endl;
+	bool first = true;
+	for(size_t b = 0; b < buffers_.size(); ++b) {
+		const Buffer &buffer = *buffers_[b];
+		// thread name
+		file << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer.tid
+			 << ",\"args\":{\"name\":\"" << (buffer.main ? "main" : "worker") << " " << buffer.tid << "\"}}";
+		first = false;
+
+		for(size_t i = 0; i < buffer.events.size(); ++i) {
+			const Event &e = buffer.events[i];
+			file << ",\n{\"name\":\"" << e.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer.tid
+				 << ",\"ts\":" << e.start / 1000 << "." << (e.start % 1000) / 100
+				 << ",\"dur\":" << e.duration / 1000 << "." << (e.duration % 1000) / 100;
+			if(e.arg >= 0)
+				file << ",\"args\":{\"n\":" << e.arg << "}";
+			file << "}";
+		}
+	}
+	file << std::endl << "]}" << std::endl;
+
+	file.close();
+	std::cout << "Trace saved to file \"" << filename << "\"... OK" << std::endl;
+	return true;
+}
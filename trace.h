@@ -0,0 +1,120 @@
+// trace: scoped timers on std::chrono, nested spans saved as Chrome / Perfetto trace events
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <chrono>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <stdint.h>
+
+// compile with SPIHT_NO_TRACE defined to leave out all span recording (timers still time)
+
+// class Trace
+// collects the spans of all threads once enabled, each thread into its own buffer,
+// save() writes them as complete ("X") events of the Chrome trace-event JSON format,
+// spans of a thread nest by their times, so the viewer shows the call hierarchy
+class Trace {
+public:
+	typedef std::chrono::steady_clock Clock;
+
+	// recording turned on
+	static bool enabled() {
+#if defined(SPIHT_NO_TRACE)
+		return false;
+#else
+		return enabled_;
+#endif
+	}
+	// start recording, times are relative to now
+	static void enable();
+	// add a span of the calling thread, name must be a string literal
+	// arg (if not negative) is shown with the span, e.g. plane, level or step
+	static void record(const char *name, int arg, Clock::time_point start, Clock::time_point end);
+	// write all spans recorded so far, false if the file can't be written
+	static bool save(const char *filename);
+
+private:
+	// span, times in ns from the start of recording
+	struct Event {
+		const char *name;
+		int arg;
+		int64_t start;
+		int64_t duration;
+	};
+	// spans of one thread
+	struct Buffer {
+		unsigned tid;
+		bool main;			// thread that enabled the recording
+		std::vector<Event> events;
+	};
+
+	// buffer of the calling thread, registered on first use
+	static Buffer * local();
+
+	static bool enabled_;
+	static Clock::time_point start_;
+	static std::thread::id main_;
+	static std::mutex mutex_;				// guards buffers_
+	static std::vector<Buffer *> buffers_;	// all threads, kept until the end of the program
+};
+
+// class TraceSpan
+// span of the enclosing scope, costs a flag test when recording is off
+class TraceSpan {
+	const char *name_;
+	int arg_;
+	bool on_;
+	Trace::Clock::time_point start_;
+
+	// not copyable
+	TraceSpan(const TraceSpan&);
+	TraceSpan& operator= (const TraceSpan&);
+
+public:
+	explicit TraceSpan(const char *name, int arg = -1) : name_(name), arg_(arg), on_(Trace::enabled()) {
+		if(on_)
+			start_ = Trace::Clock::now();
+	}
+	~TraceSpan() {
+		if(on_)
+			Trace::record(name_, arg_, start_, Trace::Clock::now());
+	}
+};
+
+// class TraceTimer
+// timer of the enclosing scope (elapsed times, -T), recorded as a span when recording is on
+class TraceTimer {
+	const char *name_;
+	int arg_;
+	bool running_;
+	double seconds_;
+	Trace::Clock::time_point start_;
+
+	// not copyable
+	TraceTimer(const TraceTimer&);
+	TraceTimer& operator= (const TraceTimer&);
+
+public:
+	explicit TraceTimer(const char *name, int arg = -1) : name_(name), arg_(arg), running_(true), seconds_(0.0), start_(Trace::Clock::now()) {}
+	~TraceTimer() {
+		stop();
+	}
+	// end the span (first call only), returns its length in seconds
+	double stop() {
+		if(running_) {
+			Trace::Clock::time_point end = Trace::Clock::now();
+			seconds_ = std::chrono::duration<double>(end - start_).count();
+			running_ = false;
+			if(Trace::enabled())
+				Trace::record(name_, arg_, start_, end);
+		}
+		return seconds_;
+	}
+	// length in seconds (after stop)
+	double seconds() const {
+		return seconds_;
+	}
+};
+
+#endif
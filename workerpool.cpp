@@ -0,0 +1,82 @@
+// workerpool implementation
+#include "workerpool.h"
+
+// constructor
+WorkerPool::WorkerPool(unsigned threads)
+	: job_(0), tasks_(0), next_(0), busy_(0), generation_(0), quit_(false) {
+	for(unsigned i = 1; i < threads; ++i)
+		threads_.push_back(std::thread(&WorkerPool::worker, this));
+}
+
+// destructor
+WorkerPool::~WorkerPool() {
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		quit_ = true;
+	}
+	wake_.notify_all();
+	for(unsigned i = 0; i < threads_.size(); ++i)
+		threads_[i].join();
+}
+
+// threads working on a job
+unsigned WorkerPool::getThreads() const {
+	return threads_.size() + 1;
+}
+
+// take tasks until none left
+void WorkerPool::drain() {
+	unsigned i;
+	while((i = next_++) < tasks_)
+		(*job_)(i);
+}
+
+// thread body: wait for a job, work, report
+void WorkerPool::worker() {
+	unsigned seen = 0;
+	for(;;) {
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			while(!quit_ && generation_ == seen)
+				wake_.wait(lock);
+			if(quit_)
+				return;
+			seen = generation_;
+		}
+
+		drain();
+
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			if(--busy_ == 0)
+				done_.notify_one();
+		}
+	}
+}
+
+// run job on all threads
+void WorkerPool::run(unsigned tasks, const std::function<void(unsigned)> &fn) {
+	// nothing to share
+	if(threads_.empty() || tasks < 2) {
+		for(unsigned i = 0; i < tasks; ++i)
+			fn(i);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		job_ = &fn;
+		tasks_ = tasks;
+		next_ = 0;
+		busy_ = threads_.size();
+		generation_++;
+	}
+	wake_.notify_all();
+
+	drain();
+
+	// wait for the workers to leave the job
+	std::unique_lock<std::mutex> lock(mutex_);
+	while(busy_ > 0)
+		done_.wait(lock);
+}
@@ -0,0 +1,50 @@
+// workerpool: fixed set of threads running index-parallel jobs
+#ifndef WORKERPOOL_H
+#define WORKERPOOL_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+// WorkerPool:
+// threads are started once per job and wait for work,
+// run() hands out task indices 0..tasks-1 to them and to the calling thread,
+// returns when all tasks are done - tasks must not touch shared state unguarded
+class WorkerPool {
+	std::vector<std::thread> threads_;
+	std::mutex mutex_;
+	std::condition_variable wake_;		// new job / quit
+	std::condition_variable done_;		// last worker left the job
+
+	const std::function<void(unsigned)> *job_;
+	unsigned tasks_;					// task count of the job
+	std::atomic<unsigned> next_;		// next task index to take
+	unsigned busy_;						// workers still in the job
+	unsigned generation_;				// job counter, wakes the workers
+	bool quit_;
+
+	// not copyable
+	WorkerPool(const WorkerPool&);
+	WorkerPool& operator= (const WorkerPool&);
+
+	// thread body
+	void worker();
+	// take tasks until none left
+	void drain();
+
+public:
+	// constructor, threads counts the calling thread (1 = no extra threads)
+	explicit WorkerPool(unsigned threads);
+	// destructor, stops & joins the threads
+	~WorkerPool();
+
+	// threads working on a job, the calling one included
+	unsigned getThreads() const;
+	// run fn(i) for i = 0..tasks-1 in parallel, blocks until all done
+	void run(unsigned tasks, const std::function<void(unsigned)> &fn);
+};
+
+#endif